@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <vector>
+
+#include "array/array.h"
+#include "array/matrix.h"
+#include "clustering/cluster_round.h"
+#include "clustering/definitions.h"
+#include "clustering/distance.h"
+#include "hand_strengths/definitions.h"
+#include "hand_strengths/lut_files.h"
+#include "hand_strengths/lut_generators.h"
+#include "utils/cereal.h"
+#include "utils/lut_file.h"
+#include "utils/pipeline.h"
+#include "utils/random.h"
+
+namespace {
+
+constexpr std::string_view kManifestPath =
+    "out/ai/clustering/abstraction_manifest.txt";
+
+/* Version of the code each stage runs. Bump it when a change to the code
+   changes what the stage writes so that the stage and everything that depends
+   on its output reruns. */
+constexpr std::string_view kLUTStagesVersion = "luts 1";
+constexpr std::string_view kClusterStagesVersion = "clusters 3";
+
+/* Number of clustering stages, one for each round after the preflop. */
+constexpr uint32_t kClusterStages = 3;
+
+/*
+  @brief Parses a positive integer command line argument.
+
+  @return True if the argument was valid.
+*/
+bool ParseCount(const char* arg, uint32_t* out) {
+  char* end;
+  unsigned long value = std::strtoul(arg, &end, 10);  // NOLINT(runtime/int)
+  if (*end != '\0' || value == 0 ||
+      value > std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  *out = value;
+  return true;
+}
+
+/* @brief Returns the output files of a clustering stage. */
+std::vector<std::string> ClusterOutputs(fishbait::Round round) {
+  return {std::string{fishbait::ClusterAssignmentFile(round)},
+          std::string{fishbait::ClusterCentroidFile(round)}};
+}
+
+/*
+  @brief Returns the parameters of a clustering stage.
+
+  A warm stage starts from the clusters it saved last time, which are not the
+  output of any stage it depends on, so their hash is part of its parameters.
+  The stage reruns whenever they changed since it last started from them,
+  which includes every time its last run moved them.
+*/
+std::string ClusterParameters(fishbait::Round round, uint32_t seed,
+                              bool warm) {
+  std::string parameters = std::string{kClusterStagesVersion} + " k=" +
+      std::to_string(fishbait::NumClusters(round)) + " restarts=" +
+      std::to_string(fishbait::kClusterRestarts) + " init=" +
+      std::to_string(fishbait::ClusterInitializer(round)) + " seed=" +
+      std::to_string(seed);
+  if (round == fishbait::Round::kRiver) {
+    parameters += " sample=" + std::to_string(fishbait::kRiverSampleSize);
+  }
+  if (warm) {
+    const std::string centroid_file{fishbait::ClusterCentroidFile(round)};
+    parameters += " warm";
+    if (std::filesystem::exists(centroid_file)) {
+      parameters += " from=" +
+                    std::to_string(fishbait::FileHash(centroid_file));
+    }
+  }
+  return parameters;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  uint32_t n_threads = 0;
+  uint32_t max_jobs = 0;
+  uint32_t seed = 0;
+  uint32_t memory_gb = 0;
+  bool warm = false;
+  bool error = false;
+  for (int i = 1; i < argc && !error; ++i) {
+    if (!strcmp(argv[i], "--warm")) {
+      warm = true;
+    } else if (i + 1 == argc) {
+      error = true;
+    } else if (!strcmp(argv[i], "--threads")) {
+      error = !ParseCount(argv[++i], &n_threads);
+    } else if (!strcmp(argv[i], "--jobs")) {
+      error = !ParseCount(argv[++i], &max_jobs);
+    } else if (!strcmp(argv[i], "--memory")) {
+      error = !ParseCount(argv[++i], &memory_gb);
+    } else if (!strcmp(argv[i], "--seed")) {
+      char* end;
+      unsigned long seed_arg = std::strtoul(argv[++i], &end, 10);  // NOLINT
+      error = *end != '\0' ||
+              seed_arg > std::numeric_limits<uint32_t>::max();
+      seed = seed_arg;
+    } else {
+      error = true;
+    }
+  }
+
+  // Print usage on invalid input
+  if (error) {
+    std::cout << "Usage: abstraction.out [--threads <n>] [--jobs <n>] "
+                 "[--memory <gigabytes>] [--seed <n>] [--warm]" << std::endl;
+    return 1;
+  }
+
+  // Without a thread limit every stage uses every hardware thread, so the
+  // stages run one at a time unless asked otherwise.
+  if (n_threads == 0 && max_jobs == 0) max_jobs = 1;
+
+  // Memory the concurrent restarts of the clustering stages may use in total.
+  // Without a budget the restarts run one at a time. The clustering stages can
+  // run at the same time, so each gets an even share of the budget for as many
+  // of them as the pipeline runs at once. The flop and turn LUTs are clustered
+  // straight from their mappings, so they are not counted.
+  const uint32_t concurrent_clusterings = max_jobs == 0 ? kClusterStages :
+      std::min(max_jobs, kClusterStages);
+  const std::size_t memory_budget = memory_gb * std::size_t{1000000000} /
+                                    concurrent_clusterings;
+
+  /* Every stage after the showdown LUT shares one mapping of it, which is
+     made the first time a stage needs it. */
+  std::once_flag showdown_mapped;
+  std::unique_ptr<fishbait::MappedLUT<fishbait::ShowdownStrength>> showdown;
+  auto showdown_lut = [&]() -> fishbait::LUTView<fishbait::ShowdownStrength> {
+    std::call_once(showdown_mapped, [&] {
+      showdown = std::make_unique<
+          fishbait::MappedLUT<fishbait::ShowdownStrength>>(
+              fishbait::ShowdownLUT_Map(false, true));
+    });
+    return *showdown;
+  };
+
+  const std::string lut_version{kLUTStagesVersion};
+  fishbait::Pipeline pipeline;
+  pipeline.AddStage("showdown", {}, {std::string{fishbait::kShowdownLUT_Path}},
+                    lut_version, [&] {
+    std::vector<fishbait::ShowdownStrength> lut =
+        fishbait::ShowdownLUT(true, n_threads);
+    fishbait::ShowdownLUT_File(fishbait::FileAction::Save, &lut, true);
+  });
+  pipeline.AddStage("preflop", {"showdown"},
+                    {std::string{fishbait::kPreflopLUT_Path}}, lut_version,
+                    [&] {
+    nda::matrix<fishbait::HistCount> lut =
+        fishbait::PreflopLUT(showdown_lut(), true, n_threads);
+    fishbait::PreflopLUT_File(fishbait::FileAction::Save, &lut, true);
+  });
+  pipeline.AddStage("ochs_preflop", {"showdown"},
+                    {std::string{fishbait::kOCHS_PreflopLUT_Path}},
+                    lut_version, [&] {
+    nda::matrix<double> lut =
+        fishbait::OCHS_PreflopLUT(showdown_lut(), true, n_threads);
+    fishbait::OCHS_PreflopLUT_File(fishbait::FileAction::Save, &lut, true);
+  });
+  pipeline.AddStage("flop", {"showdown"},
+                    {std::string{fishbait::kFlopLUT_Path}}, lut_version, [&] {
+    nda::matrix<fishbait::HistCount> lut =
+        fishbait::FlopLUT(showdown_lut(), true, n_threads);
+    fishbait::FlopLUT_File(fishbait::FileAction::Save, &lut, true);
+  });
+  pipeline.AddStage("turn", {"showdown"},
+                    {std::string{fishbait::kTurnLUT_Path}}, lut_version, [&] {
+    nda::matrix<fishbait::HistCount> lut =
+        fishbait::TurnLUT(showdown_lut(), true, n_threads);
+    fishbait::TurnLUT_File(fishbait::FileAction::Save, &lut, true);
+  });
+
+  pipeline.AddStage("flop_clusters", {"flop"},
+      ClusterOutputs(fishbait::Round::kFlop),
+      ClusterParameters(fishbait::Round::kFlop, seed, warm), [&] {
+    fishbait::MappedLUT<fishbait::HistCount> lut =
+        fishbait::FlopLUT_Map(true, true);
+    lut.AdviseSequential();
+    fishbait::ClusterRound<fishbait::HistCount, fishbait::EarthMoverDistance>(
+        fishbait::Round::kFlop, lut.matrix(), seed, memory_budget, warm,
+        n_threads);
+  });
+  pipeline.AddStage("turn_clusters", {"turn"},
+      ClusterOutputs(fishbait::Round::kTurn),
+      ClusterParameters(fishbait::Round::kTurn, seed, warm), [&] {
+    fishbait::MappedLUT<fishbait::HistCount> lut =
+        fishbait::TurnLUT_Map(true, true);
+    lut.AdviseSequential();
+    fishbait::ClusterRound<fishbait::HistCount, fishbait::EarthMoverDistance>(
+        fishbait::Round::kTurn, lut.matrix(), seed, memory_budget, warm,
+        n_threads);
+  });
+  pipeline.AddStage("river_clusters", {"showdown"},
+      ClusterOutputs(fishbait::Round::kRiver),
+      ClusterParameters(fishbait::Round::kRiver, seed, warm), [&] {
+    nda::matrix<float> data_points =
+        fishbait::RiverLUT(showdown_lut(), true);
+    fishbait::ClusterRound<float, fishbait::EuclideanDistance>(
+        fishbait::Round::kRiver, data_points, seed, memory_budget, warm,
+        n_threads);
+  });
+
+  std::vector<std::string> ran = pipeline.Run(kManifestPath, max_jobs, true);
+  std::cout << "Ran " << ran.size() << " stages, the rest were up to date."
+            << std::endl;
+  return 0;
+}
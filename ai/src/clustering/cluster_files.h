@@ -0,0 +1,67 @@
+#ifndef AI_SRC_CLUSTERING_CLUSTER_FILES_H_
+#define AI_SRC_CLUSTERING_CLUSTER_FILES_H_
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "clustering/definitions.h"
+#include "poker/definitions.h"
+#include "utils/lut_file.h"
+
+namespace fishbait {
+
+/*
+  @brief Saves cluster assignments to a LUT file with each cluster packed in a
+      ClusterEntry.
+
+  @param path The path of the file to write.
+  @param assignments The cluster of each hand.
+  @param verbose Option to print progress.
+*/
+inline void SaveClusterAssignments(std::string_view path,
+                                   const std::vector<MeanId>& assignments,
+                                   bool verbose = false) {
+  const std::string func{__func__};
+  std::vector<ClusterEntry> packed(assignments.size());
+  std::transform(assignments.begin(), assignments.end(), packed.begin(),
+                 [&](MeanId cluster) {
+    if (cluster > std::numeric_limits<ClusterEntry>::max()) {
+      throw std::out_of_range(func + " cluster " + std::to_string(cluster) +
+                              " does not fit in a ClusterEntry.");
+    }
+    return static_cast<ClusterEntry>(cluster);
+  });
+  SaveLUT(path, packed.data(), packed.size(), 1, verbose);
+}
+
+/*
+  @brief Saves the cluster assignments of the given round to its assignment
+      file.
+*/
+inline void SaveClusterAssignments(Round round,
+                                   const std::vector<MeanId>& assignments,
+                                   bool verbose = false) {
+  SaveClusterAssignments(ClusterAssignmentFile(round), assignments, verbose);
+}
+
+/*
+  @brief Memory maps the cluster assignments of the given round so that they
+      can be used without loading them into memory.
+
+  @param verify Option to check every chunk of the file now.
+  @param verbose Option to print progress.
+*/
+inline MappedLUT<ClusterEntry> MapClusterAssignments(Round round,
+                                                     bool verify = false,
+                                                     bool verbose = false) {
+  return MappedLUT<ClusterEntry>(ClusterAssignmentFile(round), verify,
+                                 verbose);
+}
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_CLUSTERING_CLUSTER_FILES_H_
@@ -0,0 +1,81 @@
+#ifndef AI_SRC_CLUSTERING_CLUSTER_ROUND_H_
+#define AI_SRC_CLUSTERING_CLUSTER_ROUND_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "array/array.h"
+#include "array/matrix.h"
+#include "clustering/cluster_files.h"
+#include "clustering/definitions.h"
+#include "clustering/k_means.h"
+#include "poker/definitions.h"
+#include "utils/cereal.h"
+#include "utils/random.h"
+
+namespace fishbait {
+
+/* Number of restarts ClusterRound() picks the best clustering from. */
+constexpr uint32_t kClusterRestarts = 10;
+
+/* @brief Returns the initializer used to cluster a round. The river has the
+         fewest dimensions and the most points, so its initialization takes
+         longer than its iterations unless it uses kmeans||. */
+inline InitProc ClusterInitializer(Round round) {
+  return round == Round::kRiver ? kScalable : kParallelPlusPlus;
+}
+
+/*
+  @brief Clusters the data points of a round with float clusters and bounds
+      and saves the assignments and the clusters. The river clusters are found
+      from a sample of the data points.
+
+      Without warm, the best of several restarts is saved, and as many
+      restarts run at once as the memory budget allows. With warm, a single
+      run starts from the clusters the round saved last time, split or merged
+      to the current number of clusters. It starts from scratch if there are
+      none or if they have a different number of dimensions.
+
+  @param round The round to cluster.
+  @param data_points The data point of every hand in the round.
+  @param seed Seed for the clustering.
+  @param memory_budget Bytes the concurrent restarts may use. See
+      KMeans::MultipleRestarts.
+  @param warm Option to start from the clusters saved last time.
+  @param n_threads The most threads to use. 0 means every hardware thread.
+*/
+template <typename T, template <typename, typename> class Distance>
+void ClusterRound(Round round, nda::const_matrix_ref<T> data_points,
+                  uint32_t seed, std::size_t memory_budget, bool warm,
+                  uint32_t n_threads) {
+  const std::string centroid_file{ClusterCentroidFile(round)};
+  nda::matrix<float> previous;
+  if (warm && std::filesystem::exists(centroid_file)) {
+    CerealLoad(centroid_file, &previous, true);
+  }
+  const bool reuse = previous.rows() > 0 &&
+                     previous.columns() == data_points.columns();
+  const BoundProc bounds = round == Round::kRiver ? kHamerly : kYinyang;
+
+  KMeans<T, Distance, float> k(NumClusters(round));
+  k.SetMaxThreads(n_threads);
+  if (reuse) {
+    k.Recluster(data_points, previous, bounds, true, Random::Seed(seed),
+                round == Round::kRiver ? kRiverSampleSize : 0);
+  } else if (round == Round::kRiver) {
+    k.Subsample(data_points, kRiverSampleSize, kClusterRestarts,
+                ClusterInitializer(round), true, Random::Seed(seed), bounds,
+                memory_budget);
+  } else {
+    k.MultipleRestarts(data_points, kClusterRestarts,
+                       ClusterInitializer(round), true, Random::Seed(seed),
+                       bounds, memory_budget);
+  }
+  SaveClusterAssignments(round, *k.assignments(), true);
+  CerealSave(centroid_file, k.clusters(), true);
+}  // ClusterRound()
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_CLUSTERING_CLUSTER_ROUND_H_
@@ -1,59 +1,86 @@
 #include "clustering/cluster_table.h"
 
+#include <algorithm>
 #include <array>
+#include <memory>
 #include <numeric>
 #include <utility>
+#include <vector>
 
+#include "clustering/cluster_files.h"
 #include "clustering/definitions.h"
 #include "poker/definitions.h"
-#include "poker/indexer.h"
 #include "poker/node.h"
 #include "utils/cereal.h"
+#include "utils/lut_file.h"
 
 namespace fishbait {
 
-ClusterTable::ClusterTable() : table_{}, preflop_indexer_{}, flop_indexer_{},
-                               turn_indexer_{}, river_indexer_{} {}
+ClusterTable::ClusterTable() : owned_{}, mapped_{}, table_{} {}
 
-ClusterTable::ClusterTable(bool verbose) : table_{}, preflop_indexer_{},
-                                           flop_indexer_{}, turn_indexer_{},
-                                           river_indexer_{} {
+ClusterTable::ClusterTable(bool verbose) : owned_{}, mapped_{}, table_{} {
   for (RoundId i = 0; i < kNRounds; ++i) {
     if (kClusterAssignmentFiles[i] == "") {
-      table_[i].resize(kImperfectRecallHands[i]);
-      std::iota(table_[i].begin(), table_[i].end(), 0);
+      owned_[i].resize(kImperfectRecallHands[i]);
+      std::iota(owned_[i].begin(), owned_[i].end(), 0);
     } else {
-      CerealLoad(kClusterAssignmentFiles[i], &table_[i], verbose);
+      mapped_[i] = std::make_shared<const MappedLUT<Entry>>(
+          MapClusterAssignments(Round{i}, true, verbose));
     }
   }
+  SetViews();
 }
 
-ClusterTable::ClusterTable(const ClusterTable& other) : table_{other.table_},
-                                                        preflop_indexer_{},
-                                                        flop_indexer_{},
-                                                        turn_indexer_{},
-                                                        river_indexer_{} { }
+ClusterTable::ClusterTable(const ClusterTable& other)
+    : owned_{other.owned_}, mapped_{other.mapped_}, table_{} {
+  SetViews();
+}
 
 ClusterTable::ClusterTable(ClusterTable&& other)
-    : table_{std::move(other.table_)}, preflop_indexer_{}, flop_indexer_{},
-      turn_indexer_{}, river_indexer_{} { }
+    : owned_{std::move(other.owned_)}, mapped_{std::move(other.mapped_)},
+      table_{} {
+  SetViews();
+  other.SetViews();
+}
 
 ClusterTable& ClusterTable::operator=(const ClusterTable& other) {
-  table_ = other.table_;
+  owned_ = other.owned_;
+  mapped_ = other.mapped_;
+  SetViews();
   return *this;
 }
 
 ClusterTable& ClusterTable::operator=(ClusterTable&& other) {
-  table_ = std::move(other.table_);
+  owned_ = std::move(other.owned_);
+  mapped_ = std::move(other.mapped_);
+  SetViews();
+  other.SetViews();
   return *this;
 }
 
 bool ClusterTable::operator!=(const ClusterTable& other) const {
-  return table_ != other.table_;
+  for (RoundId i = 0; i < kNRounds; ++i) {
+    if (table_[i].size() != other.table_[i].size() ||
+        !std::equal(table_[i].data(), table_[i].data() + table_[i].size(),
+                    other.table_[i].data())) {
+      return true;
+    }
+  }
+  return false;
 }
 
 bool ClusterTable::operator==(const ClusterTable& other) const {
   return !(*this != other);
 }
 
+void ClusterTable::SetViews() {
+  for (RoundId i = 0; i < kNRounds; ++i) {
+    if (mapped_[i]) {
+      table_[i] = *mapped_[i];
+    } else {
+      table_[i] = owned_[i];
+    }
+  }
+}
+
 }  // namespace fishbait
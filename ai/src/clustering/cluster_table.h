@@ -2,6 +2,8 @@
 #define AI_SRC_CLUSTERING_CLUSTER_TABLE_H_
 
 #include <array>
+#include <cstdint>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <vector>
@@ -11,16 +13,22 @@
 #include "poker/indexer.h"
 #include "poker/node.h"
 #include "utils/cereal.h"
+#include "utils/lut_file.h"
 
 namespace fishbait {
 
 class ClusterTable {
+ public:
+  using Entry = ClusterEntry;
+
  private:
-  std::array<std::vector<CardCluster>, kNRounds> table_;
-  Indexer<2> preflop_indexer_;
-  Indexer<2, 3> flop_indexer_;
-  Indexer<2, 4> turn_indexer_;
-  Indexer<2, 5> river_indexer_;
+  /* The clusters of each round are held in memory when they were loaded from a
+     cereal archive or have no file, and otherwise in a read only mapping of
+     the round's assignment file, which every copy of the table shares. table_
+     views whichever one holds them. */
+  std::array<std::vector<Entry>, kNRounds> owned_;
+  std::array<std::shared_ptr<const MappedLUT<Entry>>, kNRounds> mapped_;
+  std::array<LUTView<Entry>, kNRounds> table_;
 
   /*
     @brief Constructs a blank ClusterTable. Will crash if used!
@@ -32,6 +40,9 @@ class ClusterTable {
  public:
   /*
     @brief Constructs a ClusterTable from the files in build/out/ai/clustering
+
+    The files are memory mapped rather than loaded, so processes which build a
+    table from the same files share its memory through the page cache.
   */
   explicit ClusterTable(bool verbose);
 
@@ -62,49 +73,132 @@ class ClusterTable {
     @brief Returns an array of cards clusters for the given node.
 
     The clusters are only calculated for non folded and non all-in players at
-    the current betting round.
+    the current betting round. Every player's hand is indexed before any of
+    their clusters are read, and each table entry is prefetched as soon as its
+    index is known, so the cache misses on the table overlap with each other
+    and with the indexing of the other hands rather than happening one after
+    another.
   */
-  template <PlayerN kPlayers>
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
   std::array<CardCluster, kPlayers> ClusterArray(
-      const Node<kPlayers>& node) const {
+      const Node<kPlayers, QuotaT, Rules>& node) const {
     std::array<CardCluster, kPlayers> card_clusters = {0};
+    std::array<hand_index_t, kPlayers> indices;
+    const Entry* table = table_[+node.round()].data();
     for (PlayerId i = 0; i < kPlayers; ++i) {
       if (!node.folded(i) && node.stack(i) != 0) {
-        card_clusters[i] = Cluster(node, i);
+        indices[i] = Index(node, i);
+        __builtin_prefetch(table + indices[i]);
+      }
+    }
+    for (PlayerId i = 0; i < kPlayers; ++i) {
+      if (!node.folded(i) && node.stack(i) != 0) {
+        card_clusters[i] = table[indices[i]];
       }
     }
     return card_clusters;
   }  // ClusterArray()
 
+  /*
+    @brief Returns the card clusters of every round for a node whose whole hand
+        was dealt by Node::DealAll().
+
+    The clusters are only calculated for non folded and non all-in players at
+    the node. Each player's cards are read once, every hand of every round is
+    indexed before any cluster is read, and each table entry is prefetched as
+    soon as its index is known, so the cache misses of all the rounds overlap.
+  */
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
+  DealClusters<kPlayers> ClusterMatrix(
+      const Node<kPlayers, QuotaT, Rules>& node) const {
+    DealClusters<kPlayers> card_clusters = {};
+    std::array<std::array<hand_index_t, kPlayers>, kNRounds> indices;
+    const Indexer<2>& preflop_indexer = Indexer<2>::Shared();
+    const Indexer<2, 3>& flop_indexer = Indexer<2, 3>::Shared();
+    const Indexer<2, 4>& turn_indexer = Indexer<2, 4>::Shared();
+    const Indexer<2, 5>& river_indexer = Indexer<2, 5>::Shared();
+    for (PlayerId i = 0; i < kPlayers; ++i) {
+      if (!node.folded(i) && node.stack(i) != 0) {
+        std::array player_cards = node.PlayerCards(i, Round::kRiver);
+        indices[+Round::kPreFlop][i] = preflop_indexer.IndexLast(player_cards);
+        indices[+Round::kFlop][i] = flop_indexer.IndexLast(player_cards);
+        indices[+Round::kTurn][i] = turn_indexer.IndexLast(player_cards);
+        indices[+Round::kRiver][i] = river_indexer.IndexLast(player_cards);
+        for (RoundId r = 0; r < kNRounds; ++r) {
+          __builtin_prefetch(table_[r].data() + indices[r][i]);
+        }
+      }
+    }
+    for (PlayerId i = 0; i < kPlayers; ++i) {
+      if (!node.folded(i) && node.stack(i) != 0) {
+        for (RoundId r = 0; r < kNRounds; ++r) {
+          card_clusters[r][i] = table_[r][indices[r][i]];
+        }
+      }
+    }
+    return card_clusters;
+  }  // ClusterMatrix()
+
   /*
     @brief Returns the card cluster for the given player in the given node.
   */
-  template <PlayerN kPlayers>
-  CardCluster Cluster(const Node<kPlayers>& node, PlayerId player) const {
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
+  CardCluster Cluster(const Node<kPlayers, QuotaT, Rules>& node,
+                      PlayerId player) const {
+    return table_[+node.round()][Index(node, player)];
+  }
+
+  /* @brief Returns a const reference to views of the raw table. */
+  const auto& table() const { return table_; }
+
+  /* @brief ClusterTable save function. Mapped rounds are saved the same way
+         as rounds held in memory, so the archive does not need the files. */
+  template<class Archive>
+  void save(Archive& archive) const {
+    for (RoundId i = 0; i < kNRounds; ++i) {
+      if (mapped_[i]) {
+        archive(std::vector<Entry>(table_[i].data(),
+                                   table_[i].data() + table_[i].size()));
+      } else {
+        archive(owned_[i]);
+      }
+    }
+  }
+
+  /* @brief ClusterTable load function */
+  template<class Archive>
+  void load(Archive& archive) {
+    archive(owned_);
+    mapped_ = {};
+    SetViews();
+  }
+
+ private:
+  /* @brief Points each round's view at the clusters which hold it. */
+  void SetViews();
+
+  /*
+    @brief Returns the index of the given player's hand in the table of the
+        node's round.
+  */
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
+  hand_index_t Index(const Node<kPlayers, QuotaT, Rules>& node,
+                     PlayerId player) const {
     std::array player_cards = node.PlayerCards(player);
     switch (node.round()) {
       case Round::kPreFlop:
-        return preflop_indexer_.IndexLast(player_cards);
+        return Indexer<2>::Shared().IndexLast(player_cards);
       case Round::kFlop:
-        return table_[1][flop_indexer_.IndexLast(player_cards)];
+        return Indexer<2, 3>::Shared().IndexLast(player_cards);
       case Round::kTurn:
-        return table_[2][turn_indexer_.IndexLast(player_cards)];
+        return Indexer<2, 4>::Shared().IndexLast(player_cards);
       case Round::kRiver:
-        return table_[3][river_indexer_.IndexLast(player_cards)];
+        return Indexer<2, 5>::Shared().IndexLast(player_cards);
     }
     std::stringstream ss;
     ss << +(+node.round()) << " is not a valid round." << std::endl;
     throw std::out_of_range(ss.str());
-  }
-
-  /* @brief Returns a const reference to the raw table. */
-  const auto& table() const { return table_; }
-
-  /* @brief ClusterTable serialize function */
-  template<class Archive>
-  void serialize(Archive& archive) {
-    archive(table_);
-  }
+  }  // Index()
 };  // class ClusterTable
 
 }  // namespace fishbait
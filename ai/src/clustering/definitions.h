@@ -3,7 +3,9 @@
 
 #include <array>
 #include <cstdint>
+#include <limits>
 #include <string>
+#include <type_traits>
 
 #include "poker/definitions.h"
 
@@ -14,20 +16,55 @@ using MeansN = MeanId;
 
 using CardCluster = MeanId;
 
+/* The card cluster of each player in each round of a deal, indexed by round
+   and then by player. */
+template <PlayerN kPlayers>
+using DealClusters = std::array<std::array<CardCluster, kPlayers>, kNRounds>;
+
 constexpr std::array<std::string_view, kNRounds>
-    kClusterAssignmentFiles = {{"", "out/ai/clustering/flop_clusters.cereal",
-                                "out/ai/clustering/turn_clusters.cereal",
-                                "out/ai/clustering/river_clusters.cereal"}};
+    kClusterAssignmentFiles = {{"", "out/ai/clustering/flop_clusters.lut",
+                                "out/ai/clustering/turn_clusters.lut",
+                                "out/ai/clustering/river_clusters.lut"}};
 inline constexpr std::string_view ClusterAssignmentFile(Round r) {
   return kClusterAssignmentFiles[+r];
 }
 
+/* The clusters each assignment file was made with, so that a later run can
+   start from them (see KMeans::Recluster). */
+constexpr std::array<std::string_view, kNRounds>
+    kClusterCentroidFiles = {{"", "out/ai/clustering/flop_centroids.cereal",
+                              "out/ai/clustering/turn_centroids.cereal",
+                              "out/ai/clustering/river_centroids.cereal"}};
+inline constexpr std::string_view ClusterCentroidFile(Round r) {
+  return kClusterCentroidFiles[+r];
+}
+
 constexpr std::array<CardCluster, kNRounds> kNumClusters = {kUniqueHands, 200,
                                                             200, 200};
 inline constexpr CardCluster NumClusters(Round r) {
   return kNumClusters[+r];
 }
 
+/* @brief Returns the most clusters of any round. */
+inline constexpr CardCluster MaxNumClusters() {
+  CardCluster max = 0;
+  for (CardCluster n : kNumClusters) max = n > max ? n : max;
+  return max;
+}
+
+/* The smallest unsigned integer that holds every cluster of every round, which
+   cluster assignments are stored in. With 256 clusters or fewer per round this
+   is a byte, a quarter of a CardCluster. */
+using ClusterEntry = std::conditional_t<
+    MaxNumClusters() - 1 <= std::numeric_limits<uint8_t>::max(), uint8_t,
+    std::conditional_t<
+        MaxNumClusters() - 1 <= std::numeric_limits<uint16_t>::max(),
+        uint16_t, CardCluster>>;
+
+/* Number of river hands to find the river clusters from, which keeps the
+   restarts fast. Every river hand is then assigned to its closest cluster. */
+constexpr uint32_t kRiverSampleSize = 2000000;
+
 }  // namespace fishbait
 
 #endif  // AI_SRC_CLUSTERING_DEFINITIONS_H_
@@ -4,17 +4,71 @@
 #include <cassert>
 #include <cmath>
 #include <cstdint>
-#include <functional>
-#include <numeric>
+#include <type_traits>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
 
 #include "array/array.h"
 
 namespace fishbait {
 
+#if defined(__AVX2__) && defined(__FMA__)
+
+/* True if distances between vectors of the given types have a SIMD kernel. */
+template <typename T>
+constexpr bool kSimdDistance = std::is_same_v<T, double> ||
+                               std::is_same_v<T, float> ||
+                               std::is_same_v<T, uint32_t> ||
+                               std::is_same_v<T, int32_t>;
+
+/* @brief Loads 4 elements starting at p as doubles. */
+inline __m256d Load4(const double* p) { return _mm256_loadu_pd(p); }
+inline __m256d Load4(const float* p) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+inline __m256d Load4(const int32_t* p) {
+  return _mm256_cvtepi32_pd(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+inline __m256d Load4(const uint32_t* p) {
+  // Flip the sign bit to convert as signed, then add the 2^31 back
+  __m128i flipped = _mm_xor_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+      _mm_set1_epi32(INT32_MIN));
+  return _mm256_add_pd(_mm256_cvtepi32_pd(flipped),
+                       _mm256_set1_pd(2147483648.0));
+}
+
+/* @brief Returns the sum of the 4 lanes of v. */
+inline double HorizontalSum(__m256d v) {
+  __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v),
+                            _mm256_extractf128_pd(v, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+#else
+
+template <typename T>
+constexpr bool kSimdDistance = false;
+
+#endif
+
 template <typename T, typename U>
 class EarthMoverDistance {
  public:
   static double Compute(nda::vector_ref<T> p, nda::vector_ref<U> q) {
+    if constexpr (kSimdDistance<T> && kSimdDistance<U>) {
+      return ComputeSimd(p, q);
+    } else {
+      return ComputeScalar(p, q);
+    }
+  }
+
+  /* @brief Computes the distance one bucket at a time. Compute is equal to
+         this up to the rounding of the running sums. */
+  static double ComputeScalar(nda::vector_ref<T> p, nda::vector_ref<U> q) {
     // The two distributions need to have the same number of buckets
     assert(p.width() == q.width());
 
@@ -30,20 +84,100 @@ class EarthMoverDistance {
     }
     return sum;
   }
+
+ private:
+  /* @brief Computes the distance 4 buckets at a time. The differences of each
+         group of 4 buckets are prefix summed in registers and added to the
+         running difference carried over from the previous group. */
+  static double ComputeSimd(nda::vector_ref<T> p, nda::vector_ref<U> q) {
+#if defined(__AVX2__) && defined(__FMA__)
+    assert(p.width() == q.width());
+
+    const T* p_base = p.base();
+    const U* q_base = q.base();
+    const nda::index_t width = p.width();
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d carry = zero;
+    __m256d sums = zero;
+    nda::index_t i = 0;
+    for (; i + 4 <= width; i += 4) {
+      __m256d diff = _mm256_sub_pd(Load4(p_base + i), Load4(q_base + i));
+      // [d0, d1, d2, d3] + [0, d0, d1, d2]
+      diff = _mm256_add_pd(diff, _mm256_blend_pd(
+          _mm256_permute4x64_pd(diff, 0x90), zero, 0x1));
+      // + [0, 0, d0 + 0, d1 + d0]
+      diff = _mm256_add_pd(diff, _mm256_permute2f128_pd(diff, diff, 0x08));
+      __m256d prefix = _mm256_add_pd(diff, carry);
+      sums = _mm256_add_pd(sums, _mm256_andnot_pd(sign, prefix));
+      carry = _mm256_permute4x64_pd(prefix, 0xFF);
+    }
+
+    double prev = _mm256_cvtsd_f64(carry);
+    double sum = HorizontalSum(sums);
+    for (; i < width; ++i) {
+      double nxt = p_base[i] + prev - q_base[i];
+      sum += std::abs(nxt);
+      prev = nxt;
+    }
+    return sum;
+#else
+    return ComputeScalar(p, q);
+#endif
+  }
 };
 
 template <typename T, typename U>
 class EuclideanDistance {
  public:
   static double Compute(nda::vector_ref<T> p, nda::vector_ref<U> q) {
+    if constexpr (kSimdDistance<T> && kSimdDistance<U>) {
+      return ComputeSimd(p, q);
+    } else {
+      return ComputeScalar(p, q);
+    }
+  }
+
+  /* @brief Computes the distance one element at a time. Compute is equal to
+         this up to the rounding of the sum of squares. */
+  static double ComputeScalar(nda::vector_ref<T> p, nda::vector_ref<U> q) {
     // The two distributions need to have the same number of buckets
     assert(p.width() == q.width());
 
-    double squared_dist = std::transform_reduce(p.base(), p.base() + p.width(),
-        q.base(), 0.0, std::plus<double>(),
-        [](T a, U b) -> double { return std::pow(b - a, 2); });
+    double squared_dist = 0;
+    for (nda::index_t i = 0; i < p.width(); ++i) {
+      double diff = static_cast<double>(q(i)) - p(i);
+      squared_dist += diff * diff;
+    }
+    return std::sqrt(squared_dist);
+  }
+
+ private:
+  /* @brief Computes the distance 4 elements at a time with fused multiply
+         adds. */
+  static double ComputeSimd(nda::vector_ref<T> p, nda::vector_ref<U> q) {
+#if defined(__AVX2__) && defined(__FMA__)
+    assert(p.width() == q.width());
+
+    const T* p_base = p.base();
+    const U* q_base = q.base();
+    const nda::index_t width = p.width();
+    __m256d squares = _mm256_setzero_pd();
+    nda::index_t i = 0;
+    for (; i + 4 <= width; i += 4) {
+      __m256d diff = _mm256_sub_pd(Load4(q_base + i), Load4(p_base + i));
+      squares = _mm256_fmadd_pd(diff, diff, squares);
+    }
 
+    double squared_dist = HorizontalSum(squares);
+    for (; i < width; ++i) {
+      double diff = static_cast<double>(q_base[i]) - p_base[i];
+      squared_dist = std::fma(diff, diff, squared_dist);
+    }
     return std::sqrt(squared_dist);
+#else
+    return ComputeScalar(p, q);
+#endif
   }
 };
 
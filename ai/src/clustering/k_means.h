@@ -2,13 +2,17 @@
 #define AI_SRC_CLUSTERING_K_MEANS_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <utility>
 #include <vector>
@@ -18,85 +22,183 @@
 #include "clustering/definitions.h"
 #include "utils/combination_matrix.h"
 #include "utils/random.h"
+#include "utils/thread_pool.h"
 #include "utils/timer.h"
 
 namespace fishbait {
 
-enum InitProc { kPlusPlus, kRandomSum, kRandomProb };
-
-template <typename T, template <class, class> class Distance>
+/* Ways to choose the initial clusters:
+     kPlusPlus: kmeans++, one serial pass over the data for each cluster.
+     kRandomSum, kRandomProb: random clusters which are not data points.
+     kParallelPlusPlus: kmeans++ with each pass split between the hardware
+       threads. Points are chosen from the same distribution as kPlusPlus.
+     kScalable: kmeans||, which oversamples candidates in a few parallel
+       passes and then runs weighted kmeans++ on the candidates. */
+enum InitProc { kPlusPlus, kRandomSum, kRandomProb, kParallelPlusPlus,
+                kScalable };
+
+/* Bounds used to skip distance computations. Every kind finds the same
+   clusters from the same initial clusters, but they keep different amounts of
+   state per data point:
+     kElkan: a lower bound for every cluster, so rows * k doubles.
+     kYinyang: a lower bound for every group of about kYinyangGroupSize
+       clusters, so rows * k / kYinyangGroupSize doubles.
+     kHamerly: a single lower bound, so rows doubles.
+   Elkan skips the most distances and Hamerly the fewest. */
+enum BoundProc { kElkan, kYinyang, kHamerly };
+
+constexpr MeansN kYinyangGroupSize = 10;
+
+/* Number of sampling passes kmeans|| makes, and the expected number of
+   candidates it samples in each pass as a multiple of k. */
+constexpr uint32_t kScalableRounds = 5;
+constexpr double kScalableOversampling = 2;
+
+/* T is the type of the data points. Precision is the type of the clusters and
+   of the per point bounds, so float halves their memory and bandwidth.
+   Distances are computed and compared in double, and bounds are rounded
+   towards the side that keeps them bounds, so Elkan, Yinyang, and Hamerly
+   still agree for either precision.
+
+   The data points are taken as a view, so they may be an nda::matrix or a
+   LUT which is memory mapped rather than loaded (see MappedLUT::matrix()).
+   Every pass over the points reads them in a few large contiguous blocks, one
+   at a time per thread, so a mapped LUT is streamed from the file in order and
+   only the clusters and the per point bounds need to fit in memory. */
+template <typename T, template <class, class> class Distance,
+          typename Precision = double>
 class KMeans {
  public:
+  /* Seconds spent in each step of the last run of Elkan, summed over the
+     iterations. */
+  struct ElkanTimes {
+    double initialization = 0;  // initial assignment and bounds
+    double cluster_dists = 0;   // step 1
+    double bounds = 0;          // steps 2 and 3
+    double means = 0;           // step 4
+    double lower_bounds = 0;    // step 5
+    double upper_bounds = 0;    // step 6
+    double loss = 0;            // step 7
+  };
+
   explicit KMeans(MeansN k)
-      : k_{k}, clusters_{nullptr}, assignments_{nullptr}, loss_{INFINITY} {}
-  KMeans(MeansN k, std::unique_ptr<nda::matrix<double>> initial_clusters)
+      : k_{k}, clusters_{nullptr}, assignments_{nullptr}, loss_{INFINITY},
+        iterations_{0} {}
+  KMeans(MeansN k, std::unique_ptr<nda::matrix<Precision>> initial_clusters)
       : k_{k}, clusters_{std::move(initial_clusters)}, assignments_{nullptr},
-        loss_{INFINITY} {}
+        loss_{INFINITY}, iterations_{0} {}
 
-  KMeans(const KMeans& other) : k_{other.k_}, loss_{other.loss_} {
-    clusters_ = std::make_unique<nda::matrix<double>>(*other.clusters_);
-    assignments_ = std::make_unique<std::vector<MeanId>>(*other.assignments_);
+  KMeans(const KMeans& other)
+      : k_{other.k_}, loss_{other.loss_}, iterations_{other.iterations_},
+        elkan_times_{other.elkan_times_}, max_threads_{other.max_threads_} {
+    if (other.clusters_ != nullptr) {
+      clusters_ = std::make_unique<nda::matrix<Precision>>(*other.clusters_);
+    }
+    if (other.assignments_ != nullptr) {
+      assignments_ = std::make_unique<std::vector<MeanId>>(
+          *other.assignments_);
+    }
   }
   KMeans& operator=(const KMeans& other) = delete;
 
   /*
-    @brief Run kmeans clustering several times and pick the best one.
+    @brief Run kmeans clustering several times and pick the best one. As many
+        restarts run at once as the memory budget allows, and the hardware
+        threads are split between them. Every restart gets the same seeds
+        however many run at once, so the result does not depend on the
+        budget.
 
-    @param data The data points to cluster.
+    @param data The data points to cluster. They are shared by the restarts.
     @param restarts The number of times to run kmeans.
     @param initializer The algorithm to use to genereate the initial clusters.
     @param verbose Print diagnostics information.
     @param seed Seed to use for assigning empty clusters and initializing
         clusters. If no seed is passed then a random seed is chosen.
+    @param bounds The bounds to run kmeans with.
+    @param memory_budget The number of bytes the per point state of the
+        concurrent restarts (see TrialBytes) may take. 0 runs the restarts one
+        at a time.
   */
-  void MultipleRestarts(const nda::matrix<T>& data, uint32_t restarts,
+  void MultipleRestarts(nda::const_matrix_ref<T> data, uint32_t restarts,
                         InitProc initializer = kPlusPlus, bool verbose = false,
-                        Random::Seed seed = Random::Seed()) {
+                        Random::Seed seed = Random::Seed(),
+                        BoundProc bounds = kElkan,
+                        std::size_t memory_budget = 0) {
     // Variables to store the clustering with the lowest loss
-    std::unique_ptr<nda::matrix<double>> clusters(nullptr);
+    std::unique_ptr<nda::matrix<Precision>> clusters(nullptr);
     std::unique_ptr<std::vector<MeanId>> assignments(nullptr);
     double loss = INFINITY;
     uint32_t best_trial = 0;
+    uint32_t best_iterations = 0;
 
-    // Random number generator to generate seeds
+    // Generate the initialization and clustering seed of every trial up front
     Random rng(seed);
     std::uniform_int_distribution<uint32_t> seed_gen;
+    std::vector<std::pair<uint32_t, uint32_t>> seeds(restarts);
+    for (std::pair<uint32_t, uint32_t>& trial_seeds : seeds) {
+      trial_seeds.first = seed_gen(rng());
+      trial_seeds.second = seed_gen(rng());
+    }
 
-    // Repeat the clustering the specified number of times
-    for (uint32_t t = 0; t < restarts; ++t) {
-      if (verbose) {
-        std::cout << "starting trial " << t << std::endl;
-      }
-
-      // Set the starting clusters
-      switch (initializer) {
-        case kPlusPlus:
-          InitPlusPlus(data, verbose, Random::Seed(seed_gen(rng())));
-          break;
-        case kRandomSum:
-          RandomSumInit(data, Random::Seed(seed_gen(rng())));
-          break;
-        case kRandomProb:
-          RandomProbInit(data, Random::Seed(seed_gen(rng())));
-          break;
-      }  // switch (initializer)
-
-      // Run kmeans until convergence
-      Elkan(data, verbose, Random::Seed(seed_gen(rng())));
-
-      // If the new clustering is better than the best one so far, replace it
-      if (loss_ < loss) {
-        loss = loss_;
-        clusters = std::move(clusters_);
-        assignments = std::move(assignments_);
-        best_trial = t;
-      }
-    }  // for t
+    const std::size_t trial_bytes = TrialBytes(initializer, bounds,
+                                               data.rows(), k_);
+    const uint32_t n_jobs = std::max<std::size_t>(
+        std::min<std::size_t>(memory_budget / trial_bytes, restarts), 1);
+    const uint32_t trial_threads = n_jobs == 1 ? max_threads_ :
+        std::max(Threads() / n_jobs, uint32_t{1});
+    const bool trial_verbose = verbose && n_jobs == 1;
+    if (verbose && n_jobs > 1) {
+      std::cout << "running " << n_jobs << " trials at once with "
+                << trial_threads << " threads each" << std::endl;
+    }
+
+    std::mutex best_mutex;
+    std::atomic<uint32_t> next_trial = 0;
+    auto run_trials = [&]() {
+      for (uint32_t t = next_trial++; t < restarts; t = next_trial++) {
+        if (verbose) {
+          std::cout << "starting trial " + std::to_string(t) + "\n"
+                    << std::flush;
+        }
+        KMeans trial(k_);
+        trial.max_threads_ = trial_threads;
+        trial.Initialize(data, initializer, trial_verbose,
+                         Random::Seed(seeds[t].first));
+        trial.Cluster(data, bounds, trial_verbose,
+                      Random::Seed(seeds[t].second));
+        if (verbose && n_jobs > 1) {
+          std::cout << "trial " + std::to_string(t) + " loss: " +
+                       std::to_string(trial.loss_) + "\n" << std::flush;
+        }
+
+        // If the new clustering is better than the best one so far, replace
+        // it. Ties go to the earlier trial, as when they run one at a time.
+        std::lock_guard<std::mutex> lock(best_mutex);
+        if (trial.loss_ < loss || (trial.loss_ == loss && t < best_trial)) {
+          loss = trial.loss_;
+          clusters = std::move(trial.clusters_);
+          assignments = std::move(trial.assignments_);
+          best_trial = t;
+          best_iterations = trial.iterations_;
+        }
+      }  // for t
+    };  // run_trials
+
+    if (n_jobs == 1) {
+      run_trials();
+    } else {
+      std::vector<std::thread> jobs;
+      for (uint32_t job = 0; job < n_jobs; ++job) {
+        jobs.emplace_back(run_trials);
+      }
+      for (std::thread& job : jobs) job.join();
+    }
 
     // Set the instance variables to the best clustering found
     loss_ = loss;
     clusters_ = std::move(clusters);
     assignments_ = std::move(assignments);
+    iterations_ = best_iterations;
 
     if (verbose) {
       std::cout << "best trial: " << best_trial << std::endl;
@@ -112,44 +214,39 @@ class KMeans {
     @param seed Seed to use for assigning empty clusters and initializing
         clusters if they are not already initialized.
   */
-  void Elkan(const nda::matrix<T>& data, bool verbose = false,
+  void Elkan(nda::const_matrix_ref<T> data, bool verbose = false,
              Random::Seed seed = Random::Seed()) {
-    std::unique_ptr<nda::matrix<double>> clusters(nullptr);
+    std::unique_ptr<nda::matrix<Precision>> clusters(nullptr);
     if (clusters_ == nullptr) {
       InitPlusPlus(data, verbose, seed);
     }
-    clusters = std::make_unique<nda::matrix<double>>(*clusters_);
+    clusters = std::make_unique<nda::matrix<Precision>>(*clusters_);
     double loss = INFINITY;
 
     // Initialize the lower bounds of the distance between x and every cluster
     // to 0
-    nda::matrix<double> lower_bounds({data.rows(), k_}, 0);
+    nda::matrix<Precision> lower_bounds({data.rows(), k_}, 0);
 
     // Compute and store the distance between each cluster and every other
-    // cluster
+    // cluster, and keep track of 1/2 the distance to the shortest other
+    // cluster from each cluster
+    Timer t;
+    elkan_times_ = ElkanTimes{};
     CombinationMatrix<double> cluster_dists(k_);
-    for (MeanId c1 = 0; c1 < k_; ++c1) {
-      for (MeanId c2 = c1 + 1; c2 < k_; ++c2) {
-        cluster_dists(c1, c2) = Distance<double, double>::Compute(
-            (*clusters)(c1, nda::all), (*clusters)(c2, nda::all));
-      }
-    }
-
-    // An array to keep track of 1/2 the distance to the shortest other cluster
-    // from each cluster
     std::vector<double> half_min_cluster_dists(k_);
+    ClusterDists(*clusters, &cluster_dists, &half_min_cluster_dists);
 
     // Compute the assignments for each point (the closest cluster) using
     // lemma 1 to avoid redudant distance computation, and store the distance
     // to the closest cluster as the upper bound for each point.
-    std::vector<double> upper_bounds(data.rows());
-    std::vector<bool> upper_bound_loose(data.rows(), true);
+    std::vector<Precision> upper_bounds(data.rows());
+    std::vector<uint8_t> upper_bound_loose(data.rows(), true);
     auto assignments = std::make_unique<std::vector<MeanId>>(data.rows());
-    for (nda::index_t x = 0; x < data.rows(); ++x) {
+    ForEachPoint(data.rows(), [&](nda::index_t x) {
       (*assignments)[x] = 0;
-      upper_bounds[x] = Distance<T, double>::Compute(data(x, nda::all),
-                                                     (*clusters)(0, nda::all));
-      lower_bounds(x, 0) = upper_bounds[x];
+      double upper_bound = Distance<T, Precision>::Compute(
+          data(x, nda::all), (*clusters)(0, nda::all));
+      lower_bounds(x, 0) = RoundDown(upper_bound);
 
       MeanId& c = (*assignments)[x];
       for (MeanId cprime = 1; cprime < k_; ++cprime) {
@@ -158,205 +255,125 @@ class KMeans {
         // lower bound of the distance between x and this cluster to the
         // distance we just calculated
 
-        if (cluster_dists(c, cprime)/2 < upper_bounds[x]) {
-          double x_cprime_dist = Distance<T, double>::Compute(
+        if (cluster_dists(c, cprime)/2 < upper_bound) {
+          double x_cprime_dist = Distance<T, Precision>::Compute(
               data(x, nda::all), (*clusters)(cprime, nda::all));
-          lower_bounds(x, cprime) = x_cprime_dist;
+          lower_bounds(x, cprime) = RoundDown(x_cprime_dist);
 
           // If this cluster is the closest cluster we have encountered so far,
           // assign x to this cluster and set the upper bound of x to the
           // distance between this cluster and x
-          if (x_cprime_dist < upper_bounds[x]) {
+          if (x_cprime_dist < upper_bound) {
             (*assignments)[x] = cprime;
-            upper_bounds[x] = x_cprime_dist;
+            upper_bound = x_cprime_dist;
           }
         }
       }  // for c
-      upper_bound_loose[x] = false;
-    }  // for x
+      // A bound rounded up to Precision is no longer the exact distance, so
+      // a cluster at the same distance would look closer
+      upper_bounds[x] = RoundUp(upper_bound);
+      upper_bound_loose[x] = upper_bounds[x] != upper_bound;
+    });  // ForEachPoint
 
     // Initialize random number generator for filling empty clusters
     Random rng(seed);
-    std::uniform_real_distribution<> std_unif(0.0, 1.0);
 
+    elkan_times_.initialization += t.Reset<Timer::Seconds>();
     if (verbose) {
-      std::cout << "initialized data structures";
-      std::cout << std::endl;
+      std::cout << "initialized data structures: "
+                << elkan_times_.initialization << " s" << std::endl;
     }
 
-    const nda::index_t cores = std::max(std::thread::hardware_concurrency(),
-        (uint32_t) 1);
-    const uint32_t n_threads = std::min(data.rows(), cores);
-    std::vector<std::thread> threads(n_threads);
+    // Adds the time since the last step to the given step's total
+    auto time_step = [&](double* step_total, const char* step_name) {
+      double step_time = t.Reset<Timer::Seconds>();
+      *step_total += step_time;
+      if (verbose) {
+        std::cout << step_name << ": " << step_time << " s" << std::endl;
+      }
+    };
 
     bool converged = false;
     uint32_t iteration = 0;
-    Timer t;
     while (!converged) {
       // Step 1
-      // For all centers c and c', compute the distance between them
-      for (MeanId c1 = 0; c1 < k_; ++c1) {
-        for (MeanId c2 = c1 + 1; c2 < k_; ++c2) {
-          cluster_dists(c1, c2) = Distance<double, double>::Compute(
-              (*clusters)(c1, nda::all), (*clusters)(c2, nda::all));
-        }
-      }
-      // From each cluster, compute and store 1/2 the distance to the nearest
-      // other cluster
-      for (MeanId c1 = 0; c1 < k_; ++c1) {
-        bool uninitialized = true;
-        for (MeanId c2 = 0; c2 < k_; ++c2) {
-          if (c1 == c2) continue;
-          if (uninitialized) {
-            half_min_cluster_dists[c1] = cluster_dists(c1, c2)/2;
-            uninitialized = false;
-          } else {
-            half_min_cluster_dists[c1] = std::min(cluster_dists(c1, c2)/2,
-                                                  half_min_cluster_dists[c1]);
-          }
-        }
-      }
-      if (verbose) t.Reset(std::cout << "step 1: ") << std::endl;
+      ClusterDists(*clusters, &cluster_dists, &half_min_cluster_dists);
+      time_step(&elkan_times_.cluster_dists, "step 1");
 
       // Step 3
-      for (uint32_t thread = 0; thread < n_threads; ++thread) {
-        threads[thread] = std::thread([&, thread]() {
-              for (nda::index_t x = thread; x < data.rows(); x += n_threads) {
-                MeanId& c_x = (*assignments)[x];
-
-                // Step 2
-                if (upper_bounds[x] <= half_min_cluster_dists[c_x]) continue;
-
-                for (MeanId c = 0; c < k_; ++c) {
-                  // Step 3(i)
-                  if (c == c_x) continue;
-
-                  // Step 3(ii)
-                  if (upper_bounds[x] <= lower_bounds(x, c)) continue;
-
-                  // Step 3(iii)
-                  if (upper_bounds[x] <= cluster_dists(c_x, c)/2) continue;
-
-                  // Step 3a
-                  if (upper_bound_loose[x]) {
-                    upper_bounds[x] = Distance<T, double>::Compute(
-                        data(x, nda::all), (*clusters)(c_x, nda::all));
-                    lower_bounds(x, c_x) = upper_bounds[x];
-                    upper_bound_loose[x] = false;
-                  }
-
-                  // Step 3b
-                  if (upper_bounds[x] > lower_bounds(x, c) ||
-                      upper_bounds[x] > cluster_dists(c_x, c)/2) {
-                    double x_c_dist = Distance<T, double>::Compute(
-                        data(x, nda::all), (*clusters)(c, nda::all));
-                    lower_bounds(x, c) = x_c_dist;
-                    if (x_c_dist < upper_bounds[x]) {
-                      c_x = c;
-                      upper_bounds[x] = x_c_dist;
-                    }
-                  }
-                }  // for c
-              }  // for x
-            }  // [&, thread]()
-        );  // std::thread  NOLINT(whitespace/parens)
-      }  // for thread
-      for (uint32_t thread = 0; thread < n_threads; ++thread) {
-        threads[thread].join();
-      }  // for thread
-      if (verbose) t.Reset(std::cout << "step 2,3: ") << std::endl;
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
+        MeanId& c_x = (*assignments)[x];
 
-      // Step 4
-      // First, sum the data points assigned to each cluster
-      nda::matrix_shape<> means_shape{k_, data.columns()};
-      auto means = std::make_unique<nda::matrix<double>>(means_shape, 0);
-      std::vector<nda::size_t> cluster_counts(k_, 0);
-      for (nda::index_t x = 0; x < data.rows(); ++x) {
-        MeanId c = (*assignments)[x];
-        (*means)(c, nda::all) += data(x, nda::all);
-        cluster_counts[c] += 1;
-      }
-      // Find any empty clusters
-      std::vector<MeansN> empty_clusters;
-      for (MeanId c = 0; c < k_; ++c) {
-        if (cluster_counts[c] == 0) {
-          empty_clusters.push_back(c);
-        }
-      }
-      // If there are empty clusters, fill them with the kmeans++ algorithm
-      if (empty_clusters.size() > 0) {
-        if (verbose) {
-          std::cout << "empty clusters: " << empty_clusters.size() << std::endl;
-        }
-        // Calculate the squared distances between each point and it's assigned
-        // cluster, and the sum of those distances. These values are needed for
-        // kmeans++.
-        std::vector<double> squared_dists(data.rows());
-        double squared_sum = 0;
-        for (uint32_t x = 0; x < data.rows(); ++x) {
-          squared_dists[x] = upper_bounds[x] * upper_bounds[x];
-          squared_sum += squared_dists[x];
-        }
+        // Step 2
+        if (upper_bounds[x] <= half_min_cluster_dists[c_x]) return;
 
-        // Fill each empty cluster by selecting a point with kmeans++, removing
-        // that point from its current cluster, then adding it to the empty
-        // cluster.
-        for (std::size_t i = 0; i < empty_clusters.size(); ++i) {
-          double selection = std_unif(rng());
-          nda::index_t x = InitPlusPlusIter(
-            data, &squared_dists, &squared_sum, selection);
-          MeanId old_c = (*assignments)[x];
-          MeanId new_c = empty_clusters[i];
-
-          (*means)(old_c, nda::all) -= data(x, nda::all);
-          (*means)(new_c, nda::all) += data(x, nda::all);
-
-          cluster_counts[old_c] += -1;
-          cluster_counts[new_c] += 1;
-        }
-      }
-      for (auto i : means->i()) {
-        for (auto j : means->j()) {
-          (*means)(i, j) /= cluster_counts[i];
-        }
-      }
-      if (verbose) t.Reset(std::cout << "step 4") << std::endl;
+        double upper_bound = upper_bounds[x];
+        for (MeanId c = 0; c < k_; ++c) {
+          // Step 3(i)
+          if (c == c_x) continue;
+
+          // Step 3(ii)
+          if (upper_bound <= lower_bounds(x, c)) continue;
+
+          // Step 3(iii)
+          if (upper_bound <= cluster_dists(c_x, c)/2) continue;
+
+          // Step 3a
+          if (upper_bound_loose[x]) {
+            upper_bound = Distance<T, Precision>::Compute(
+                data(x, nda::all), (*clusters)(c_x, nda::all));
+            lower_bounds(x, c_x) = RoundDown(upper_bound);
+            upper_bound_loose[x] = false;
+          }
+
+          // Step 3b
+          if (upper_bound > lower_bounds(x, c) ||
+              upper_bound > cluster_dists(c_x, c)/2) {
+            double x_c_dist = Distance<T, Precision>::Compute(
+                data(x, nda::all), (*clusters)(c, nda::all));
+            lower_bounds(x, c) = RoundDown(x_c_dist);
+            if (x_c_dist < upper_bound) {
+              c_x = c;
+              upper_bound = x_c_dist;
+            }
+          }
+        }  // for c
+        upper_bounds[x] = RoundUp(upper_bound);
+        upper_bound_loose[x] = upper_bounds[x] != upper_bound;
+      });  // ForEachPoint
+      time_step(&elkan_times_.bounds, "step 2,3");
+
+      // Step 4
+      std::unique_ptr<nda::matrix<Precision>> means = UpdateMeans(
+          data, *clusters, *assignments, &rng, verbose);
+      time_step(&elkan_times_.means, "step 4");
 
       // Step 5
-      std::vector<double> cluster_to_means(k_);
-      for (MeanId c = 0; c < k_; ++c) {
-        cluster_to_means[c] = Distance<double, double>::Compute(
-            (*clusters)(c, nda::all), (*means)(c, nda::all));
-      }
-      for (uint32_t thread = 0; thread < n_threads; ++thread) {
-        threads[thread] = std::thread([&, thread]() {
-              for (nda::index_t x = thread; x < data.rows(); x += n_threads) {
-                for (MeanId c = 0; c < k_; ++c) {
-                  double dist_diff = lower_bounds(x, c) - cluster_to_means[c];
-                  lower_bounds(x, c) = std::max(dist_diff, 0.0);
-                }  // for c
-              }  // for x
-            }  // [&, thread]()
-        );  // std::thread  NOLINT(whitespace/parens)
-      }  // for thread
-      for (uint32_t thread = 0; thread < n_threads; ++thread) {
-        threads[thread].join();
-      }  // for thread
-      if (verbose) t.Reset(std::cout << "step 5: ") << std::endl;
+      std::vector<double> cluster_to_means = Drift(*clusters, *means);
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
+        for (MeanId c = 0; c < k_; ++c) {
+          double dist_diff = lower_bounds(x, c) - cluster_to_means[c];
+          lower_bounds(x, c) = RoundDown(std::max(dist_diff, 0.0));
+        }  // for c
+      });  // ForEachPoint
+      time_step(&elkan_times_.lower_bounds, "step 5");
 
       // Step 6
-      for (nda::index_t x = 0; x < data.rows(); ++x) {
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
         MeanId c_x = (*assignments)[x];
-        upper_bounds[x] = upper_bounds[x] + cluster_to_means[c_x];
+        upper_bounds[x] = RoundUp(upper_bounds[x] + cluster_to_means[c_x]);
         upper_bound_loose[x] = true;
-      }
-      if (verbose) t.Reset(std::cout << "step 6: ") << std::endl;
+      });  // ForEachPoint
+      time_step(&elkan_times_.upper_bounds, "step 6");
 
       // Step 7
       converged = (*clusters) == (*means);
       clusters = std::move(means);
-      loss = ComputeLoss(data, *clusters, *assignments);
-      if (verbose) t.Reset(std::cout << "step 7") << std::endl;
+      // The loss is only needed at the end unless it is being printed
+      if (converged || verbose) {
+        loss = ComputeLoss(data, *clusters, *assignments);
+      }
+      time_step(&elkan_times_.loss, "step 7");
 
       iteration += 1;
       if (verbose) {
@@ -370,8 +387,443 @@ class KMeans {
     clusters_ = std::move(clusters);
     assignments_ = std::move(assignments);
     loss_ = loss;
+    iterations_ = iteration;
   }  // Elkan()
 
+  /*
+    @brief Run kmeans clustering with the given bounds.
+
+    @param data The data points to cluster.
+    @param bounds The bounds to skip distance computations with.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for assigning empty clusters and initializing
+        clusters if they are not already initialized.
+  */
+  void Cluster(nda::const_matrix_ref<T> data, BoundProc bounds,
+               bool verbose = false, Random::Seed seed = Random::Seed()) {
+    switch (bounds) {
+      case kElkan:
+        Elkan(data, verbose, seed);
+        break;
+      case kYinyang:
+        Yinyang(data, verbose, seed);
+        break;
+      case kHamerly:
+        Hamerly(data, verbose, seed);
+        break;
+    }  // switch (bounds)
+  }  // Cluster()
+
+  /*
+    @brief Run kmeans clustering with Hamerly's algorithm, which keeps an
+        upper bound of the distance from each point to its cluster and a
+        single lower bound of the distance to every other cluster.
+
+    @param data The data points to cluster.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for assigning empty clusters and initializing
+        clusters if they are not already initialized.
+  */
+  void Hamerly(nda::const_matrix_ref<T> data, bool verbose = false,
+               Random::Seed seed = Random::Seed()) {
+    if (clusters_ == nullptr) {
+      InitPlusPlus(data, verbose, seed);
+    }
+    auto clusters = std::make_unique<nda::matrix<Precision>>(*clusters_);
+    Random rng(seed);
+
+    // Assign each point to its closest cluster, and bound the distance to the
+    // second closest cluster
+    std::vector<Precision> upper_bounds(data.rows());
+    std::vector<Precision> lower_bounds(data.rows());
+    auto assignments = std::make_unique<std::vector<MeanId>>(data.rows());
+    ForEachPoint(data.rows(), [&](nda::index_t x) {
+      double nearest_dist, second_dist;
+      NearestTwo(data(x, nda::all), *clusters, &(*assignments)[x],
+                 &nearest_dist, &second_dist);
+      upper_bounds[x] = RoundUp(nearest_dist);
+      lower_bounds[x] = RoundDown(second_dist);
+    });
+    if (verbose) {
+      std::cout << "initialized data structures" << std::endl;
+    }
+
+    CombinationMatrix<double> cluster_dists(k_);
+    std::vector<double> half_min_cluster_dists(k_);
+    bool converged = false;
+    uint32_t iteration = 0;
+    Timer t;
+    while (!converged) {
+      ClusterDists(*clusters, &cluster_dists, &half_min_cluster_dists);
+
+      // A point keeps its cluster if its upper bound is below both its lower
+      // bound and half the distance from its cluster to the closest other
+      // cluster. Otherwise tighten the upper bound, and if that is not enough,
+      // compute the distance to every cluster.
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
+        MeanId& c_x = (*assignments)[x];
+        double bound = std::max<double>(half_min_cluster_dists[c_x],
+                                        lower_bounds[x]);
+        if (upper_bounds[x] <= bound) return;
+        double nearest_dist = Distance<T, Precision>::Compute(
+            data(x, nda::all), (*clusters)(c_x, nda::all));
+        if (nearest_dist > bound) {
+          double second_dist;
+          NearestTwo(data(x, nda::all), *clusters, &c_x, &nearest_dist,
+                     &second_dist);
+          lower_bounds[x] = RoundDown(second_dist);
+        }
+        upper_bounds[x] = RoundUp(nearest_dist);
+      });
+      if (verbose) t.Reset(std::cout << "assignment: ") << std::endl;
+
+      std::unique_ptr<nda::matrix<Precision>> means = UpdateMeans(
+          data, *clusters, *assignments, &rng, verbose);
+
+      // Move the bounds by how far the clusters moved. The lower bound moves
+      // by the largest drift of any cluster besides the point's own.
+      std::vector<double> drift = Drift(*clusters, *means);
+      MeanId max_c = std::max_element(drift.begin(), drift.end()) -
+                     drift.begin();
+      double second_max_drift = 0;
+      for (MeanId c = 0; c < k_; ++c) {
+        if (c != max_c) second_max_drift = std::max(second_max_drift, drift[c]);
+      }
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
+        MeanId c_x = (*assignments)[x];
+        upper_bounds[x] = RoundUp(upper_bounds[x] + drift[c_x]);
+        lower_bounds[x] = RoundDown(
+            lower_bounds[x] - (c_x == max_c ? second_max_drift : drift[max_c]));
+      });
+
+      converged = (*clusters) == (*means);
+      clusters = std::move(means);
+      iteration += 1;
+      if (verbose) {
+        t.Reset(std::cout << "computed iteration " << iteration << ": ")
+            << ", converged: " << converged << std::endl;
+      }
+    }  // while !converged
+
+    loss_ = ComputeLoss(data, *clusters, *assignments);
+    clusters_ = std::move(clusters);
+    assignments_ = std::move(assignments);
+    iterations_ = iteration;
+  }  // Hamerly()
+
+  /*
+    @brief Run kmeans clustering with the Yinyang algorithm. The clusters are
+        split into groups of about kYinyangGroupSize by clustering the initial
+        clusters, and each point keeps an upper bound of the distance to its
+        cluster and a lower bound of the distance to each group.
+
+    @param data The data points to cluster.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for assigning empty clusters and initializing
+        clusters if they are not already initialized.
+  */
+  void Yinyang(nda::const_matrix_ref<T> data, bool verbose = false,
+               Random::Seed seed = Random::Seed()) {
+    if (clusters_ == nullptr) {
+      InitPlusPlus(data, verbose, seed);
+    }
+    auto clusters = std::make_unique<nda::matrix<Precision>>(*clusters_);
+    Random rng(seed);
+
+    const MeansN n_groups = NumGroups(k_);
+    std::vector<MeanId> group_of = GroupClusters(*clusters, n_groups);
+    std::vector<std::vector<MeanId>> groups(n_groups);
+    for (MeanId c = 0; c < k_; ++c) groups[group_of[c]].push_back(c);
+
+    // Assign each point to its closest cluster, and set the lower bound of
+    // each group to the distance to its closest cluster besides the point's
+    std::vector<Precision> upper_bounds(data.rows());
+    nda::matrix<Precision> lower_bounds({data.rows(), n_groups}, INFINITY);
+    auto assignments = std::make_unique<std::vector<MeanId>>(data.rows());
+    // Each block reuses one buffer for the distances of its points
+    ForEachBlock(data.rows(), NumThreads(data.rows()),
+                 [&](nda::index_t, nda::index_t begin, nda::index_t end) {
+      std::vector<double> dists(k_);
+      for (nda::index_t x = begin; x < end; ++x) {
+        for (MeanId c = 0; c < k_; ++c) {
+          dists[c] = Distance<T, Precision>::Compute(
+              data(x, nda::all), (*clusters)(c, nda::all));
+        }
+        MeanId c_x = std::min_element(dists.begin(), dists.end()) -
+                     dists.begin();
+        (*assignments)[x] = c_x;
+        upper_bounds[x] = RoundUp(dists[c_x]);
+        for (MeanId c = 0; c < k_; ++c) {
+          if (c == c_x) continue;
+          lower_bounds(x, group_of[c]) = std::min(
+              lower_bounds(x, group_of[c]), RoundDown(dists[c]));
+        }
+      }
+    });
+    if (verbose) {
+      std::cout << "initialized data structures with " << n_groups
+                << " groups" << std::endl;
+    }
+
+    bool converged = false;
+    uint32_t iteration = 0;
+    Timer t;
+    while (!converged) {
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
+        MeanId& c_x = (*assignments)[x];
+
+        // Global filter: the point keeps its cluster if its upper bound is
+        // below the lower bound of every group
+        double global_lower_bound = INFINITY;
+        for (MeanId g = 0; g < n_groups; ++g) {
+          global_lower_bound = std::min<double>(global_lower_bound,
+                                                lower_bounds(x, g));
+        }
+        if (upper_bounds[x] <= global_lower_bound) return;
+        double upper_bound = Distance<T, Precision>::Compute(
+            data(x, nda::all), (*clusters)(c_x, nda::all));
+
+        // Group filter: only search the groups whose lower bound is below the
+        // distance to the closest cluster found so far
+        for (MeanId g = 0; g < n_groups && upper_bound > global_lower_bound;
+             ++g) {
+          if (upper_bound <= lower_bounds(x, g)) continue;
+          MeanId group_nearest = c_x;
+          double first = INFINITY;
+          double second = INFINITY;
+          for (MeanId c : groups[g]) {
+            if (c == c_x) continue;
+            double dist = Distance<T, Precision>::Compute(
+                data(x, nda::all), (*clusters)(c, nda::all));
+            if (dist < first) {
+              second = first;
+              first = dist;
+              group_nearest = c;
+            } else if (dist < second) {
+              second = dist;
+            }
+          }  // for c
+          if (first < upper_bound) {
+            // The old cluster becomes a candidate for its group's lower bound
+            MeanId old_group = group_of[c_x];
+            if (old_group == g) {
+              lower_bounds(x, g) = RoundDown(std::min(second, upper_bound));
+            } else {
+              lower_bounds(x, old_group) = std::min(lower_bounds(x, old_group),
+                                                    RoundDown(upper_bound));
+              lower_bounds(x, g) = RoundDown(second);
+            }
+            c_x = group_nearest;
+            upper_bound = first;
+          } else {
+            lower_bounds(x, g) = RoundDown(first);
+          }
+        }  // for g
+        upper_bounds[x] = RoundUp(upper_bound);
+      });
+      if (verbose) t.Reset(std::cout << "assignment: ") << std::endl;
+
+      std::unique_ptr<nda::matrix<Precision>> means = UpdateMeans(
+          data, *clusters, *assignments, &rng, verbose);
+
+      // Move the bounds by how far the clusters moved. The lower bound of a
+      // group moves by the largest drift of any cluster in the group.
+      std::vector<double> drift = Drift(*clusters, *means);
+      std::vector<double> group_drift(n_groups, 0);
+      for (MeanId c = 0; c < k_; ++c) {
+        group_drift[group_of[c]] = std::max(group_drift[group_of[c]], drift[c]);
+      }
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
+        upper_bounds[x] = RoundUp(upper_bounds[x] +
+                                  drift[(*assignments)[x]]);
+        for (MeanId g = 0; g < n_groups; ++g) {
+          lower_bounds(x, g) = RoundDown(
+              std::max(lower_bounds(x, g) - group_drift[g], 0.0));
+        }
+      });
+
+      converged = (*clusters) == (*means);
+      clusters = std::move(means);
+      iteration += 1;
+      if (verbose) {
+        t.Reset(std::cout << "computed iteration " << iteration << ": ")
+            << ", converged: " << converged << std::endl;
+      }
+    }  // while !converged
+
+    loss_ = ComputeLoss(data, *clusters, *assignments);
+    clusters_ = std::move(clusters);
+    assignments_ = std::move(assignments);
+    iterations_ = iteration;
+  }  // Yinyang()
+
+  /*
+    @brief Run mini-batch kmeans, which moves the clusters towards small random
+        batches of points instead of all of the points, then assign every point
+        to its closest cluster. Unlike Elkan, this does not store any bounds
+        per point, so it only needs memory for the data and assignments.
+
+    @param data The data points to cluster.
+    @param batch_size The number of points in each batch.
+    @param iterations The number of batches to use.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for sampling batches and initializing clusters if
+        they are not already initialized. The clusters are initialized with
+        kmeans++ on a sample of 3 * batch_size points.
+  */
+  void MiniBatch(nda::const_matrix_ref<T> data, nda::index_t batch_size,
+                 uint32_t iterations, bool verbose = false,
+                 Random::Seed seed = Random::Seed()) {
+    Random rng(seed);
+    std::uniform_int_distribution<uint32_t> seed_gen;
+    if (clusters_ == nullptr) {
+      nda::matrix<T> init_sample = SampleRows(data, 3 * batch_size,
+                                              Random::Seed(seed_gen(rng())));
+      InitPlusPlus(init_sample, verbose, Random::Seed(seed_gen(rng())));
+    }
+    nda::matrix<Precision>& clusters = *clusters_;
+
+    batch_size = std::min(batch_size, data.rows());
+    std::uniform_int_distribution<nda::index_t> choose_point(0,
+                                                             data.rows() - 1);
+    std::vector<nda::index_t> batch(batch_size);
+    std::vector<MeanId> batch_assignments(batch_size);
+    std::vector<nda::size_t> cluster_counts(k_, 0);
+
+    Timer t;
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+      for (nda::index_t& x : batch) x = choose_point(rng());
+
+      // Assign the batch to the current clusters
+      ForEachPoint(batch_size, [&](nda::index_t b) {
+        batch_assignments[b] = Nearest(data(batch[b], nda::all),
+                                       clusters).first;
+      });
+
+      // Move each cluster towards its points with a learning rate of 1 over
+      // the number of points it has been assigned so far
+      for (nda::index_t b = 0; b < batch_size; ++b) {
+        MeanId c = batch_assignments[b];
+        cluster_counts[c] += 1;
+        double learning_rate = 1.0 / cluster_counts[c];
+        for (nda::index_t j = 0; j < data.columns(); ++j) {
+          double diff = data(batch[b], j) - clusters(c, j);
+          clusters(c, j) += learning_rate * diff;
+        }
+      }  // for b
+
+      if (verbose && (iteration + 1) % 100 == 0) {
+        t.Reset(std::cout << "computed batch " << iteration + 1 << ": ")
+            << std::endl;
+      }
+    }  // for iteration
+
+    Assign(data, verbose);
+  }  // MiniBatch()
+
+  /*
+    @brief Run kmeans on a random sample of the data points with several
+        restarts of Elkan's algorithm, then assign every point to its closest
+        cluster. Elkan's bounds are only stored for the sample.
+
+    @param data The data points to cluster.
+    @param sample_size The number of points to sample without replacement.
+    @param restarts The number of times to run kmeans on the sample.
+    @param initializer The algorithm to use to genereate the initial clusters.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for sampling, assigning empty clusters, and
+        initializing clusters.
+    @param bounds The bounds to run kmeans on the sample with.
+    @param memory_budget The memory budget of the concurrent restarts on the
+        sample. See MultipleRestarts.
+  */
+  void Subsample(nda::const_matrix_ref<T> data, nda::index_t sample_size,
+                 uint32_t restarts, InitProc initializer = kPlusPlus,
+                 bool verbose = false, Random::Seed seed = Random::Seed(),
+                 BoundProc bounds = kElkan, std::size_t memory_budget = 0) {
+    Random rng(seed);
+    std::uniform_int_distribution<uint32_t> seed_gen;
+    nda::matrix<T> sample = SampleRows(data, sample_size,
+                                       Random::Seed(seed_gen(rng())));
+    if (verbose) {
+      std::cout << "sampled " << sample.rows() << " points" << std::endl;
+    }
+    MultipleRestarts(sample, restarts, initializer, verbose,
+                     Random::Seed(seed_gen(rng())), bounds, memory_budget);
+    Assign(data, verbose);
+  }  // Subsample()
+
+  /*
+    @brief Re-cluster starting from the clusters of an earlier run instead of
+        from scratch, for when the data points or k have changed a little.
+        The previous clusters are split or merged to reach k (see WarmStart)
+        and then kmeans runs once, with no restarts.
+
+    @param data The data points to cluster.
+    @param previous The clusters of the earlier run.
+    @param bounds The bounds to run kmeans with.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for sampling, splitting clusters, and assigning
+        empty clusters.
+    @param sample_size If not 0, kmeans runs on a random sample of this many
+        points, and then every point is assigned to its closest cluster, as in
+        Subsample.
+  */
+  void Recluster(nda::const_matrix_ref<T> data,
+                 const nda::matrix<Precision>& previous,
+                 BoundProc bounds = kElkan, bool verbose = false,
+                 Random::Seed seed = Random::Seed(),
+                 nda::index_t sample_size = 0) {
+    Random rng(seed);
+    std::uniform_int_distribution<uint32_t> seed_gen;
+    if (sample_size == 0) {
+      WarmStart(data, previous, verbose, Random::Seed(seed_gen(rng())));
+      Cluster(data, bounds, verbose, Random::Seed(seed_gen(rng())));
+      return;
+    }
+    nda::matrix<T> sample = SampleRows(data, sample_size,
+                                       Random::Seed(seed_gen(rng())));
+    if (verbose) {
+      std::cout << "sampled " << sample.rows() << " points" << std::endl;
+    }
+    WarmStart(sample, previous, verbose, Random::Seed(seed_gen(rng())));
+    Cluster(sample, bounds, verbose, Random::Seed(seed_gen(rng())));
+    Assign(data, verbose);
+  }  // Recluster()
+
+  /*
+    @brief Assign every data point to its closest cluster and compute the
+        loss of the assignment. The clusters must already be initialized.
+
+    @param data The data points to assign.
+    @param verbose Print diagnostics information.
+  */
+  void Assign(nda::const_matrix_ref<T> data, bool verbose = false) {
+    auto assignments = std::make_unique<std::vector<MeanId>>(data.rows());
+    const nda::index_t n_blocks = NumBlocks(data.rows());
+    std::vector<double> block_sums(n_blocks, 0);
+    ForEachBlock(data.rows(), n_blocks,
+                 [&](nda::index_t b, nda::index_t begin, nda::index_t end) {
+      double block_sum = 0;
+      for (nda::index_t x = begin; x < end; ++x) {
+        std::pair<MeanId, double> nearest = Nearest(data(x, nda::all),
+                                                    *clusters_);
+        (*assignments)[x] = nearest.first;
+        block_sum += nearest.second * nearest.second;
+      }
+      block_sums[b] = block_sum;
+    });
+
+    double squared_sum = 0;
+    for (double block_sum : block_sums) squared_sum += block_sum;
+    assignments_ = std::move(assignments);
+    loss_ = squared_sum / data.rows();
+    if (verbose) {
+      std::cout << "assigned " << data.rows() << " points, loss: "
+                << std::setprecision(17) << loss_ << std::endl;
+    }
+  }  // Assign()
+
   /*
     @brief Initialize clusters with the kmeans++ algorithm.
 
@@ -380,8 +832,9 @@ class KMeans {
     @param seed Seed to use for the random number generation. If no seed is
         passed then a random one is chosen.
   */
-  void InitPlusPlus(const nda::matrix<T>& data, bool verbose = false,
+  void InitPlusPlus(nda::const_matrix_ref<T> data, bool verbose = false,
                     Random::Seed seed = Random::Seed()) {
+    Timer t;
     Random rng(seed);
     std::uniform_real_distribution<> std_unif(0.0, 1.0);
 
@@ -404,14 +857,151 @@ class KMeans {
       }
     }  // for c
 
-    // Copy the values of the cluster data points into a new Matrix
-    auto filled_clusters = std::make_unique<nda::matrix<double>>(
-        nda::matrix_shape<>{k_, data.columns()});
+    SetClusters(data, clusters);
+    if (verbose) PrintInitLoss(squared_sum / data.rows(), &t);
+  }  // InitPlusPlus()
+
+  /*
+    @brief Initialize clusters with the kmeans++ algorithm, splitting each pass
+        over the data points between the hardware threads. The squared
+        distances are summed in blocks, so a point is chosen by finding its
+        block from the block sums and then scanning only that block.
+
+    @param data The data points to select from.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for the random number generation. If no seed is
+        passed then a random one is chosen.
+  */
+  void ParallelInitPlusPlus(nda::const_matrix_ref<T> data, bool verbose = false,
+                            Random::Seed seed = Random::Seed()) {
+    Timer t;
+    Random rng(seed);
+    std::uniform_real_distribution<> std_unif(0.0, 1.0);
+
+    std::vector<double> squared_dists(data.rows(), INFINITY);
+    std::vector<double> block_sums(NumBlocks(data.rows()));
+    std::vector<uint32_t> nearest(data.rows(), 0);
+    std::vector<nda::index_t> clusters;
+    double squared_sum = 0;
     for (MeanId c = 0; c < k_; ++c) {
-      (*filled_clusters)(c, nda::all).copy_elems(data(clusters[c], nda::all));
+      // The first cluster is chosen uniformly at random
+      double selection = std_unif(rng());
+      clusters.push_back(c == 0 ? UniformRow(selection, data.rows()) :
+          SampleSquaredDists(squared_dists, block_sums, selection));
+      squared_sum = UpdateSquaredDists(data, clusters, c, &squared_dists,
+                                       &block_sums, &nearest);
+      if (verbose) {
+        std::cout << "assigned cluster " << c;
+        std::cout << ": " << clusters[c] << std::endl;
+      }
+    }  // for c
+
+    SetClusters(data, clusters);
+    if (verbose) PrintInitLoss(squared_sum / data.rows(), &t);
+  }  // ParallelInitPlusPlus()
+
+  /*
+    @brief Initialize clusters with the kmeans|| algorithm (Bahmani et al.
+        2012). Starting from one random point, each of kScalableRounds
+        parallel passes samples every point independently with probability
+        proportional to its squared distance to the candidates so far, for
+        about kScalableOversampling * k new candidates per pass. Each
+        candidate is weighted by the number of points closest to it, and
+        weighted kmeans++ on the candidates chooses the clusters.
+
+    @param data The data points to select from.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for the random number generation. If no seed is
+        passed then a random one is chosen.
+  */
+  void ScalableInit(nda::const_matrix_ref<T> data, bool verbose = false,
+                    Random::Seed seed = Random::Seed()) {
+    Timer t;
+    Random rng(seed);
+    std::uniform_real_distribution<> std_unif(0.0, 1.0);
+    std::uniform_int_distribution<uint32_t> seed_gen;
+    const nda::index_t rows = data.rows();
+    const nda::index_t n_blocks = NumBlocks(rows);
+    const double oversampling = kScalableOversampling * k_;
+
+    // Start from one point chosen uniformly at random
+    std::vector<nda::index_t> candidates{UniformRow(std_unif(rng()), rows)};
+    std::vector<double> squared_dists(rows, INFINITY);
+    std::vector<double> block_sums(n_blocks);
+    std::vector<uint32_t> nearest(rows, 0);
+    double potential = UpdateSquaredDists(data, candidates, 0,
+                                          &squared_dists, &block_sums,
+                                          &nearest);
+
+    for (uint32_t round = 0; round < kScalableRounds && potential > 0;
+         ++round) {
+      // Each block samples with its own generator so that the candidates do
+      // not depend on the number of threads
+      std::vector<uint32_t> block_seeds(n_blocks);
+      for (uint32_t& block_seed : block_seeds) block_seed = seed_gen(rng());
+      std::vector<std::vector<nda::index_t>> block_candidates(n_blocks);
+      ForEachBlock(rows, n_blocks,
+                   [&](nda::index_t b, nda::index_t begin, nda::index_t end) {
+        Random block_rng(Random::Seed(block_seeds[b]));
+        std::uniform_real_distribution<> block_unif(0.0, 1.0);
+        for (nda::index_t x = begin; x < end; ++x) {
+          if (block_unif(block_rng()) * potential <
+              oversampling * squared_dists[x]) {
+            block_candidates[b].push_back(x);
+          }
+        }
+      });
+
+      const std::size_t first_new = candidates.size();
+      for (const std::vector<nda::index_t>& block : block_candidates) {
+        candidates.insert(candidates.end(), block.begin(), block.end());
+      }
+      potential = UpdateSquaredDists(data, candidates, first_new,
+                                     &squared_dists, &block_sums, &nearest);
+      if (verbose) {
+        std::cout << "kmeans|| round " << round << ": " << candidates.size()
+                  << " candidates, loss: " << potential / rows << std::endl;
+      }
+    }  // for round
+
+    std::vector<nda::index_t> clusters;
+    if (candidates.size() <= k_) {
+      clusters = candidates;
+    } else {
+      // Weight each candidate by the number of points closest to it
+      std::vector<std::vector<uint64_t>> block_counts(n_blocks);
+      ForEachBlock(rows, n_blocks,
+                   [&](nda::index_t b, nda::index_t begin, nda::index_t end) {
+        block_counts[b].resize(candidates.size(), 0);
+        for (nda::index_t x = begin; x < end; ++x) {
+          block_counts[b][nearest[x]] += 1;
+        }
+      });
+      std::vector<double> weights(candidates.size(), 0);
+      for (const std::vector<uint64_t>& counts : block_counts) {
+        for (std::size_t i = 0; i < counts.size(); ++i) {
+          weights[i] += counts[i];
+        }
+      }
+      clusters = WeightedPlusPlus(data, candidates, weights, &rng);
+      std::fill(squared_dists.begin(), squared_dists.end(), INFINITY);
+      std::fill(nearest.begin(), nearest.end(), 0);
+      potential = UpdateSquaredDists(data, clusters, 0, &squared_dists,
+                                     &block_sums, &nearest);
+    }
+
+    // If there were fewer candidates than clusters, choose the rest with
+    // kmeans++ over all of the points
+    while (clusters.size() < k_) {
+      clusters.push_back(SampleSquaredDists(squared_dists, block_sums,
+                                            std_unif(rng())));
+      potential = UpdateSquaredDists(data, clusters, clusters.size() - 1,
+                                     &squared_dists, &block_sums, &nearest);
     }
-    clusters_ = std::move(filled_clusters);
-  }  // InitPlusPlus()
+
+    SetClusters(data, clusters);
+    if (verbose) PrintInitLoss(potential / rows, &t);
+  }  // ScalableInit()
 
   /*
     @brief Initialize clusters whose sum is the same as the data elements.
@@ -420,7 +1010,7 @@ class KMeans {
     @param seed Seed to use for the random number generation. If no seed is
         passed then a random one is chosen.
   */
-  void RandomSumInit(const nda::matrix<T>& data,
+  void RandomSumInit(nda::const_matrix_ref<T> data,
                      Random::Seed seed = Random::Seed()) {
     T row_sum = 0;
     for (nda::index_t j = 0; j < data.columns(); ++j) {
@@ -432,7 +1022,7 @@ class KMeans {
         0, data.columns() - 1);
     std::uniform_real_distribution<double> choose_amount(0.0, row_sum + 1);
 
-    auto clusters = std::make_unique<nda::matrix<double>>(
+    auto clusters = std::make_unique<nda::matrix<Precision>>(
         nda::matrix_shape<>{k_, data.columns()});
 
     // Assign each cluster
@@ -459,12 +1049,12 @@ class KMeans {
     @param seed Seed to use for the random number generation. If no seed is
         passed then a random one is chosen.
   */
-  void RandomProbInit(const nda::matrix<T>& data,
+  void RandomProbInit(nda::const_matrix_ref<T> data,
                       Random::Seed seed = Random::Seed()) {
     Random rng(seed);
     std::uniform_real_distribution<double> choose_amount(0.0, 1.0);
 
-    auto clusters = std::make_unique<nda::matrix<double>>(
+    auto clusters = std::make_unique<nda::matrix<Precision>>(
         nda::matrix_shape<>{k_, data.columns()});
 
     // Assign each cluster
@@ -477,7 +1067,99 @@ class KMeans {
     clusters_ = std::move(clusters);
   }  // RandomProbInit()
 
-  const nda::matrix<double>* clusters() const {
+  /*
+    @brief Initialize clusters from the clusters of an earlier run, such as a
+        run on an older version of the data or with a different k, so that
+        clustering starts near a fixed point and converges in a few
+        iterations. Every point is first assigned to its nearest previous
+        cluster.
+
+        If there are fewer previous clusters than k, the missing clusters are
+        split off the previous ones by continuing kmeans++ from them: each new
+        cluster is a point chosen with probability proportional to its
+        squared distance to the nearest cluster so far, so most of them land
+        in the clusters with the most loss. If there are more, the two
+        clusters whose merge adds the least loss (Ward's criterion,
+        d(a, b)^2 n_a n_b / (n_a + n_b), where n is the number of points in a
+        cluster) are merged into their weighted mean until k are left.
+
+    @param data The data points.
+    @param previous The clusters of the earlier run, which must have as many
+        columns as the data points.
+    @param verbose Print diagnostics information.
+    @param seed Seed to use for choosing the points of split clusters. If no
+        seed is passed then a random one is chosen.
+  */
+  void WarmStart(nda::const_matrix_ref<T> data,
+                 const nda::matrix<Precision>& previous, bool verbose = false,
+                 Random::Seed seed = Random::Seed()) {
+    if (previous.rows() == 0 || previous.columns() != data.columns()) {
+      std::string func{__func__};
+      throw std::invalid_argument(func + " previous clusters have " +
+          std::to_string(previous.rows()) + " rows and " +
+          std::to_string(previous.columns()) + " columns, but the data " +
+          "points have " + std::to_string(data.columns()) + " columns.");
+    }
+    Timer t;
+    const MeanId n_previous = previous.rows();
+    const nda::index_t n_blocks = NumBlocks(data.rows());
+    std::vector<MeanId> nearest(data.rows());
+    std::vector<double> squared_dists(data.rows());
+    std::vector<double> block_sums(n_blocks);
+    ForEachBlock(data.rows(), n_blocks,
+                 [&](nda::index_t b, nda::index_t begin, nda::index_t end) {
+      double block_sum = 0;
+      for (nda::index_t x = begin; x < end; ++x) {
+        std::pair<MeanId, double> nearest_previous =
+            Nearest(data(x, nda::all), previous);
+        nearest[x] = nearest_previous.first;
+        squared_dists[x] = nearest_previous.second *
+                           nearest_previous.second;
+        block_sum += squared_dists[x];
+      }
+      block_sums[b] = block_sum;
+    });
+
+    auto clusters = std::make_unique<nda::matrix<Precision>>(
+        nda::matrix_shape<>{k_, data.columns()});
+    if (n_previous <= k_) {
+      for (MeanId c = 0; c < n_previous; ++c) {
+        (*clusters)(c, nda::all).copy_elems(previous(c, nda::all));
+      }
+      Random rng(seed);
+      std::uniform_real_distribution<> std_unif(0.0, 1.0);
+      for (MeanId c = n_previous; c < k_; ++c) {
+        nda::index_t split = SampleSquaredDists(squared_dists, block_sums,
+                                                std_unif(rng()));
+        (*clusters)(c, nda::all).copy_elems(data(split, nda::all));
+        ForEachBlock(data.rows(), n_blocks,
+                     [&](nda::index_t b, nda::index_t begin,
+                         nda::index_t end) {
+          double block_sum = 0;
+          for (nda::index_t x = begin; x < end; ++x) {
+            double new_dist = Distance<T, T>::Compute(data(split, nda::all),
+                                                      data(x, nda::all));
+            squared_dists[x] = std::min(squared_dists[x],
+                                        new_dist * new_dist);
+            block_sum += squared_dists[x];
+          }
+          block_sums[b] = block_sum;
+        });
+      }  // for c
+    } else {
+      MergeClusters(previous, nearest, clusters.get());
+    }
+    clusters_ = std::move(clusters);
+
+    if (verbose) {
+      std::cout << (n_previous <= k_ ? "split " : "merged ")
+                << (n_previous <= k_ ? k_ - n_previous : n_previous - k_)
+                << " of " << n_previous << " previous clusters in "
+                << t.Check<Timer::Seconds>() << " s" << std::endl;
+    }
+  }  // WarmStart()
+
+  const nda::matrix<Precision>* clusters() const {
     return clusters_.get();
   }
 
@@ -489,7 +1171,95 @@ class KMeans {
     return loss_;
   }
 
+  /* @brief Number of iterations the last run of Elkan, Yinyang, or Hamerly
+         took to converge. */
+  uint32_t iterations() const {
+    return iterations_;
+  }
+
+  const ElkanTimes& elkan_times() const {
+    return elkan_times_;
+  }
+
+  /*
+    @brief Limits the number of threads clustering uses.
+
+    @param max_threads The most threads to use. 0 means every hardware thread.
+        Concurrent restarts split this many threads between them.
+  */
+  void SetMaxThreads(uint32_t max_threads) {
+    max_threads_ = max_threads;
+  }
+
+  /*
+    @brief Returns the number of bytes of per point state (assignments and
+        bounds) that clustering with the given bounds allocates.
+  */
+  static std::size_t BoundBytes(BoundProc bounds, std::size_t rows,
+                                MeansN k) {
+    // Every kind has an assignment and an upper bound
+    std::size_t bytes = rows * (sizeof(MeanId) + sizeof(Precision));
+    switch (bounds) {
+      case kElkan:
+        return bytes + rows * k * sizeof(Precision) + rows * sizeof(uint8_t);
+      case kYinyang:
+        return bytes + rows * NumGroups(k) * sizeof(Precision);
+      case kHamerly:
+        return bytes + rows * sizeof(Precision);
+    }
+    return bytes;
+  }  // BoundBytes()
+
+  /*
+    @brief Returns the number of bytes of per point state that the given
+        initializer allocates. It is freed before clustering starts.
+  */
+  static std::size_t InitBytes(InitProc initializer, std::size_t rows) {
+    switch (initializer) {
+      case kPlusPlus:
+        return rows * sizeof(double);
+      case kParallelPlusPlus:
+      case kScalable:
+        return rows * (sizeof(double) + sizeof(uint32_t));
+      case kRandomSum:
+      case kRandomProb:
+        return 0;
+    }
+    return 0;
+  }  // InitBytes()
+
+  /*
+    @brief Returns the most bytes of per point state that a restart with the
+        given initializer and bounds holds at once.
+  */
+  static std::size_t TrialBytes(InitProc initializer, BoundProc bounds,
+                                std::size_t rows, MeansN k) {
+    return std::max(InitBytes(initializer, rows), BoundBytes(bounds, rows, k));
+  }  // TrialBytes()
+
  private:
+  /* @brief Sets the starting clusters with the given initializer. */
+  void Initialize(nda::const_matrix_ref<T> data, InitProc initializer,
+                  bool verbose, Random::Seed seed) {
+    switch (initializer) {
+      case kPlusPlus:
+        InitPlusPlus(data, verbose, seed);
+        break;
+      case kRandomSum:
+        RandomSumInit(data, seed);
+        break;
+      case kRandomProb:
+        RandomProbInit(data, seed);
+        break;
+      case kParallelPlusPlus:
+        ParallelInitPlusPlus(data, verbose, seed);
+        break;
+      case kScalable:
+        ScalableInit(data, verbose, seed);
+        break;
+    }  // switch (initializer)
+  }  // Initialize()
+
   /*
     @brief Run one iteration of the kmeans++ algorithm.
 
@@ -502,7 +1272,7 @@ class KMeans {
 
     @returns Index of the point in data that is selected to be the new cluster.
   */
-  nda::index_t InitPlusPlusIter(const nda::matrix<T>& data,
+  nda::index_t InitPlusPlusIter(nda::const_matrix_ref<T> data,
                                 std::vector<double>* squared_dists,
                                 double* squared_sum, double selection) {
     nda::index_t new_cluster = 0;
@@ -542,23 +1312,662 @@ class KMeans {
     return new_cluster;
   }  // InitPlusPlusIter()
 
-  double ComputeLoss(const nda::matrix<T>& data,
-                     const nda::matrix<double>& clusters,
-                     const std::vector<MeanId>& assignments) {
+  /* @brief Returns the row that a number on the interval [0,1) selects when
+         every row is equally likely. */
+  static nda::index_t UniformRow(double selection, nda::index_t rows) {
+    return std::min(static_cast<nda::index_t>(selection * rows), rows - 1);
+  }
+
+  /*
+    @brief Lowers the squared distance of every point to its nearest center
+        to account for new centers, splitting the points between the hardware
+        threads. A new center c' is skipped for a point x whose nearest center
+        is c when d(c, c') >= 2 d(x, c), since then d(x, c') >= d(x, c).
+
+    @param data The data points.
+    @param centers Indices of the data points which are centers.
+    @param first_new Index in centers of the first center that is new since
+        the last update. Set all squared distances to INFINITY before the
+        first update.
+    @param squared_dists The squared distance of each point to its nearest
+        center.
+    @param block_sums The sum of squared_dists over each of the NumBlocks
+        blocks of points.
+    @param nearest The index in centers of each point's nearest center.
+
+    @return The sum of the squared distances, added in block order.
+  */
+  double UpdateSquaredDists(nda::const_matrix_ref<T> data,
+                            const std::vector<nda::index_t>& centers,
+                            std::size_t first_new,
+                            std::vector<double>* squared_dists,
+                            std::vector<double>* block_sums,
+                            std::vector<uint32_t>* nearest) const {
+    // Squared distances between every center and each new center, with the
+    // new centers of each center next to each other
+    const std::size_t n_centers = centers.size();
+    const std::size_t n_new = n_centers - first_new;
+    std::vector<double> center_dists(n_centers * n_new);
+    ForEachPoint(n_centers, [&](nda::index_t c) {
+      for (std::size_t i = 0; i < n_new; ++i) {
+        double dist = Distance<T, T>::Compute(
+            data(centers[c], nda::all), data(centers[first_new + i], nda::all));
+        center_dists[c * n_new + i] = dist * dist;
+      }
+    });
+
+    ForEachBlock(data.rows(), block_sums->size(),
+                 [&](nda::index_t b, nda::index_t begin, nda::index_t end) {
+      double block_sum = 0;
+      for (nda::index_t x = begin; x < end; ++x) {
+        double& squared_dist = (*squared_dists)[x];
+        for (std::size_t c = first_new; c < n_centers; ++c) {
+          if (center_dists[(*nearest)[x] * n_new + c - first_new] >=
+              4 * squared_dist) {
+            continue;
+          }
+          double new_dist = Distance<T, T>::Compute(
+              data(centers[c], nda::all), data(x, nda::all));
+          if (new_dist * new_dist < squared_dist) {
+            squared_dist = new_dist * new_dist;
+            (*nearest)[x] = c;
+          }
+        }
+        block_sum += squared_dist;
+      }
+      (*block_sums)[b] = block_sum;
+    });
     double squared_sum = 0;
-    for (nda::index_t x = 0; x < data.rows(); ++x) {
-      MeanId c_x = assignments[x];
-      double dist_to_cluster = Distance<T, double>::Compute(
-          data(x, nda::all), clusters(c_x, nda::all));
-      squared_sum += std::pow(dist_to_cluster, 2);
+    for (double block_sum : *block_sums) squared_sum += block_sum;
+    return squared_sum;
+  }  // UpdateSquaredDists()
+
+  /*
+    @brief Selects a point with probability proportional to its squared
+        distance, first finding its block from the block sums and then
+        scanning that block.
+
+    @param squared_dists The squared distance of each point to its nearest
+        center.
+    @param block_sums The sum of squared_dists over each block of points.
+    @param selection A randomly selected number on the interval [0,1).
+
+    @return The index of the selected point.
+  */
+  static nda::index_t SampleSquaredDists(
+      const std::vector<double>& squared_dists,
+      const std::vector<double>& block_sums, double selection) {
+    const nda::index_t rows = squared_dists.size();
+    const nda::index_t n_blocks = block_sums.size();
+    double squared_sum = 0;
+    for (double block_sum : block_sums) squared_sum += block_sum;
+    // Every point is already a center
+    if (squared_sum == 0) return UniformRow(selection, rows);
+
+    // Find the block, falling back on the last nonempty one in case rounding
+    // puts the selection past the end
+    double remaining = selection * squared_sum;
+    nda::index_t block = -1;
+    for (nda::index_t b = 0; b < n_blocks; ++b) {
+      if (block_sums[b] == 0) continue;
+      block = b;
+      if (remaining < block_sums[b]) break;
+      remaining -= block_sums[b];
+    }
+
+    // Find the point within the block in the same way
+    nda::index_t begin = rows * block / n_blocks;
+    nda::index_t end = rows * (block + 1) / n_blocks;
+    nda::index_t selected = begin;
+    double cumulative = 0;
+    for (nda::index_t x = begin; x < end; ++x) {
+      if (squared_dists[x] == 0) continue;
+      selected = x;
+      cumulative += squared_dists[x];
+      if (remaining < cumulative) break;
     }
+    return selected;
+  }  // SampleSquaredDists()
+
+  /*
+    @brief Chooses k of the given candidates with kmeans++, where each
+        candidate is weighted by the number of points it stands for.
+
+    @param data The data points.
+    @param candidates Indices of the candidate data points.
+    @param weights The weight of each candidate.
+    @param rng Random number generator to use.
+
+    @return Indices of the chosen data points.
+  */
+  std::vector<nda::index_t> WeightedPlusPlus(
+      nda::const_matrix_ref<T> data,
+      const std::vector<nda::index_t>& candidates,
+      const std::vector<double>& weights, Random* rng) const {
+    std::uniform_real_distribution<> std_unif(0.0, 1.0);
+    const std::size_t n = candidates.size();
+    std::vector<double> squared_dists(n, INFINITY);
+    std::vector<nda::index_t> chosen;
+    for (MeanId c = 0; c < k_; ++c) {
+      // The first cluster is chosen by weight alone
+      std::vector<double> mass(n);
+      for (std::size_t i = 0; i < n; ++i) {
+        mass[i] = c == 0 ? weights[i] : weights[i] * squared_dists[i];
+      }
+      double total = 0;
+      for (double m : mass) total += m;
+
+      double remaining = std_unif((*rng)()) * total;
+      std::size_t selected = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        if (mass[i] == 0) continue;
+        selected = i;
+        if (remaining < mass[i]) break;
+        remaining -= mass[i];
+      }
+      chosen.push_back(candidates[selected]);
+
+      ForEachPoint(n, [&](nda::index_t i) {
+        double new_dist = Distance<T, T>::Compute(
+            data(candidates[selected], nda::all),
+            data(candidates[i], nda::all));
+        squared_dists[i] = std::min(squared_dists[i], new_dist * new_dist);
+      });
+    }  // for c
+    return chosen;
+  }  // WeightedPlusPlus()
+
+  /*
+    @brief Merges clusters until k are left, each time merging the two
+        clusters whose merge adds the least loss into their weighted mean.
+
+    @param previous The clusters to merge.
+    @param nearest The previous cluster each data point is closest to, which
+        gives the number of points in each cluster.
+    @param clusters Matrix of k rows to store the merged clusters in.
+  */
+  void MergeClusters(const nda::matrix<Precision>& previous,
+                     const std::vector<MeanId>& nearest,
+                     nda::matrix<Precision>* clusters) const {
+    const MeanId n_previous = previous.rows();
+    nda::matrix<double> centers(
+        nda::matrix_shape<>{n_previous, previous.columns()});
+    for (MeanId c = 0; c < n_previous; ++c) {
+      centers(c, nda::all).copy_elems(previous(c, nda::all));
+    }
+    std::vector<double> counts(n_previous, 0);
+    for (MeanId c : nearest) ++counts[c];
+
+    // Loss added by merging each pair of clusters
+    auto merge_cost = [&](MeanId a, MeanId b) {
+      double n = counts[a] + counts[b];
+      if (n == 0) return 0.0;
+      double dist = Distance<double, double>::Compute(centers(a, nda::all),
+                                                      centers(b, nda::all));
+      return dist * dist * counts[a] * counts[b] / n;
+    };
+    CombinationMatrix<double> costs(n_previous);
+    ForEachPoint(n_previous, [&](nda::index_t a) {
+      for (MeanId b = a + 1; b < n_previous; ++b) {
+        costs(a, b) = merge_cost(a, b);
+      }
+    });
+
+    std::vector<uint8_t> merged(n_previous, false);
+    for (MeanId left = n_previous; left > k_; --left) {
+      MeanId best_a = 0;
+      MeanId best_b = 0;
+      double best_cost = INFINITY;
+      for (MeanId a = 0; a < n_previous; ++a) {
+        if (merged[a]) continue;
+        for (MeanId b = a + 1; b < n_previous; ++b) {
+          if (!merged[b] && costs(a, b) < best_cost) {
+            best_cost = costs(a, b);
+            best_a = a;
+            best_b = b;
+          }
+        }
+      }
+
+      // Merge b into a
+      double n = counts[best_a] + counts[best_b];
+      if (n > 0) {
+        for (nda::index_t j = 0; j < centers.columns(); ++j) {
+          centers(best_a, j) = (counts[best_a] * centers(best_a, j) +
+                                counts[best_b] * centers(best_b, j)) / n;
+        }
+      }
+      counts[best_a] = n;
+      merged[best_b] = true;
+      for (MeanId c = 0; c < n_previous; ++c) {
+        if (c != best_a && !merged[c]) costs(best_a, c) = merge_cost(best_a, c);
+      }
+    }  // for left
+
+    MeanId c = 0;
+    for (MeanId p = 0; p < n_previous; ++p) {
+      if (merged[p]) continue;
+      for (nda::index_t j = 0; j < centers.columns(); ++j) {
+        (*clusters)(c, j) = centers(p, j);
+      }
+      ++c;
+    }
+  }  // MergeClusters()
+
+  /* @brief Sets the clusters to copies of the given data points. */
+  void SetClusters(nda::const_matrix_ref<T> data,
+                   const std::vector<nda::index_t>& points) {
+    auto clusters = std::make_unique<nda::matrix<Precision>>(
+        nda::matrix_shape<>{k_, data.columns()});
+    for (MeanId c = 0; c < k_; ++c) {
+      (*clusters)(c, nda::all).copy_elems(data(points[c], nda::all));
+    }
+    clusters_ = std::move(clusters);
+  }  // SetClusters()
+
+  /* @brief Prints the loss of the initial clusters, which is the mean squared
+         distance of each point to its nearest initial cluster. */
+  static void PrintInitLoss(double loss, Timer* t) {
+    std::cout << "initialization loss: " << std::setprecision(17) << loss
+              << ", initialized in " << t->Check<Timer::Seconds>() << " s"
+              << std::endl;
+  }
+
+  /* Reductions over the data points are split into at most kMaxBlocks
+     contiguous blocks of at least kMinBlockRows points, which are added in
+     order. The result then does not depend on the number of threads, and
+     small data sets are reduced in a single block in the order of the
+     points. */
+  static constexpr nda::index_t kMaxBlocks = 64;
+  static constexpr nda::index_t kMinBlockRows = 1024;
+
+  /* @brief Rounds a distance to Precision, rounding down so that a lower
+         bound stays a lower bound. */
+  static Precision RoundDown(double dist) {
+    Precision rounded = dist;
+    return rounded > dist ? std::nextafter(rounded, Precision{-INFINITY}) :
+                            rounded;
+  }
+
+  /* @brief Rounds a distance to Precision, rounding up so that an upper bound
+         stays an upper bound. */
+  static Precision RoundUp(double dist) {
+    Precision rounded = dist;
+    return rounded < dist ? std::nextafter(rounded, Precision{INFINITY}) :
+                            rounded;
+  }
+
+  /* @brief Returns the number of Yinyang groups for k clusters. */
+  static constexpr MeansN NumGroups(MeansN k) {
+    return std::max((k + kYinyangGroupSize - 1) / kYinyangGroupSize,
+                    MeansN{1});
+  }
+
+  /* @brief Returns the number of threads to use, which is max_threads_ if it
+         is set and the number of hardware threads otherwise. */
+  uint32_t Threads() const {
+    return max_threads_ != 0 ? max_threads_ :
+        std::max(std::thread::hardware_concurrency(), (uint32_t) 1);
+  }
+
+  /* @brief Returns the number of threads to split the given amount of work
+         between. */
+  uint32_t NumThreads(nda::index_t work) const {
+    return std::min(work, static_cast<nda::index_t>(Threads()));
+  }
+
+  /* @brief Returns the number of blocks to split a reduction over the given
+         number of data points into. */
+  static nda::index_t NumBlocks(nda::index_t rows) {
+    return std::clamp(rows / kMinBlockRows, nda::index_t{1}, kMaxBlocks);
+  }
+
+  /*
+    @brief Splits the data points into contiguous blocks of nearly equal size
+        and calls fn(block, begin, end) for each block, splitting the blocks
+        between the hardware threads.
+
+    The threads are kept in pool_ between calls, since each iteration runs
+    several of these phases and once the bounds skip most distances, starting
+    threads for each phase would take longer than the phase.
+  */
+  template <typename Fn>
+  void ForEachBlock(nda::index_t rows, nda::index_t n_blocks, Fn&& fn) const {
+    const uint32_t n_threads = NumThreads(n_blocks);
+    auto run_thread = [&](uint32_t thread) {
+      for (nda::index_t b = thread; b < n_blocks; b += n_threads) {
+        fn(b, rows * b / n_blocks, rows * (b + 1) / n_blocks);
+      }
+    };  // run_thread
+    if (n_threads <= 1) {
+      run_thread(0);
+      return;
+    }
+    if (pool_ == nullptr || pool_->size() != Threads()) {
+      pool_ = std::make_unique<ThreadPool>(Threads());
+    }
+    pool_->Run(n_threads, run_thread);
+  }  // ForEachBlock()
+
+  /*
+    @brief Calls fn(x) for every data point, giving each hardware thread one
+        contiguous block of points so that threads do not write to the same
+        cache lines.
+  */
+  template <typename Fn>
+  void ForEachPoint(nda::index_t rows, Fn&& fn) const {
+    ForEachBlock(rows, NumThreads(rows),
+                 [&](nda::index_t, nda::index_t begin, nda::index_t end) {
+      for (nda::index_t x = begin; x < end; ++x) fn(x);
+    });
+  }  // ForEachPoint()
+
+  /*
+    @brief Finds the closest cluster to a point, the distance to it, and the
+        distance to the second closest cluster, which is INFINITY if there is
+        only one cluster.
+  */
+  void NearestTwo(nda::vector_ref<T> point,
+                  const nda::matrix<Precision>& clusters, MeanId* nearest,
+                  double* nearest_dist, double* second_dist) const {
+    *nearest = 0;
+    *nearest_dist = Distance<T, Precision>::Compute(point,
+                                                    clusters(0, nda::all));
+    *second_dist = INFINITY;
+    for (MeanId c = 1; c < k_; ++c) {
+      double dist = Distance<T, Precision>::Compute(point,
+                                                    clusters(c, nda::all));
+      if (dist < *nearest_dist) {
+        *second_dist = *nearest_dist;
+        *nearest = c;
+        *nearest_dist = dist;
+      } else if (dist < *second_dist) {
+        *second_dist = dist;
+      }
+    }
+  }  // NearestTwo()
+
+  /*
+    @brief Splits the clusters into groups by running a few iterations of
+        kmeans on the clusters themselves, starting from evenly spaced
+        clusters.
+
+    @return The group of each cluster.
+  */
+  std::vector<MeanId> GroupClusters(const nda::matrix<Precision>& clusters,
+                                    MeansN n_groups) const {
+    constexpr int kIterations = 5;
+    nda::matrix<double> centers({n_groups, clusters.columns()});
+    for (MeanId g = 0; g < n_groups; ++g) {
+      centers(g, nda::all).copy_elems(
+          clusters(g * k_ / n_groups, nda::all));
+    }
+    std::vector<MeanId> group_of(k_, 0);
+    for (int i = 0; i < kIterations; ++i) {
+      for (MeanId c = 0; c < k_; ++c) {
+        double nearest_dist = INFINITY;
+        for (MeanId g = 0; g < n_groups; ++g) {
+          double dist = Distance<Precision, double>::Compute(
+              clusters(c, nda::all), centers(g, nda::all));
+          if (dist < nearest_dist) {
+            nearest_dist = dist;
+            group_of[c] = g;
+          }
+        }
+      }
+      nda::matrix<double> sums({n_groups, clusters.columns()}, 0);
+      std::vector<MeansN> counts(n_groups, 0);
+      for (MeanId c = 0; c < k_; ++c) {
+        sums(group_of[c], nda::all) += clusters(c, nda::all);
+        counts[group_of[c]] += 1;
+      }
+      for (MeanId g = 0; g < n_groups; ++g) {
+        if (counts[g] == 0) continue;
+        for (nda::index_t j = 0; j < clusters.columns(); ++j) {
+          centers(g, j) = sums(g, j) / counts[g];
+        }
+      }
+    }  // for i
+    return group_of;
+  }  // GroupClusters()
+
+  /*
+    @brief Computes the distance between every pair of clusters and half the
+        distance from each cluster to its closest other cluster.
+  */
+  void ClusterDists(const nda::matrix<Precision>& clusters,
+                    CombinationMatrix<double>* cluster_dists,
+                    std::vector<double>* half_min_cluster_dists) const {
+    // For all centers c and c', compute the distance between them. Rows of
+    // the triangle are dealt out to the threads one at a time so that each
+    // thread gets a mix of long and short rows.
+    ForEachBlock(k_, k_, [&](nda::index_t c1, nda::index_t, nda::index_t) {
+      for (MeanId c2 = c1 + 1; c2 < k_; ++c2) {
+        (*cluster_dists)(c1, c2) = Distance<Precision, Precision>::Compute(
+            clusters(c1, nda::all), clusters(c2, nda::all));
+      }
+    });
+    // From each cluster, compute and store 1/2 the distance to the nearest
+    // other cluster
+    ForEachPoint(k_, [&](nda::index_t c1) {
+      bool uninitialized = true;
+      for (MeanId c2 = 0; c2 < k_; ++c2) {
+        if (c1 == c2) continue;
+        if (uninitialized) {
+          (*half_min_cluster_dists)[c1] = (*cluster_dists)(c1, c2)/2;
+          uninitialized = false;
+        } else {
+          (*half_min_cluster_dists)[c1] = std::min(
+              (*cluster_dists)(c1, c2)/2, (*half_min_cluster_dists)[c1]);
+        }
+      }
+    });
+  }  // ClusterDists()
+
+  /*
+    @brief Computes the mean of the data points assigned to each cluster. Empty
+        clusters are filled with points selected by kmeans++ from the
+        clusters with more than one point.
+
+    @param data The data points.
+    @param clusters The clusters the data points are assigned to.
+    @param assignments The cluster each data point is assigned to.
+    @param rng Random number generator for filling empty clusters.
+    @param verbose Print diagnostics information.
+  */
+  std::unique_ptr<nda::matrix<Precision>> UpdateMeans(
+      nda::const_matrix_ref<T> data, const nda::matrix<Precision>& clusters,
+      const std::vector<MeanId>& assignments, Random* rng, bool verbose) {
+    // First, sum the data points assigned to each cluster. Each block of
+    // points is summed on its own, then the blocks are added in order.
+    const nda::index_t n_blocks = NumBlocks(data.rows());
+    nda::matrix_shape<> means_shape{k_, data.columns()};
+    std::vector<nda::matrix<double>> block_sums(n_blocks);
+    std::vector<std::vector<nda::size_t>> block_counts(n_blocks);
+    ForEachBlock(data.rows(), n_blocks,
+                 [&](nda::index_t b, nda::index_t begin, nda::index_t end) {
+      nda::matrix<double> sums(means_shape, 0);
+      std::vector<nda::size_t> counts(k_, 0);
+      for (nda::index_t x = begin; x < end; ++x) {
+        MeanId c = assignments[x];
+        sums(c, nda::all) += data(x, nda::all);
+        counts[c] += 1;
+      }
+      block_sums[b] = std::move(sums);
+      block_counts[b] = std::move(counts);
+    });
+    nda::matrix<double> sums = std::move(block_sums[0]);
+    std::vector<nda::size_t> cluster_counts = std::move(block_counts[0]);
+    for (nda::index_t b = 1; b < n_blocks; ++b) {
+      for (MeanId c = 0; c < k_; ++c) {
+        sums(c, nda::all) += block_sums[b](c, nda::all);
+        cluster_counts[c] += block_counts[b][c];
+      }
+    }
+    // Find any empty clusters
+    std::vector<MeansN> empty_clusters;
+    for (MeanId c = 0; c < k_; ++c) {
+      if (cluster_counts[c] == 0) {
+        empty_clusters.push_back(c);
+      }
+    }
+    // If there are empty clusters, fill them with the kmeans++ algorithm
+    if (empty_clusters.size() > 0) {
+      std::uniform_real_distribution<> std_unif(0.0, 1.0);
+      if (verbose) {
+        std::cout << "empty clusters: " << empty_clusters.size() << std::endl;
+      }
+      // Calculate the squared distances between each point and it's assigned
+      // cluster, and the sum of those distances. These values are needed for
+      // kmeans++. They are computed exactly rather than taken from the
+      // bounds, which differ between Elkan, Yinyang, and Hamerly, so that
+      // every kind of bounds fills the empty clusters with the same points.
+      // The only point in a cluster is never selected, since that would
+      // empty its cluster.
+      std::vector<double> squared_dists(data.rows());
+      ForEachPoint(data.rows(), [&](nda::index_t x) {
+        MeanId c_x = assignments[x];
+        if (cluster_counts[c_x] == 1) {
+          squared_dists[x] = 0;
+          return;
+        }
+        double dist = Distance<T, Precision>::Compute(
+            data(x, nda::all), clusters(c_x, nda::all));
+        squared_dists[x] = dist * dist;
+      });
+      double squared_sum = 0;
+      for (double squared_dist : squared_dists) squared_sum += squared_dist;
+
+      // Fill each empty cluster by selecting a point with kmeans++, removing
+      // that point from its current cluster, then adding it to the empty
+      // cluster.
+      std::vector<nda::index_t> moved;
+      for (std::size_t i = 0; i < empty_clusters.size(); ++i) {
+        double selection = std_unif((*rng)());
+        nda::index_t x = InitPlusPlusIter(
+          data, &squared_dists, &squared_sum, selection);
+        MeanId old_c = assignments[x];
+        MeanId new_c = empty_clusters[i];
+        moved.push_back(x);
+
+        sums(old_c, nda::all) -= data(x, nda::all);
+        sums(new_c, nda::all) += data(x, nda::all);
+
+        cluster_counts[old_c] += -1;
+        cluster_counts[new_c] += 1;
+
+        // If one point is left in the old cluster, it may not be selected
+        if (cluster_counts[old_c] == 1) {
+          for (nda::index_t y = 0; y < data.rows(); ++y) {
+            if (assignments[y] == old_c &&
+                std::find(moved.begin(), moved.end(), y) == moved.end()) {
+              squared_sum -= squared_dists[y];
+              squared_dists[y] = 0;
+              break;
+            }
+          }
+        }
+      }
+    }
+    auto means = std::make_unique<nda::matrix<Precision>>(means_shape);
+    for (auto i : means->i()) {
+      for (auto j : means->j()) {
+        (*means)(i, j) = sums(i, j) / cluster_counts[i];
+      }
+    }
+    return means;
+  }  // UpdateMeans()
+
+  /* @brief Returns the distance each cluster moved to its new mean. */
+  std::vector<double> Drift(const nda::matrix<Precision>& clusters,
+                            const nda::matrix<Precision>& means) const {
+    std::vector<double> cluster_to_means(k_);
+    for (MeanId c = 0; c < k_; ++c) {
+      cluster_to_means[c] = Distance<Precision, Precision>::Compute(
+          clusters(c, nda::all), means(c, nda::all));
+    }
+    return cluster_to_means;
+  }  // Drift()
+
+  /*
+    @brief Returns the closest cluster to a point and the distance to it.
+  */
+  std::pair<MeanId, double> Nearest(
+      nda::vector_ref<T> point, const nda::matrix<Precision>& clusters) const {
+    MeanId nearest = 0;
+    double nearest_dist = Distance<T, Precision>::Compute(
+        point, clusters(0, nda::all));
+    const MeanId n_clusters = clusters.rows();
+    for (MeanId c = 1; c < n_clusters; ++c) {
+      double dist = Distance<T, Precision>::Compute(point,
+                                                    clusters(c, nda::all));
+      if (dist < nearest_dist) {
+        nearest = c;
+        nearest_dist = dist;
+      }
+    }
+    return {nearest, nearest_dist};
+  }  // Nearest()
+
+  /*
+    @brief Returns a uniformly random sample of rows, taken without replacement
+        and kept in their original order.
+
+    @param data The data points to sample from.
+    @param n The number of rows to sample. All rows are returned if there are
+        not more than n rows.
+    @param seed Seed to use for the random number generation.
+  */
+  static nda::matrix<T> SampleRows(nda::const_matrix_ref<T> data,
+                                   nda::index_t n, Random::Seed seed) {
+    n = std::min(n, data.rows());
+    nda::matrix<T> sample(nda::matrix_shape<>{n, data.columns()});
+    Random rng(seed);
+    std::uniform_real_distribution<> std_unif(0.0, 1.0);
+
+    // Selection sampling: pick each row with probability (rows still needed)
+    // / (rows left)
+    nda::index_t selected = 0;
+    for (nda::index_t x = 0; x < data.rows() && selected < n; ++x) {
+      if ((data.rows() - x) * std_unif(rng()) < n - selected) {
+        sample(selected, nda::all).copy_elems(data(x, nda::all));
+        ++selected;
+      }
+    }
+    return sample;
+  }  // SampleRows()
+
+  double ComputeLoss(nda::const_matrix_ref<T> data,
+                     const nda::matrix<Precision>& clusters,
+                     const std::vector<MeanId>& assignments) {
+    const nda::index_t n_blocks = NumBlocks(data.rows());
+    std::vector<double> block_sums(n_blocks, 0);
+    ForEachBlock(data.rows(), n_blocks,
+                 [&](nda::index_t b, nda::index_t begin, nda::index_t end) {
+      double block_sum = 0;
+      for (nda::index_t x = begin; x < end; ++x) {
+        MeanId c_x = assignments[x];
+        double dist_to_cluster = Distance<T, Precision>::Compute(
+            data(x, nda::all), clusters(c_x, nda::all));
+        block_sum += std::pow(dist_to_cluster, 2);
+      }
+      block_sums[b] = block_sum;
+    });
+    double squared_sum = 0;
+    for (double block_sum : block_sums) squared_sum += block_sum;
     return squared_sum/data.rows();
   }  // ComputeLoss()
 
   const MeansN k_;
-  std::unique_ptr<nda::matrix<double>> clusters_;
+  std::unique_ptr<nda::matrix<Precision>> clusters_;
   std::unique_ptr<std::vector<MeanId>> assignments_;
   double loss_;
+  uint32_t iterations_;
+  ElkanTimes elkan_times_{};
+  uint32_t max_threads_{0};  // 0 means every hardware thread
+  /* Threads of ForEachBlock(), started the first time they are needed. Not
+     copied, so a copy starts its own. */
+  mutable std::unique_ptr<ThreadPool> pool_;
 };  // KMeans
 
 }  // namespace fishbait
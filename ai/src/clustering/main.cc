@@ -1,71 +1,85 @@
 #include <cstdint>
-#include <memory>
-#include <string>
+#include <cstdlib>
 #include <cstring>
+#include <iostream>
+#include <limits>
+#include <string>
 
 #include "array/array.h"
 #include "array/matrix.h"
+#include "clustering/cluster_round.h"
 #include "clustering/definitions.h"
 #include "clustering/distance.h"
-#include "clustering/k_means.h"
 #include "hand_strengths/definitions.h"
 #include "hand_strengths/lut_files.h"
-#include "utils/cereal.h"
-#include "utils/random.h"
+#include "hand_strengths/lut_generators.h"
+#include "utils/lut_file.h"
 
+/* Clusters a single round the same way abstraction.out does, without checking
+   whether its inputs changed. */
 int main(int argc, char *argv[]) {
+  uint32_t n_threads = 0;
+  uint32_t seed = 0;
+  uint32_t memory_gb = 0;
+  bool warm = false;
+  bool error = argc < 2 || !(!strcmp(argv[1], "flop") ||
+                             !strcmp(argv[1], "turn") ||
+                             !strcmp(argv[1], "river"));
+  for (int i = 2; i < argc && !error; ++i) {
+    if (!strcmp(argv[i], "--warm")) {
+      warm = true;
+      continue;
+    } else if (i + 1 == argc) {
+      error = true;
+      continue;
+    }
+    const char* flag = argv[i];
+    char* end;
+    unsigned long value = std::strtoul(argv[++i], &end, 10);  // NOLINT
+    error = *end != '\0' || value > std::numeric_limits<uint32_t>::max();
+    if (!strcmp(flag, "--threads")) {
+      n_threads = value;
+    } else if (!strcmp(flag, "--memory")) {
+      memory_gb = value;
+    } else if (!strcmp(flag, "--seed")) {
+      seed = value;
+    } else {
+      error = true;
+    }
+  }
+
   // Print usage on invalid input
-  if (argc != 1 + 1 || !(!strcmp(argv[1], "flop") || !strcmp(argv[1], "turn")
-        || !strcmp(argv[1], "river"))) {
-    std::cout << "Usage: clustering.out (flop | turn | river)"
-              << std::endl;
+  if (error) {
+    std::cout << "Usage: clustering.out (flop | turn | river) [--threads <n>] "
+                 "[--memory <gigabytes>] [--seed <n>] [--warm]" << std::endl;
     return 1;
   }
+  const std::size_t memory_budget = memory_gb * std::size_t{1000000000};
 
-  // cluster flop
   if (!strcmp(argv[1], "flop")) {
-    nda::matrix<fishbait::HistCount> data_points;
-    fishbait::FlopLUT_File(fishbait::FileAction::Load, &data_points, true);
-
-    // run clustering 10 times
-    fishbait::KMeans<fishbait::HistCount, fishbait::EarthMoverDistance> k(
-        fishbait::NumClusters(fishbait::Round::kFlop));
-    k.MultipleRestarts(data_points, 10, fishbait::kPlusPlus, true);
-
-    // save best run
-    fishbait::CerealSave(
-        fishbait::ClusterAssignmentFile(fishbait::Round::kFlop),
-        k.assignments(), true);
-
-  // cluster turn
+    // Cluster straight from the mapped LUT so that it is streamed from the
+    // file rather than loaded into memory
+    fishbait::MappedLUT<fishbait::HistCount> lut =
+        fishbait::FlopLUT_Map(true, true);
+    lut.AdviseSequential();
+    fishbait::ClusterRound<fishbait::HistCount, fishbait::EarthMoverDistance>(
+        fishbait::Round::kFlop, lut.matrix(), seed, memory_budget, warm,
+        n_threads);
   } else if (!strcmp(argv[1], "turn")) {
-    nda::matrix<fishbait::HistCount> data_points;
-    fishbait::TurnLUT_File(fishbait::FileAction::Load, &data_points, true);
-
-    // run clustering 10 times
-    fishbait::KMeans<fishbait::HistCount, fishbait::EarthMoverDistance> k(
-        fishbait::NumClusters(fishbait::Round::kTurn));
-    k.MultipleRestarts(data_points, 10, fishbait::kPlusPlus, true);
-
-    // save best run
-    fishbait::CerealSave(
-        fishbait::ClusterAssignmentFile(fishbait::Round::kTurn),
-        k.assignments(), true);
-
-  // cluster river
-  } else if (!strcmp(argv[1], "river")) {
-    nda::matrix<double> data_points;
-    fishbait::RiverLUT_File(fishbait::FileAction::Load, &data_points, true);
-
-    // run clustering 10 times
-    fishbait::KMeans<double, fishbait::EuclideanDistance> k(
-        fishbait::NumClusters(fishbait::Round::kRiver));
-    k.MultipleRestarts(data_points, 10, fishbait::kPlusPlus, true);
-
-    // save best run
-    fishbait::CerealSave(
-        fishbait::ClusterAssignmentFile(fishbait::Round::kRiver),
-        k.assignments(), true);
+    fishbait::MappedLUT<fishbait::HistCount> lut =
+        fishbait::TurnLUT_Map(true, true);
+    lut.AdviseSequential();
+    fishbait::ClusterRound<fishbait::HistCount, fishbait::EarthMoverDistance>(
+        fishbait::Round::kTurn, lut.matrix(), seed, memory_budget, warm,
+        n_threads);
+  } else {
+    // Compute the OCHS vectors straight from the mapped showdown LUT rather
+    // than loading a saved copy of them
+    nda::matrix<float> data_points = fishbait::RiverLUT(
+        fishbait::ShowdownLUT_Map(false, true), true);
+    fishbait::ClusterRound<float, fishbait::EuclideanDistance>(
+        fishbait::Round::kRiver, data_points, seed, memory_budget, warm,
+        n_threads);
   }
 
   return 0;
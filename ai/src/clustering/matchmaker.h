@@ -11,12 +11,6 @@
 namespace fishbait {
 
 class Matchmaker {
- private:
-  Indexer<2> preflop_indexer_;
-  Indexer<2, 3> flop_indexer_;
-  Indexer<2, 4> turn_indexer_;
-  Indexer<2, 5> river_indexer_;
-
  public:
   /*
     @brief Returns an array of cards clusters for the given node.
@@ -24,13 +18,14 @@ class Matchmaker {
     The clusters are only calculated for non folded and non all-in players at
     the current betting round.
   */
-  template <PlayerN kPlayers, typename AccessFn>
+  template <PlayerN kPlayers, typename QuotaT, typename Rules,
+            typename AccessFn>
   std::array<CardCluster, kPlayers> ClusterArray(
-      const Node<kPlayers>& node, AccessFn fn) const {
+      const Node<kPlayers, QuotaT, Rules>& node, AccessFn fn) const {
     std::array<CardCluster, kPlayers> card_clusters = {0};
     for (PlayerId i = 0; i < kPlayers; ++i) {
       if (!node.folded(i) && node.stack(i) != 0) {
-        card_clusters[i] = Cluster<kPlayers, AccessFn>(node, i, fn);
+        card_clusters[i] = Cluster(node, i, fn);
       }
     }
     return card_clusters;
@@ -39,27 +34,50 @@ class Matchmaker {
   /*
     @brief Returns the card cluster for the given player in the given node.
   */
-  template <PlayerN kPlayers, typename AccessFn>
-  CardCluster Cluster(const Node<kPlayers>& node, PlayerId player,
-                      AccessFn fn) const {
-    std::array player_cards = node.PlayerCards(player);
+  template <PlayerN kPlayers, typename QuotaT, typename Rules,
+            typename AccessFn>
+  CardCluster Cluster(const Node<kPlayers, QuotaT, Rules>& node,
+                      PlayerId player, AccessFn fn) const {
+    return fn(node.round(), Index(node, player));
+  }  // Cluster()
+
+  /*
+    @brief Returns the index of the given player's hand in the clusters of the
+        node's round.
+  */
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
+  hand_index_t Index(const Node<kPlayers, QuotaT, Rules>& node,
+                     PlayerId player) const {
+    return Index(node.round(), node.PlayerCards(player));
+  }  // Index()
+
+  /*
+    @brief Returns the index of the given cards in the clusters of the given
+        round.
+
+    @param round The round whose clusters to index.
+    @param player_cards The hole cards followed by the board. Only the board
+        cards revealed in the given round are used.
+  */
+  hand_index_t Index(Round round,
+                     const PublicHand<ISO_Card>& player_cards) const {
     hand_index_t idx;
-    switch (node.round()) {
+    switch (round) {
       case Round::kPreFlop:
-        idx = preflop_indexer_.IndexLast(player_cards);
+        idx = Indexer<2>::Shared().IndexLast(player_cards);
         break;
       case Round::kFlop:
-        idx = flop_indexer_.IndexLast(player_cards);
+        idx = Indexer<2, 3>::Shared().IndexLast(player_cards);
         break;
       case Round::kTurn:
-        idx = turn_indexer_.IndexLast(player_cards);
+        idx = Indexer<2, 4>::Shared().IndexLast(player_cards);
         break;
       case Round::kRiver:
-        idx = river_indexer_.IndexLast(player_cards);
+        idx = Indexer<2, 5>::Shared().IndexLast(player_cards);
         break;
     }
-    return fn(node.round(), idx);
-  }  // Cluster()
+    return idx;
+  }  // Index()
 };  // class Matchmaker
 
 }  // namespace fishbait
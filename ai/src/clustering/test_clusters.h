@@ -16,10 +16,6 @@ namespace fishbait {
 class TestClusters {
  private:
   std::array<std::vector<CardCluster>, kNRounds> table_;
-  Indexer<2> preflop_indexer_;
-  Indexer<2, 3> flop_indexer_;
-  Indexer<2, 4> turn_indexer_;
-  Indexer<2, 5> river_indexer_;
   static constexpr CardCluster kNClusters = 4;
 
  public:
@@ -31,11 +27,6 @@ class TestClusters {
       }
     }
   }
-  TestClusters(const TestClusters& other) : table_{other.table_} {};
-  TestClusters& operator=(const TestClusters& other) {
-    table_ = other.table_;
-    return *this;
-  }
   bool operator==(const TestClusters&) const { return true; }
   bool operator!=(const TestClusters&) const { return false; }
 
@@ -53,9 +44,9 @@ class TestClusters {
     return kNClusters;
   }
 
-  template <PlayerN kPlayers>
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
   std::array<CardCluster, kPlayers> ClusterArray(
-      const Node<kPlayers>& node) const {
+      const Node<kPlayers, QuotaT, Rules>& node) const {
     std::array<CardCluster, kPlayers> card_clusters;
     for (PlayerId i = 0; i < kPlayers; ++i) {
       if (!node.folded(i) && node.stack(i) != 0) {
@@ -65,22 +56,43 @@ class TestClusters {
     return card_clusters;
   }  // ClusterArray()
 
-  template <PlayerN kPlayers>
-  CardCluster Cluster(const Node<kPlayers>& node, PlayerId player) const {
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
+  DealClusters<kPlayers> ClusterMatrix(
+      const Node<kPlayers, QuotaT, Rules>& node) const {
+    DealClusters<kPlayers> card_clusters;
+    for (PlayerId i = 0; i < kPlayers; ++i) {
+      if (!node.folded(i) && node.stack(i) != 0) {
+        std::array player_cards = node.PlayerCards(i, Round::kRiver);
+        card_clusters[+Round::kPreFlop][i] =
+            Indexer<2>::Shared().IndexLast(player_cards) % kNClusters;
+        card_clusters[+Round::kFlop][i] =
+            Indexer<2, 3>::Shared().IndexLast(player_cards) % kNClusters;
+        card_clusters[+Round::kTurn][i] =
+            Indexer<2, 4>::Shared().IndexLast(player_cards) % kNClusters;
+        card_clusters[+Round::kRiver][i] =
+            Indexer<2, 5>::Shared().IndexLast(player_cards) % kNClusters;
+      }
+    }
+    return card_clusters;
+  }  // ClusterMatrix()
+
+  template <PlayerN kPlayers, typename QuotaT, typename Rules>
+  CardCluster Cluster(const Node<kPlayers, QuotaT, Rules>& node,
+                      PlayerId player) const {
     std::array player_cards = node.PlayerCards(player);
     hand_index_t idx;
     switch (node.round()) {
       case Round::kPreFlop:
-        idx = preflop_indexer_.IndexLast(player_cards);
+        idx = Indexer<2>::Shared().IndexLast(player_cards);
         break;
       case Round::kFlop:
-        idx = flop_indexer_.IndexLast(player_cards);
+        idx = Indexer<2, 3>::Shared().IndexLast(player_cards);
         break;
       case Round::kTurn:
-        idx = turn_indexer_.IndexLast(player_cards);
+        idx = Indexer<2, 4>::Shared().IndexLast(player_cards);
         break;
       case Round::kRiver:
-        idx = river_indexer_.IndexLast(player_cards);
+        idx = Indexer<2, 5>::Shared().IndexLast(player_cards);
         break;
       default:
         std::stringstream ss;
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <string>
 
+#include "poker/definitions.h"
+
 namespace fishbait {
 
 using OCHS_Id = uint8_t;
@@ -11,16 +13,32 @@ using OCHS_N = OCHS_Id;
 
 constexpr OCHS_N kOCHS_N = 8;
 
+/* Showdown strength of a river hand against every opponent hand. Wins are
+   whole or half (tied) hands against at most kOpHandsN opponents, so they are
+   stored exactly as counts of half wins. */
 struct ShowdownStrength {
-  double ehs = 0;
-  double ochs_wins[kOCHS_N] = {0, 0, 0, 0, 0, 0, 0, 0};
-  uint32_t ochs_totals[kOCHS_N] = {0, 0, 0, 0, 0, 0, 0, 0};
+  uint16_t ochs_half_wins[kOCHS_N] = {0, 0, 0, 0, 0, 0, 0, 0};
+  uint16_t ochs_totals[kOCHS_N] = {0, 0, 0, 0, 0, 0, 0, 0};
+
+  /* @brief Expected hand strength against a uniformly random opponent hand. */
+  double ehs() const {
+    uint32_t half_wins = 0;
+    for (OCHS_Id k = 0; k < kOCHS_N; ++k) half_wins += ochs_half_wins[k];
+    return half_wins / (2.0 * kOpHandsN);
+  }
+
+  /* @brief Wins against the opponent hands in the given OCHS cluster. */
+  double ochs_wins(OCHS_Id cluster) const {
+    return ochs_half_wins[cluster] / 2.0;
+  }
 
   template <class Archive>
   void serialize(Archive& ar) {  // NOLINT(runtime/references)
-    ar(ehs, ochs_wins, ochs_totals);
+    ar(ochs_half_wins, ochs_totals);
   }
 };
+static_assert(sizeof(ShowdownStrength) == 32);
+static_assert(2 * kOpHandsN <= UINT16_MAX);
 
 using HistCount = uint32_t;
 using HistBucketId = uint32_t;
@@ -1,66 +1,91 @@
 #ifndef AI_SRC_HAND_STRENGTHS_LUT_FILES_H_
 #define AI_SRC_HAND_STRENGTHS_LUT_FILES_H_
 
+#include <string_view>
 #include <vector>
 
 #include "array/matrix.h"
 #include "hand_strengths/definitions.h"
 #include "utils/cereal.h"
+#include "utils/lut_file.h"
 
 namespace fishbait {
 
+constexpr std::string_view kShowdownLUT_Path =
+    "out/ai/hand_strengths/showdown_lut.lut";
+constexpr std::string_view kPreflopLUT_Path =
+    "out/ai/hand_strengths/preflop_lut.lut";
+constexpr std::string_view kFlopLUT_Path =
+    "out/ai/hand_strengths/flop_lut.lut";
+constexpr std::string_view kTurnLUT_Path =
+    "out/ai/hand_strengths/turn_lut.lut";
+constexpr std::string_view kRiverLUT_Path =
+    "out/ai/hand_strengths/river_lut.lut";
+constexpr std::string_view kOCHS_PreflopLUT_Path =
+    "out/ai/hand_strengths/ochs_preflop_lut.lut";
+
 inline void ShowdownLUT_File(FileAction action,
                              std::vector<ShowdownStrength>* data_points,
                              bool verbose = false) {
-  Cereal(
-    action,
-    "out/ai/hand_strengths/showdown_lut_vector.cereal",
-    data_points,
-    verbose
-  );
+  LUTFile(action, kShowdownLUT_Path, data_points, verbose);
+}
+
+/*
+  @brief Memory maps the showdown LUT so that it can be used without loading
+      it into memory.
+
+  @param verify Option to check every chunk of the file now.
+  @param verbose Option to print progress.
+*/
+inline MappedLUT<ShowdownStrength> ShowdownLUT_Map(bool verify = false,
+                                                   bool verbose = false) {
+  return MappedLUT<ShowdownStrength>(kShowdownLUT_Path, verify, verbose);
 }
 
 inline void PreflopLUT_File(FileAction action,
                             nda::matrix<HistCount>* data_points,
                             bool verbose = false) {
-  Cereal(
-    action,
-    "out/ai/hand_strengths/preflop_lut_nda.cereal",
-    data_points,
-    verbose
-  );
+  LUTFile(action, kPreflopLUT_Path, data_points, verbose);
 }
 
 inline void FlopLUT_File(FileAction action,
                          nda::matrix<HistCount>* data_points,
                          bool verbose = false) {
-  Cereal(action, "out/ai/hand_strengths/flop_lut_nda.cereal", data_points,
-         verbose);
+  LUTFile(action, kFlopLUT_Path, data_points, verbose);
 }
 
 inline void TurnLUT_File(FileAction action,
                          nda::matrix<HistCount>* data_points,
                          bool verbose = false) {
-  Cereal(action, "out/ai/hand_strengths/turn_lut_nda.cereal", data_points,
-         verbose);
+  LUTFile(action, kTurnLUT_Path, data_points, verbose);
+}
+
+/*
+  @brief Memory maps the flop or turn LUT so that it can be clustered without
+      loading it into memory.
+
+  @param verify Option to check every chunk of the file now.
+  @param verbose Option to print progress.
+*/
+inline MappedLUT<HistCount> FlopLUT_Map(bool verify = false,
+                                        bool verbose = false) {
+  return MappedLUT<HistCount>(kFlopLUT_Path, verify, verbose);
+}
+inline MappedLUT<HistCount> TurnLUT_Map(bool verify = false,
+                                        bool verbose = false) {
+  return MappedLUT<HistCount>(kTurnLUT_Path, verify, verbose);
 }
 
 inline void RiverLUT_File(FileAction action,
-                          nda::matrix<double>* data_points,
+                          nda::matrix<float>* data_points,
                           bool verbose = false) {
-  Cereal(action, "out/ai/hand_strengths/river_lut_nda.cereal", data_points,
-         verbose);
+  LUTFile(action, kRiverLUT_Path, data_points, verbose);
 }
 
 inline void OCHS_PreflopLUT_File(FileAction action,
                                  nda::matrix<double>* data_points,
                                  bool verbose = false) {
-  Cereal(
-    action,
-    "out/ai/hand_strengths/ochs_preflop_lut_nda.cereal",
-    data_points,
-    verbose
-  );
+  LUTFile(action, kOCHS_PreflopLUT_Path, data_points, verbose);
 }
 
 }  // namespace fishbait
@@ -1,9 +1,13 @@
 #include "hand_strengths/lut_generators.h"
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <iterator>
 #include <ostream>
+#include <thread>
 #include <vector>
 
 #include "array/array.h"
@@ -11,126 +15,272 @@
 #include "hand_strengths/card_combinations.h"
 #include "hand_strengths/definitions.h"
 #include "hand_strengths/ochs.h"
+#include "poker/batch_evaluator.h"
 #include "poker/card_utils.h"
 #include "poker/definitions.h"
 #include "poker/indexer.h"
 #include "SKPokerEval/src/SevenEval.h"
 #include "utils/combination_matrix.h"
+#include "utils/lut_file.h"
 #include "utils/timer.h"
 
 namespace fishbait {
 
-std::vector<ShowdownStrength> ShowdownLUT(const bool verbose) {
-  if (verbose) {
-    std::cout << "Generating Showdown LUT..." << std::endl;
-  }
-
-  CombinationMatrix<OCHS_Id> op_clusters = SKClusterLUT();
+namespace {
 
-  constexpr hand_index_t one_hand_approx = ImperfectRecallHands(Round::kRiver) /
-                                           kUniqueHands;
+/* @brief Returns n_threads, or the number of hardware threads if it is 0. */
+uint32_t ThreadCount(const uint32_t n_threads) {
+  if (n_threads != 0) return n_threads;
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
 
-  std::vector<ShowdownStrength> showdown_lut(
-      ImperfectRecallHands(Round::kRiver));
+/*
+  @brief Splits [0, size) into one contiguous range per thread and runs
+      fn(thread, begin, end) for each range on its own thread.
+*/
+template <typename Fn>
+void ForEachRange(const hand_index_t size, const uint32_t n_threads, Fn fn) {
+  std::vector<std::thread> threads(n_threads);
+  for (uint32_t thread = 0; thread < n_threads; ++thread) {
+    hand_index_t begin = size * thread / n_threads;
+    hand_index_t end = size * (thread + 1) / n_threads;
+    threads[thread] = std::thread(fn, thread, begin, end);
+  }
+  for (uint32_t thread = 0; thread < n_threads; ++thread) {
+    threads[thread].join();
+  }
+}  // ForEachRange()
+
+}  // namespace
+
+void BoardShowdownStrengths(const BoardArray<SK_Card>& board,
+    const CombinationMatrix<OCHS_Id>& op_clusters,
+    CombinationMatrix<ShowdownStrength>* strengths) {
+  constexpr std::size_t kBoardHands = N_Choose_K(kDeckSize - kBoardCards,
+                                                 kHandCards);
+  using ClusterCounts = std::array<uint32_t, kOCHS_N>;
+
+  // Rank every pair of hole cards that can be dealt with the board
+  std::array<bool, kDeckSize> on_board{};
+  for (SK_Card c : board) on_board[c] = true;
+  std::array<Hand<SK_Card>, kBoardHands> hands;
+  std::size_t n_hands = 0;
+  for (SK_Card c1 = 0; c1 < kDeckSize; ++c1) {
+    if (on_board[c1]) continue;
+    for (SK_Card c2 = c1 + 1; c2 < kDeckSize; ++c2) {
+      if (on_board[c2]) continue;
+      hands[n_hands] = {c1, c2};
+      ++n_hands;
+    }
+  }
+  std::array<SevenEval::Rank, kBoardHands> ranks;
+  BatchEvaluator::Shared().RankHands(board, hands.data(), kBoardHands,
+                                     ranks.data());
+
+  std::array<OCHS_Id, kBoardHands> clusters;
+  std::array<uint16_t, kBoardHands> order;
+  for (std::size_t i = 0; i < kBoardHands; ++i) {
+    clusters[i] = op_clusters(hands[i][0], hands[i][1]);
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) {
+    return ranks[a] < ranks[b];
+  });
+
+  /* Count the hands in each cluster, both in total and for each card. The
+     count of a card is the number of hands which a hero holding that card
+     cannot face. */
+  ClusterCounts all_total{};
+  std::array<ClusterCounts, kDeckSize> all_card{};
+  for (std::size_t i = 0; i < kBoardHands; ++i) {
+    all_total[clusters[i]] += 1;
+    all_card[hands[i][0]][clusters[i]] += 1;
+    all_card[hands[i][1]][clusters[i]] += 1;
+  }
 
-  Indexer<2, 5> isocalc;
-  std::array<Card, 7> rollout;
-  CardCombinations op_hands(2);
+  /* Sweep the hands from weakest to strongest in groups of equal rank. Each
+     hero beats the hands before its group and ties the hands in its group,
+     less the hands which share one of its cards. A hero appears once in the
+     total and once for each of its cards, so it is added back once. */
+  ClusterCounts less_total{};
+  std::array<ClusterCounts, kDeckSize> less_card{};
+  ClusterCounts tie_total{};
+  std::array<ClusterCounts, kDeckSize> tie_card{};
+  std::size_t group_begin = 0;
+  while (group_begin < kBoardHands) {
+    std::size_t group_end = group_begin;
+    while (group_end < kBoardHands &&
+           ranks[order[group_end]] == ranks[order[group_begin]]) {
+      const std::size_t i = order[group_end];
+      tie_total[clusters[i]] += 1;
+      tie_card[hands[i][0]][clusters[i]] += 1;
+      tie_card[hands[i][1]][clusters[i]] += 1;
+      ++group_end;
+    }
 
-  hand_index_t sd_count = 0;
-  Timer t;
-  for (hand_index_t idx = 0; idx < ImperfectRecallHands(Round::kRiver); ++idx) {
-    rollout = isocalc.Unindex<1>(idx);
-    std::transform(rollout.begin(), rollout.end(), rollout.begin(),
-                   ConvertISOtoSK);
-
-    for (op_hands.Reset(rollout); !op_hands.is_done(); ++op_hands) {
-      SevenEval::Rank hero_rank = SevenEval::GetRank(rollout[0], rollout[1],
-          rollout[2], rollout[3], rollout[4], rollout[5], rollout[6]);
-      SevenEval::Rank villan_rank = SevenEval::GetRank(op_hands(0), op_hands(1),
-          rollout[2], rollout[3], rollout[4], rollout[5], rollout[6]);
-
-      double win_value = 0;
-      if (hero_rank > villan_rank) {
-        win_value = 1;
-      } else if (hero_rank == villan_rank) {
-        win_value = 0.5;
+    for (std::size_t j = group_begin; j < group_end; ++j) {
+      const std::size_t i = order[j];
+      const SK_Card a = hands[i][0];
+      const SK_Card b = hands[i][1];
+      ShowdownStrength& strength = (*strengths)(a, b);
+      for (OCHS_Id k = 0; k < kOCHS_N; ++k) {
+        const uint32_t self = clusters[i] == k;
+        const uint32_t wins = less_total[k] - less_card[a][k] -
+                              less_card[b][k];
+        const uint32_t ties = tie_total[k] - tie_card[a][k] - tie_card[b][k] +
+                              self;
+        strength.ochs_half_wins[k] = 2 * wins + ties;
+        strength.ochs_totals[k] = all_total[k] - all_card[a][k] -
+                                  all_card[b][k] + self;
       }
+    }  // for j
+
+    // Move the group from the tie counts to the less counts
+    for (std::size_t j = group_begin; j < group_end; ++j) {
+      const std::size_t i = order[j];
+      less_total[clusters[i]] += 1;
+      less_card[hands[i][0]][clusters[i]] += 1;
+      less_card[hands[i][1]][clusters[i]] += 1;
+      tie_total[clusters[i]] -= 1;
+      tie_card[hands[i][0]][clusters[i]] -= 1;
+      tie_card[hands[i][1]][clusters[i]] -= 1;
+    }
+    group_begin = group_end;
+  }  // while group_begin < kBoardHands
+}  // BoardShowdownStrengths()
 
-      OCHS_Id cluster = op_clusters(op_hands(0), op_hands(1));
-      showdown_lut[idx].ehs += win_value;
-      showdown_lut[idx].ochs_wins[cluster] += win_value;
-      showdown_lut[idx].ochs_totals[cluster] += 1;
-    }  // for op_hands
+std::vector<ShowdownStrength> ShowdownLUT(const bool verbose,
+                                          const uint32_t n_threads) {
+  if (verbose) {
+    std::cout << "Generating Showdown LUT..." << std::endl;
+  }
 
-    showdown_lut[idx].ehs /= kOpHandsN;
+  const CombinationMatrix<OCHS_Id> op_clusters = SKClusterLUT();
+  const Indexer<kBoardCards>& board_calc = Indexer<kBoardCards>::Shared();
+  const Indexer<2, 5>& isocalc = Indexer<2, 5>::Shared();
+  const hand_index_t n_boards = board_calc.Size();
 
-    sd_count += 1;
-    if (verbose && sd_count % one_hand_approx == 0) {
-      std::cout << 100.0 * sd_count / ImperfectRecallHands(Round::kRiver)
-                << "%" << std::endl;
-      t.Reset(std::cout << "iteration time: ") << std::endl;
-    }
-  }  // for idx
+  std::vector<ShowdownStrength> showdown_lut(
+      ImperfectRecallHands(Round::kRiver));
+
+  /* Every river hand is isomorphic to a hand on exactly one canonical board,
+     so threads which work on different boards never write the same index. */
+  const uint32_t thread_count = ThreadCount(n_threads);
+  const hand_index_t one_percent_approx = std::max(
+      n_boards / thread_count / 100, hand_index_t{1});
+  std::vector<std::thread> threads(thread_count);
+  for (uint32_t thread = 0; thread < thread_count; ++thread) {
+    threads[thread] = std::thread([&, thread]() {
+          CombinationMatrix<ShowdownStrength> strengths(kDeckSize,
+                                                        ShowdownStrength{});
+          std::array<ISO_Card, kPlayerCards> rollout;
+          BoardArray<SK_Card> board;
+          Timer t;
+          for (hand_index_t b = thread; b < n_boards; b += thread_count) {
+            BoardArray<ISO_Card> iso_board = board_calc.Unindex<0>(b);
+            std::transform(iso_board.begin(), iso_board.end(), board.begin(),
+                           ConvertISOtoSK);
+            BoardShowdownStrengths(board, op_clusters, &strengths);
+
+            std::copy(iso_board.begin(), iso_board.end(),
+                      std::next(rollout.begin(), kHandCards));
+            auto board_end = std::next(rollout.begin(), kPlayerCards);
+            for (ISO_Card c1 = 0; c1 < kDeckSize; ++c1) {
+              rollout[0] = c1;
+              if (std::find(std::next(rollout.begin(), kHandCards), board_end,
+                            c1) != board_end) continue;
+              for (ISO_Card c2 = c1 + 1; c2 < kDeckSize; ++c2) {
+                rollout[1] = c2;
+                if (std::find(std::next(rollout.begin(), kHandCards),
+                              board_end, c2) != board_end) continue;
+                showdown_lut[isocalc.IndexLast(rollout)] =
+                    strengths(ConvertISOtoSK(c1), ConvertISOtoSK(c2));
+              }
+            }
+
+            hand_index_t done = b / thread_count + 1;
+            if (verbose && thread == 0 && done % one_percent_approx == 0) {
+              std::cout << 100.0 * b / n_boards << "%" << std::endl;
+              t.Reset(std::cout << "iteration time: ") << std::endl;
+            }
+          }  // for b
+        }  // [&, thread]()
+    );  // std::thread  NOLINT(whitespace/parens)
+  }  // for thread
+  for (uint32_t thread = 0; thread < thread_count; ++thread) {
+    threads[thread].join();
+  }  // for thread
 
   return showdown_lut;
 }  // ShowdownLUT()
 
 template <hand_index_t kLUTSize, HistBucketN kBuckets, CardN kSimulationCards,
           RoundN kISORound, typename IndexerT>
-nda::matrix<HistCount> EHS_LUT(IndexerT& isocalc,
-    const std::vector<ShowdownStrength>& showdown_lut, const bool verbose) {
+nda::matrix<HistCount> EHS_LUT(const IndexerT& isocalc,
+    LUTView<ShowdownStrength> showdown_lut, const bool verbose,
+    const uint32_t n_threads) {
 
   constexpr hand_index_t kSimulationSize = N_Choose_K(
       kDeckSize - (kPlayerCards - kSimulationCards),
       kSimulationCards);
-  constexpr hand_index_t kOnePercentApprox = kLUTSize * kSimulationSize / 100;
+  constexpr CardN kNotSimulated = kPlayerCards - kSimulationCards;
   const double bucket_size = 1.0 / kBuckets;
 
   nda::matrix<HistCount> ehs_lut(nda::matrix_shape<>(kLUTSize, kBuckets), 0);
 
-  Indexer<2, 5> showdown_calc;
-  std::array<Card, kPlayerCards> rollout;
-  std::array<hand_index_t, 2> indicies;
-  CardCombinations simulations(kSimulationCards);
-  constexpr CardN kNotSimulated = kPlayerCards - kSimulationCards;
-
-
-  hand_index_t sd_count = 0;
-  Timer t;
-  for (hand_index_t idx = 0; idx < kLUTSize; ++idx) {
-    std::array<ISO_Card, kNotSimulated> hand =
-        isocalc.template Unindex<kISORound>(idx);
-    std::copy_n(hand.begin(), kNotSimulated, rollout.begin());
-
-    for (simulations.Reset(hand); !simulations.is_done(); ++simulations) {
-      for (CardN j = 0; j < kSimulationCards; ++j) {
-        rollout[kNotSimulated + j] = simulations(j);
-      }
-
-      // Get the appropriate showdown LUT index
-      indicies = showdown_calc.Index(rollout);
-
-      HistBucketId bucket_unbounded = showdown_lut[indicies[1]].ehs /
-                                      bucket_size;
-      HistBucketId bucket = std::min(bucket_unbounded, kBuckets - 1);
-
-      ehs_lut(idx, bucket) += 1;
-
-      sd_count += 1;
-      if (verbose && sd_count % kOnePercentApprox == 0) {
-        std::cout << 100.0 * sd_count / (kLUTSize * kSimulationSize)
-                  << "%" << std::endl;
-        t.Reset(std::cout << "iteration time: ") << std::endl;
-      }
-    }  // for simulations
-  }  // for idx
+  /* Each row only depends on its own simulations, so splitting the rows
+     between threads produces the same LUT as generating it serially. */
+  ForEachRange(kLUTSize, ThreadCount(n_threads), [&](uint32_t thread,
+      hand_index_t begin, hand_index_t end) {
+    const Indexer<2, 5>& showdown_calc = Indexer<2, 5>::Shared();
+    std::array<Card, kPlayerCards> rollout;
+    CardCombinations simulations(kSimulationCards);
+
+    const hand_index_t range_size = (end - begin) * kSimulationSize;
+    const hand_index_t one_percent_approx = std::max(range_size / 100,
+                                                     hand_index_t{1});
+    hand_index_t sd_count = 0;
+    Timer t;
+    for (hand_index_t idx = begin; idx < end; ++idx) {
+      std::array<ISO_Card, kNotSimulated> hand =
+          isocalc.template Unindex<kISORound>(idx);
+      std::copy_n(hand.begin(), kNotSimulated, rollout.begin());
+
+      // The hole cards are the same for every simulation, so index them once
+      Indexer<2, 5>::State hole_state = showdown_calc.NewState();
+      showdown_calc.IndexNextRound(rollout.data(), &hole_state);
+
+      for (simulations.Reset(hand); !simulations.is_done(); ++simulations) {
+        for (CardN j = 0; j < kSimulationCards; ++j) {
+          rollout[kNotSimulated + j] = simulations(j);
+        }
+
+        // Get the appropriate showdown LUT index
+        Indexer<2, 5>::State state = hole_state;
+        hand_index_t showdown_idx = showdown_calc.IndexNextRound(
+            rollout.data() + kHandCards, &state);
+
+        HistBucketId bucket_unbounded = showdown_lut[showdown_idx].ehs() /
+                                        bucket_size;
+        HistBucketId bucket = std::min(bucket_unbounded, kBuckets - 1);
+
+        ehs_lut(idx, bucket) += 1;
+
+        sd_count += 1;
+        if (verbose && thread == 0 && sd_count % one_percent_approx == 0) {
+          std::cout << 100.0 * sd_count / range_size << "%" << std::endl;
+          t.Reset(std::cout << "iteration time: ") << std::endl;
+        }
+      }  // for simulations
+    }  // for idx
+  });  // ForEachRange
 
   return ehs_lut;
 }  // EHS_LUT()
 
 nda::matrix<HistCount> PreflopLUT(
-    const std::vector<ShowdownStrength>& showdown_lut, const bool verbose) {
+    LUTView<ShowdownStrength> showdown_lut, const bool verbose,
+    const uint32_t n_threads) {
   if (verbose) {
     std::cout << "Generating Preflop LUT..." << std::endl;
   }
@@ -140,13 +290,13 @@ nda::matrix<HistCount> PreflopLUT(
   constexpr CardN kSimulationSize = 5;
   constexpr RoundN kISORound = 0;
   using IndexerT = Indexer<2>;
-  IndexerT isocalc;
   return EHS_LUT<kLUTSize, kBuckets, kSimulationSize, kISORound, IndexerT>(
-      isocalc, showdown_lut, verbose);
+      IndexerT::Shared(), showdown_lut, verbose, n_threads);
 }
 
 nda::matrix<HistCount> FlopLUT(
-    const std::vector<ShowdownStrength>& showdown_lut, const bool verbose) {
+    LUTView<ShowdownStrength> showdown_lut, const bool verbose,
+    const uint32_t n_threads) {
   if (verbose) {
     std::cout << "Generating Flop LUT..." << std::endl;
   }
@@ -156,13 +306,13 @@ nda::matrix<HistCount> FlopLUT(
   constexpr CardN kSimulationSize = 2;
   constexpr RoundN kISORound = 1;
   using IndexerT = Indexer<2, 3>;
-  IndexerT isocalc;
   return EHS_LUT<kLUTSize, kBuckets, kSimulationSize, kISORound, IndexerT>(
-      isocalc, showdown_lut, verbose);
+      IndexerT::Shared(), showdown_lut, verbose, n_threads);
 }
 
 nda::matrix<HistCount> TurnLUT(
-    const std::vector<ShowdownStrength>& showdown_lut, const bool verbose) {
+    LUTView<ShowdownStrength> showdown_lut, const bool verbose,
+    const uint32_t n_threads) {
   if (verbose) {
     std::cout << "Generating Turn LUT..." << std::endl;
   }
@@ -172,26 +322,25 @@ nda::matrix<HistCount> TurnLUT(
   constexpr CardN kSimulationSize = 1;
   constexpr RoundN kISORound = 1;
   using IndexerT = Indexer<2, 4>;
-  IndexerT isocalc;
   return EHS_LUT<kLUTSize, kBuckets, kSimulationSize, kISORound, IndexerT>(
-      isocalc, showdown_lut, verbose);
+      IndexerT::Shared(), showdown_lut, verbose, n_threads);
 }
 
-nda::matrix<double> RiverLUT(
-    const std::vector<ShowdownStrength>& showdown_lut, const bool verbose) {
+nda::matrix<float> RiverLUT(
+    LUTView<ShowdownStrength> showdown_lut, const bool verbose) {
   if (verbose) {
     std::cout << "Generating River LUT..." << std::endl;
   }
 
   constexpr hand_index_t kOnePercentApprox =
       ImperfectRecallHands(Round::kRiver) / 100;
-  nda::matrix<double> river_lut(nda::matrix_shape<>{
+  nda::matrix<float> river_lut(nda::matrix_shape<>{
       ImperfectRecallHands(Round::kRiver), kOCHS_N}, 0);
 
   Timer t;
   for (hand_index_t idx = 0; idx < ImperfectRecallHands(Round::kRiver); ++idx) {
     for (OCHS_Id j = 0; j < kOCHS_N; ++j) {
-      river_lut(idx, j) = showdown_lut[idx].ochs_wins[j] /
+      river_lut(idx, j) = showdown_lut[idx].ochs_wins(j) /
                           showdown_lut[idx].ochs_totals[j];
     }
 
@@ -205,55 +354,69 @@ nda::matrix<double> RiverLUT(
 }  // RiverLUT()
 
 nda::matrix<double> OCHS_PreflopLUT(
-    const std::vector<ShowdownStrength>& showdown_lut, const bool verbose) {
+    LUTView<ShowdownStrength> showdown_lut, const bool verbose,
+    const uint32_t n_threads) {
   if (verbose) {
     std::cout << "Generating OCHS Preflop LUT..." << std::endl;
   }
 
   constexpr hand_index_t kSimulationSize = N_Choose_K(50, 5);
-  const hand_index_t kOnePercentApprox = kUniqueHands * kSimulationSize / 100;
 
   nda::matrix<double> ochs_preflop_lut(
       nda::matrix_shape<>(kUniqueHands, kOCHS_N), 0);
 
-  Indexer<2, 5> showdown_calc;
-  std::array<ISO_Card, 7> rollout;
-  std::array<hand_index_t, 2> indicies;
-  std::array<HistCount, kOCHS_N> sim_totals;
-  CardCombinations simulations(5);
-
-  hand_index_t sd_count = 0;
-  Timer t;
-  for (hand_index_t idx = 0; idx < kUniqueHands; ++idx) {
-    std::array hand = showdown_calc.template Unindex<0>(idx);
-    std::copy_n(hand.begin(), 2, rollout.begin());
-    std::fill(sim_totals.begin(), sim_totals.end(), 0);
-
-    for (simulations.Reset(hand); !simulations.is_done(); ++simulations) {
-      for (CardN j = 0; j < 5; ++j) {
-        rollout[2 + j] = simulations(j);
-      }
-
-      // Get the appropriate showdown LUT index
-      indicies = showdown_calc.Index(rollout);
+  const Indexer<2, 5>& isocalc = Indexer<2, 5>::Shared();
+
+  /* Each row is summed by one thread in the same order as the serial loop, so
+     the LUT is bit identical for any number of threads. */
+  ForEachRange(kUniqueHands, ThreadCount(n_threads), [&](uint32_t thread,
+      hand_index_t begin, hand_index_t end) {
+    const Indexer<2, 5>& showdown_calc = Indexer<2, 5>::Shared();
+    std::array<ISO_Card, 7> rollout;
+    std::array<HistCount, kOCHS_N> sim_totals;
+    CardCombinations simulations(5);
+
+    const hand_index_t range_size = (end - begin) * kSimulationSize;
+    const hand_index_t one_percent_approx = std::max(range_size / 100,
+                                                     hand_index_t{1});
+    hand_index_t sd_count = 0;
+    Timer t;
+    for (hand_index_t idx = begin; idx < end; ++idx) {
+      std::array hand = isocalc.template Unindex<0>(idx);
+      std::copy_n(hand.begin(), 2, rollout.begin());
+      std::fill(sim_totals.begin(), sim_totals.end(), 0);
+
+      // The hole cards are the same for every simulation, so index them once
+      Indexer<2, 5>::State hole_state = showdown_calc.NewState();
+      showdown_calc.IndexNextRound(rollout.data(), &hole_state);
+
+      for (simulations.Reset(hand); !simulations.is_done(); ++simulations) {
+        for (CardN j = 0; j < 5; ++j) {
+          rollout[2 + j] = simulations(j);
+        }
+
+        // Get the appropriate showdown LUT index
+        Indexer<2, 5>::State state = hole_state;
+        hand_index_t showdown_idx = showdown_calc.IndexNextRound(
+            rollout.data() + 2, &state);
+
+        for (OCHS_Id k = 0; k < kOCHS_N; ++k) {
+          ochs_preflop_lut(idx, k) += showdown_lut[showdown_idx].ochs_wins(k);
+          sim_totals[k] += showdown_lut[showdown_idx].ochs_totals[k];
+        }
+
+        sd_count += 1;
+        if (verbose && thread == 0 && sd_count % one_percent_approx == 0) {
+          std::cout << 100.0 * sd_count / range_size << "%" << std::endl;
+          t.Reset(std::cout << "iteration time: ") << std::endl;
+        }
+      }  // for simulations
 
       for (OCHS_Id k = 0; k < kOCHS_N; ++k) {
-        ochs_preflop_lut(idx, k) += showdown_lut[indicies[1]].ochs_wins[k];
-        sim_totals[k] += showdown_lut[indicies[1]].ochs_totals[k];
-      }
-
-      sd_count += 1;
-      if (verbose && sd_count % kOnePercentApprox == 0) {
-        std::cout << 100.0 * sd_count / (kUniqueHands * kSimulationSize)
-                  << "%" << std::endl;
-        t.Reset(std::cout << "iteration time: ") << std::endl;
+        ochs_preflop_lut(idx, k) /= sim_totals[k];
       }
-    }  // for simulations
-
-    for (OCHS_Id k = 0; k < kOCHS_N; ++k) {
-      ochs_preflop_lut(idx, k) /= sim_totals[k];
-    }
-  }  // for idx
+    }  // for idx
+  });  // ForEachRange
 
   return ochs_preflop_lut;
 }  // OCHS_PreflopLUT
@@ -10,10 +10,37 @@
 #include "hand_strengths/ochs.h"
 #include "poker/definitions.h"
 #include "poker/indexer.h"
+#include "utils/combination_matrix.h"
+#include "utils/lut_file.h"
 
 namespace fishbait {
 
-std::vector<ShowdownStrength> ShowdownLUT(const bool verbose = false);
+/*
+  @brief Computes the showdown strength of every pair of hole cards on a river
+      board against every opponent hand which can be dealt with them.
+
+  Ranks each pair of hole cards once and derives the wins, ties, and totals of
+  each hero from counts over the hands sorted by rank.
+
+  @param board The river board. SK indexing.
+  @param op_clusters The OCHS cluster of each opponent hand. SK indexing.
+  @param strengths Matrix to store the strength of each pair of hole cards in,
+      indexed by SK card. Pairs which use a board card are left unchanged.
+*/
+void BoardShowdownStrengths(const BoardArray<SK_Card>& board,
+    const CombinationMatrix<OCHS_Id>& op_clusters,
+    CombinationMatrix<ShowdownStrength>* strengths);
+
+/*
+  @brief Generates the showdown strength of every river hand.
+
+  Walks each canonical river board once, in parallel across boards.
+
+  @param verbose Option to print progress.
+  @param n_threads Number of threads to use. 0 uses every hardware thread.
+*/
+std::vector<ShowdownStrength> ShowdownLUT(const bool verbose = false,
+                                          const uint32_t n_threads = 0);
 
 /*
   @brief Generic EHS LUT generating function.
@@ -24,34 +51,47 @@ std::vector<ShowdownStrength> ShowdownLUT(const bool verbose = false);
   @param kISORound The isocalc round that the LUT should generate rows from.
   @param IndexerT The indexer type to use.
   @param isocalc The Indexer object to generate rows from.
-  @param showdown_lut The showdown LUT to use.
+  @param showdown_lut The showdown LUT to use, either in memory or memory
+      mapped with ShowdownLUT_Map().
   @param verbose Option to print progress.
+  @param n_threads Number of threads to split the rows between. 0 uses every
+      hardware thread. The LUT is the same for any number of threads.
 */
 template <hand_index_t kLUTSize, HistBucketN kBuckets, CardN kSimulationCards,
           RoundN kISORound, typename IndexerT>
-nda::matrix<HistCount> EHS_LUT(IndexerT& isocalc,
-    const std::vector<ShowdownStrength>& showdown_lut,
-    const bool verbose = false);
+nda::matrix<HistCount> EHS_LUT(const IndexerT& isocalc,
+    LUTView<ShowdownStrength> showdown_lut,
+    const bool verbose = false, const uint32_t n_threads = 0);
 
 nda::matrix<HistCount> PreflopLUT(
-    const std::vector<ShowdownStrength>& showdown_lut,
-    const bool verbose = false);
+    LUTView<ShowdownStrength> showdown_lut,
+    const bool verbose = false, const uint32_t n_threads = 0);
 
 nda::matrix<HistCount> FlopLUT(
-    const std::vector<ShowdownStrength>& showdown_lut,
-    const bool verbose = false);
+    LUTView<ShowdownStrength> showdown_lut,
+    const bool verbose = false, const uint32_t n_threads = 0);
 
 nda::matrix<HistCount> TurnLUT(
-    const std::vector<ShowdownStrength>& showdown_lut,
-    const bool verbose = false);
+    LUTView<ShowdownStrength> showdown_lut,
+    const bool verbose = false, const uint32_t n_threads = 0);
+
+/*
+  @brief Generates the OCHS vector of every river hand.
+
+  The vectors are stored as floats, which halves the size of the LUT. Each
+  value is the ratio computed in double precision, rounded once.
 
-nda::matrix<double> RiverLUT(
-    const std::vector<ShowdownStrength>& showdown_lut,
+  @param showdown_lut The showdown LUT to use, either in memory or memory
+      mapped with ShowdownLUT_Map().
+  @param verbose Option to print progress.
+*/
+nda::matrix<float> RiverLUT(
+    LUTView<ShowdownStrength> showdown_lut,
     const bool verbose = false);
 
 nda::matrix<double> OCHS_PreflopLUT(
-    const std::vector<ShowdownStrength>& showdown_lut,
-    const bool verbose = false);
+    LUTView<ShowdownStrength> showdown_lut,
+    const bool verbose = false, const uint32_t n_threads = 0);
 
 }  // namespace fishbait
 
@@ -1,6 +1,9 @@
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 #include "array/array.h"
@@ -15,13 +18,23 @@
 
 int main(int argc, char *argv[]) {
   bool error = true;
+  uint32_t n_threads = 0;
+  if (argc == 1 + 3 && !strcmp(argv[2], "--threads")) {
+    char* end;
+    unsigned long threads_arg = std::strtoul(argv[3], &end, 10);  // NOLINT
+    if (*end == '\0' && threads_arg > 0 &&
+        threads_arg <= std::numeric_limits<uint32_t>::max()) {
+      n_threads = threads_arg;
+      argc -= 2;
+    }
+  }
   if (argc == 1 + 1) {
     if (!strcmp(argv[1], "showdown")) {
       // Generate Showdown LUT
       std::vector<fishbait::ShowdownStrength> showdown_lut =
-          fishbait::ShowdownLUT(true);
-      fishbait::CerealSave("out/ai/hand_strengths/showdown_lut_vector.cereal",
-                           &showdown_lut, true);
+          fishbait::ShowdownLUT(true, n_threads);
+      fishbait::ShowdownLUT_File(fishbait::FileAction::Save, &showdown_lut,
+                                 true);
       return 0;
     } else if (!strcmp(argv[1], "preflop") || !strcmp(argv[1], "flop")
         || !strcmp(argv[1], "turn") || !strcmp(argv[1], "river")
@@ -33,37 +46,37 @@ int main(int argc, char *argv[]) {
   // Print usage on invalid input
   if (error) {
     std::cout << "Usage: hand_strengths.out (showdown | preflop | flop | turn"
-      " | river | ochs_preflop)" << std::endl;
+      " | river | ochs_preflop) [--threads <n>]" << std::endl;
     return 1;
   }
 
-  // Load Showdown LUT
-  std::vector<fishbait::ShowdownStrength> showdown_lut;
-  fishbait::ShowdownLUT_File(fishbait::FileAction::Load, &showdown_lut, true);
+  // Map Showdown LUT
+  fishbait::MappedLUT<fishbait::ShowdownStrength> showdown_lut =
+      fishbait::ShowdownLUT_Map(false, true);
 
   if (!strcmp(argv[1], "preflop")) {
     // Generate preflop LUT
     nda::matrix<fishbait::HistCount> preflop_lut =
-        fishbait::PreflopLUT(showdown_lut, true);
+        fishbait::PreflopLUT(showdown_lut, true, n_threads);
     fishbait::PreflopLUT_File(fishbait::FileAction::Save, &preflop_lut, true);
   } else if (!strcmp(argv[1], "flop")) {
     // Generate Flop LUT
     nda::matrix<fishbait::HistCount> flop_lut =
-        fishbait::FlopLUT(showdown_lut, true);
+        fishbait::FlopLUT(showdown_lut, true, n_threads);
     fishbait::FlopLUT_File(fishbait::FileAction::Save, &flop_lut, true);
   } else if (!strcmp(argv[1], "turn")) {
     // Generate Turn LUT
     nda::matrix<fishbait::HistCount> turn_lut =
-        fishbait::TurnLUT(showdown_lut, true);
+        fishbait::TurnLUT(showdown_lut, true, n_threads);
     fishbait::TurnLUT_File(fishbait::FileAction::Save, &turn_lut, true);
   } else if (!strcmp(argv[1], "river")) {
     // Generate River LUT
-    nda::matrix<double> river_lut = fishbait::RiverLUT(showdown_lut, true);
+    nda::matrix<float> river_lut = fishbait::RiverLUT(showdown_lut, true);
     fishbait::RiverLUT_File(fishbait::FileAction::Save, &river_lut, true);
   } else if (!strcmp(argv[1], "ochs_preflop")) {
     // Generate OCHS Preflop LUT
     nda::matrix<double> ochs_pflop_lut =
-        fishbait::OCHS_PreflopLUT(showdown_lut, true);
+        fishbait::OCHS_PreflopLUT(showdown_lut, true, n_threads);
     fishbait::OCHS_PreflopLUT_File(fishbait::FileAction::Save, &ochs_pflop_lut,
                                    true);
   }
@@ -13,7 +13,7 @@ namespace fishbait {
 
 CombinationMatrix<OCHS_Id> SKClusterLUT() {
   CombinationMatrix<OCHS_Id> op_clusters(52, -1);
-  Indexer<2> handcalc;
+  const Indexer<2>& handcalc = Indexer<2>::Shared();
   for (ISO_Card i = 0; i < kDeckSize; ++i) {
     for (ISO_Card j = i + 1; j < kDeckSize; ++j) {
       hand_index_t hand_idx = handcalc.IndexLast({ConvertSKtoISO(i),
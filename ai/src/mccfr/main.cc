@@ -17,7 +17,8 @@
 #include "utils/timer.h"
 
 int main() {
-  fishbait::Node<fishbait::hparam::kPlayers> start_state;
+  fishbait::Node<fishbait::hparam::kPlayers, double, fishbait::hparam::Rules>
+      start_state;
   fishbait::ClusterTable cluster_table(true);
 
   using Minutes = fishbait::Timer::Minutes;
@@ -73,7 +74,8 @@ int main() {
             prune = true;
           }
         }
-        strategy.TraverseMCCFR(player, prune);
+        strategy.TraverseMCCFR(player, prune,
+                               fishbait::hparam::kDealUpFront);
       }  // for player
       ++iteration;
     }  // while should_continue
@@ -19,9 +19,10 @@
 
 namespace fishbait {
 
-template <PlayerN kPlayers, std::size_t kActions>
+template <PlayerN kPlayers, std::size_t kActions, typename Rules = FullRules>
 class SequenceTable {
  private:
+  using NodeT = Node<kPlayers, double, Rules>;
   using ActionArray = std::array<std::array<AbstractAction, kActions>,
                                  kNRounds>;
   using NumActionsArray = std::array<std::size_t, kNRounds>;
@@ -31,7 +32,7 @@ class SequenceTable {
   ActionArray actions_;
 
   // Starting state of the table.
-  Node<kPlayers> start_state_;
+  NodeT start_state_;
 
   /* An array of SequenceTables for each round. For each sequence table, the
      entry at row i column j represents the new sequence reached from taking
@@ -51,10 +52,9 @@ class SequenceTable {
     @param start_state The game tree node to start the table at.
   */
   SequenceTable(const std::array<AbstractAction, kActions>& actions,
-                const Node<kPlayers>& start_state) : actions_{},
-                                                     start_state_{start_state},
-                                                     table_{},
-                                                     legal_offsets_{} {
+                const NodeT& start_state) : actions_{},
+                                            start_state_{start_state},
+                                            table_{}, legal_offsets_{} {
     NumActionsArray action_counter;
     SortActions(actions, actions_, action_counter);
     NumNodesArray node_counter = CountSorted(actions_, action_counter,
@@ -157,7 +157,7 @@ class SequenceTable {
   /*
     @brief Returns the start state for the sequence table.
   */
-  const Node<kPlayers>& start_state() const {
+  const NodeT& start_state() const {
     return start_state_;
   }
 
@@ -195,7 +195,7 @@ class SequenceTable {
   */
   static NumNodesArray Count(
       const std::array<AbstractAction, kActions>& actions,
-      const Node<kPlayers>& start_state) {
+      const NodeT& start_state) {
     ActionArray sorted_actions;
     NumActionsArray num_actions;
     SortActions(actions, sorted_actions, num_actions);
@@ -226,7 +226,7 @@ class SequenceTable {
   */
   static NumNodesArray CountSorted(const ActionArray& sorted_actions,
                                    const NumActionsArray& num_actions,
-                                   const Node<kPlayers>& start_state) {
+                                   const NodeT& start_state) {
     NumNodesArray node_counter;
     node_counter.fill({0, 0, 0, 0});
     Node new_state = start_state;
@@ -260,7 +260,8 @@ class SequenceTable {
   /*
     @brief Runs through the recursive sequence table construction algorithm.
 
-    @param state The game tree node to generate a row for.
+    @param state The game tree node to generate a row for. Actions are explored
+        in place and reverted with Node::Undo().
     @param actions The actions available in the abstracted game tree.
     @param num_actions Array of number of actions available at each round.
     @param seq The SequenceId corresponding to the game tree node.
@@ -273,7 +274,7 @@ class SequenceTable {
         terminal states.
   */
   template <typename RowMarkFn>
-  static SequenceId Generate(Node<kPlayers>& state, int num_raises,
+  static SequenceId Generate(NodeT& state, int num_raises,
                              const ActionArray& actions,
                              const NumActionsArray& num_actions, SequenceId seq,
                              NumNodesArray& node_counter,
@@ -297,14 +298,15 @@ class SequenceTable {
       Chips chip_size = ActionSize(action, state, num_raises);
       if (chip_size) {
         ++node_counter[+state.round()].legal_actions;
-        Node<kPlayers> new_state = state;
-        new_state.Apply(action.play, chip_size);
-        Round new_round = new_state.round();
+        typename NodeT::UndoRecord undo;
+        state.Apply(action.play, chip_size, &undo);
+        Round new_round = state.round();
         int new_raise_num = num_raises;
         if (action.play == Action::kBet) ++new_raise_num;
-        SequenceId new_state_id = Generate(new_state, new_raise_num, actions,
+        SequenceId new_state_id = Generate(state, new_raise_num, actions,
             num_actions, node_counter[+new_round].internal_nodes, node_counter,
             row_marker);
+        state.Undo(undo);
         row_marker(seq, state.round(), j, new_state_id);
       } else {
         ++node_counter[+state.round()].illegal_nodes;
@@ -320,7 +322,7 @@ class SequenceTable {
     @return The size of the action to play if it can be played, 0 otherwise.
   */
   static Chips ActionSize(const AbstractAction& action,
-                          const Node<kPlayers>& state, int num_raises) {
+                          const NodeT& state, int num_raises) {
     if ((action.max_raise_num == 0) || (num_raises < action.max_raise_num)) {
       switch (action.play) {
         case Action::kAllIn:
@@ -30,9 +30,12 @@
 
 namespace fishbait {
 
-template <PlayerN kPlayers, std::size_t kActions, typename InfoAbstraction>
+template <PlayerN kPlayers, std::size_t kActions, typename InfoAbstraction,
+          typename Rules = FullRules>
 class Strategy {
  private:
+  using NodeT = Node<kPlayers, double, Rules>;
+
   // Table of values for each legal action. Size card clusters * legal actions.
   using LegalActionsTableShape = nda::shape<nda::dim<>, nda::dense_dim<>>;
   template <typename T>
@@ -43,7 +46,7 @@ class Strategy {
   using GameLegalActionsTable = std::array<LegalActionsTable<T>, kNRounds>;
 
   InfoAbstraction info_abstraction_;
-  SequenceTable<kPlayers, kActions> action_abstraction_;
+  SequenceTable<kPlayers, kActions, Rules> action_abstraction_;
 
   // round * card clusters * legal actions
   GameLegalActionsTable<Regret> regrets_;
@@ -75,7 +78,7 @@ class Strategy {
         constant are eligible to be pruned.
     @param regret_floor Floor to cutoff negative regrets at.
   */
-  Strategy(const Node<kPlayers>& start_state,
+  Strategy(const NodeT& start_state,
            const std::array<AbstractAction, kActions>& actions,
            InfoAbstraction info_abstraction, Regret prune_constant,
            Regret regret_floor)
@@ -115,7 +118,7 @@ class Strategy {
     @param player The player whose strategy is being updated.
   */
   void UpdateStrategy(PlayerId player) {
-    Node<kPlayers> start_state_copy = action_abstraction_.start_state();
+    NodeT start_state_copy = action_abstraction_.start_state();
     UpdateStrategy(start_state_copy, 0, 0, player);
   }
 
@@ -125,11 +128,22 @@ class Strategy {
     @param player The player whose strategy is being updated.
     @param prune Whether to prune actions with regrets less than
         prune_constant_.
+    @param deal_up_front Option to deal the whole hand and find the card
+        clusters of every round before the traversal starts, rather than
+        dealing and clustering at each chance node. The traversal then samples
+        a single board, and its chance nodes only look up the clusters.
   */
-  void TraverseMCCFR(PlayerId player, bool prune) {
-    Node<kPlayers> start_state_copy = action_abstraction_.start_state();
+  void TraverseMCCFR(PlayerId player, bool prune, bool deal_up_front = false) {
+    NodeT start_state_copy = action_abstraction_.start_state();
     std::array<CardCluster, kPlayers> card_buckets{};
-    TraverseMCCFR(start_state_copy, card_buckets, 0, player, prune);
+    if (deal_up_front) {
+      start_state_copy.DealAll();
+      const DealClusters<kPlayers> dealt =
+          info_abstraction_.ClusterMatrix(start_state_copy);
+      TraverseMCCFR(start_state_copy, card_buckets, 0, player, prune, &dealt);
+    } else {
+      TraverseMCCFR(start_state_copy, card_buckets, 0, player, prune, nullptr);
+    }
   }
 
   /*
@@ -255,7 +269,7 @@ class Strategy {
 
   /* @brief Barebones constructor to load a saved strategy. */
   Strategy() : action_abstraction_{std::array<AbstractAction, kActions>{},
-                                   Node<kPlayers>{}} { }
+                                   NodeT{}} { }
 
   /*
     @brief Returns the sum of all positive regrets at an infoset.
@@ -308,46 +322,53 @@ class Strategy {
   /*
     @brief Recursively updates the given player's average preflop strategy.
 
-    @param state State of the game at the current recursive call.
+    @param state State of the game at the current recursive call. Moves and
+        deals made on it are reverted with Node::Undo() before returning.
     @param card_bucket The card cluster id of the infoset at the current
         recursive call.
     @param seq The sequence id of the infoset at the current recursive call.
     @param player The player whose strategy is being updated.
   */
-  void UpdateStrategy(Node<kPlayers>& state, CardCluster card_bucket,
+  void UpdateStrategy(NodeT& state, CardCluster card_bucket,
                       SequenceId seq, PlayerId player) {
     Round round = state.round();
     if (round > Round::kPreFlop || !state.in_progress() ||
         state.folded(player) || state.stack(player) == 0) {
       return;
     } else if (state.acting_player() == state.kChancePlayer) {
-      state.Deal();
+      typename NodeT::DealRecord deal;
+      state.Deal(&deal);
       state.ProceedPlay();
-      return UpdateStrategy(state, info_abstraction_.Cluster(state, player),
-                            seq, player);
+      UpdateStrategy(state, info_abstraction_.Cluster(state, player), seq,
+                     player);
+      state.Undo(deal);
+      return;
     }
     nda::const_vector_ref<AbstractAction> actions =
         action_abstraction_.Actions(round);
     if (state.acting_player() == player) {
       ActionIndicies action_idxs = SampleAction(round, card_bucket, seq);
       AbstractAction action = actions(action_idxs.round_idx);
-      state.Apply(action.play, state.ProportionToChips(action.size));
+      typename NodeT::UndoRecord undo;
+      state.Apply(action.play, state.ProportionToChips(action.size), &undo);
       std::size_t offset = action_abstraction_.LegalOffset(round, seq);
       action_counts_(card_bucket, offset + action_idxs.legal_idx) += 1;
       SequenceId next_seq = action_abstraction_.Next(round, seq,
                                                      action_idxs.round_idx);
-      return UpdateStrategy(state, card_bucket, next_seq, player);
+      UpdateStrategy(state, card_bucket, next_seq, player);
+      state.Undo(undo);
     } else {
       for (nda::index_t action_index = 0; action_index < actions.width();
            ++action_index) {
         if (action_abstraction_.Next(round, seq, action_index) != kIllegalId) {
-          Node<kPlayers> new_state = state;
           AbstractAction action = actions(action_index);
-          new_state.Apply(action.play,
-                          new_state.ProportionToChips(action.size));
-          UpdateStrategy(new_state, card_bucket,
+          typename NodeT::UndoRecord undo;
+          state.Apply(action.play, state.ProportionToChips(action.size),
+                      &undo);
+          UpdateStrategy(state, card_bucket,
                          action_abstraction_.Next(round, seq, action_index),
                          player);
+          state.Undo(undo);
         }
       }
     }
@@ -356,29 +377,46 @@ class Strategy {
   /*
     @brief Recursively updates the given player's cumulative regrets.
 
-    @param state State of the game at the current recursive call.
+    @param state State of the game at the current recursive call. Moves and
+        deals made on it are reverted with Node::Undo() before returning.
     @param card_buckets The card cluster ids for each non folded player in the
         current round.
     @param seq The sequence id of the infoset at the current recursive call.
     @param player The player whose strategy is being updated.
     @param prune Whether to prune actions with regrets less than
         prunt_constant_.
+    @param dealt The card clusters of every round if the whole hand was dealt
+        with Node::DealAll(), or null to deal at each chance node.
     
     @return The value of the node.
   */
-  double TraverseMCCFR(Node<kPlayers>& state,
+  double TraverseMCCFR(NodeT& state,
                        const std::array<CardCluster, kPlayers>& card_buckets,
-                       SequenceId seq, PlayerId player, bool prune) {
+                       SequenceId seq, PlayerId player, bool prune,
+                       const DealClusters<kPlayers>* dealt) {
     if (!state.in_progress()) {
-      state.AwardPot(state.same_stack_no_rake_);
-      return state.stack(player);
+      /* AwardPot() changes every player's chips, so award a copy rather than
+         undoing it. */
+      NodeT terminal_state = state;
+      terminal_state.AwardPot(terminal_state.same_stack_no_rake_);
+      return terminal_state.stack(player);
     } else if (state.folded(player)) {
       return state.stack(player);
     } else if (state.acting_player() == state.kChancePlayer) {
-      state.Deal();
+      /* The cards were already dealt, and the move which led here reverts
+         ProceedPlay(). */
+      if (dealt) {
+        state.ProceedPlay();
+        return TraverseMCCFR(state, (*dealt)[+state.round()], seq, player,
+                             prune, dealt);
+      }
+      typename NodeT::DealRecord deal;
+      state.Deal(&deal);
       state.ProceedPlay();
-      return TraverseMCCFR(state, info_abstraction_.ClusterArray(state), seq,
-                           player, prune);
+      double value = TraverseMCCFR(state, info_abstraction_.ClusterArray(state),
+                                   seq, player, prune, dealt);
+      state.Undo(deal);
+      return value;
     }
 
     Round round = state.round();
@@ -409,11 +447,12 @@ class Strategy {
         if (!prune || action_regret > prune_constant_ ||
             round == Round::kRiver || next_seq == kLeafId) {
           AbstractAction action = actions(i);
-          Node<kPlayers> new_state = state;
-          new_state.Apply(action.play,
-                          new_state.ProportionToChips(action.size));
-          double action_value = TraverseMCCFR(new_state, card_buckets, next_seq,
-                                              player, prune);
+          typename NodeT::UndoRecord undo;
+          state.Apply(action.play, state.ProportionToChips(action.size),
+                      &undo);
+          double action_value = TraverseMCCFR(state, card_buckets, next_seq,
+                                              player, prune, dealt);
+          state.Undo(undo);
           action_values[i] = action_value;
           value += action_value * strategy[legal_i];
           explored[i] = true;
@@ -443,10 +482,14 @@ class Strategy {
                                                card_buckets[acting_player],
                                                seq).round_idx;
       AbstractAction action = actions(action_index);
-      state.Apply(action.play, state.ProportionToChips(action.size));
-      return TraverseMCCFR(state, card_buckets,
-                           action_abstraction_.Next(round, seq, action_index),
-                           player, prune);
+      typename NodeT::UndoRecord undo;
+      state.Apply(action.play, state.ProportionToChips(action.size), &undo);
+      double value = TraverseMCCFR(state, card_buckets,
+                                   action_abstraction_.Next(round, seq,
+                                                            action_index),
+                                   player, prune, dealt);
+      state.Undo(undo);
+      return value;
     }  // else
   }  // TraverseMCCFR()
 
@@ -456,7 +499,7 @@ class Strategy {
    private:
     GameLegalActionsTable<float> probabilities_;
     int n_;  // How many strategies are in this average.
-    SequenceTable<kPlayers, kActions> action_abstraction_;
+    SequenceTable<kPlayers, kActions, Rules> action_abstraction_;
     InfoAbstraction info_abstraction_;
     inline static thread_local Random rng_;
 
@@ -469,7 +512,7 @@ class Strategy {
 
     /* @brief Barebones constructor to load a saved average. */
     Average() : action_abstraction_{std::array<AbstractAction, kActions>{},
-                                    Node<kPlayers>{}},
+                                    NodeT{}},
                 info_abstraction_{InfoAbstraction::BlankTable()} {}
 
    public:
@@ -477,13 +520,13 @@ class Strategy {
 
     Average(const Average& other)
         : action_abstraction_{std::array<AbstractAction, kActions>{},
-                              Node<kPlayers>{}},
+                              NodeT{}},
           info_abstraction_{InfoAbstraction::BlankTable()} {
       *this = other;
     };
     Average(Average&& other)
         : action_abstraction_{std::array<AbstractAction, kActions>{},
-                              Node<kPlayers>{}},
+                              NodeT{}},
           info_abstraction_{InfoAbstraction::BlankTable()} {
       *this = std::move(other);
     };
@@ -734,7 +777,7 @@ class Strategy {
       Chips default_stack = action_abstraction_.start_state().stack(0);
       for (PlayerId player = 0; player < kPlayers; ++player) {
         for (int i = 0; i < trials; ++i) {
-          Node<kPlayers> state = action_abstraction_.start_state();
+          NodeT state = action_abstraction_.start_state();
           SequenceId seq = 0;
           std::array<CardCluster, kPlayers> card_buckets = {0};
           while (state.in_progress()) {
@@ -0,0 +1,768 @@
+#ifndef AI_SRC_MCCFR_SUBGAME_SOLVER_H_
+#define AI_SRC_MCCFR_SUBGAME_SOLVER_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "array/array.h"
+#include "clustering/definitions.h"
+#include "mccfr/definitions.h"
+#include "mccfr/sequence_table.h"
+#include "poker/definitions.h"
+#include "poker/node.h"
+#include "utils/config.h"
+#include "utils/math.h"
+#include "utils/random.h"
+#include "utils/timer.h"
+
+namespace fishbait {
+
+/* An action which a player took earlier in the hand, located in the
+   blueprint's game tree. */
+struct BlueprintAction {
+  PlayerId player;
+  Round round;
+  SequenceId seq;  // blueprint sequence the action was taken at
+  std::size_t action_idx;
+
+  bool operator==(const BlueprintAction& rhs) const {
+    return player == rhs.player && round == rhs.round && seq == rhs.seq &&
+           action_idx == rhs.action_idx;
+  }
+
+  /* @brief BlueprintAction serialize function */
+  template<class Archive>
+  void serialize(Archive& archive) {
+    archive(player, round, seq, action_idx);
+  }
+};
+
+/*
+  Real time depth limited search of the subgame rooted at a postflop decision
+  point.
+
+  The subgame covers the remainder of the current betting round. Only the
+  actions that the blueprint has available in that round are used, so the
+  resulting policy lines up with the blueprint's action indicies. Every
+  iteration, the other players' hands are sampled from their ranges and the
+  rest of the board is dealt uniformly. Nodes at the end of the round are
+  valued by rolling out the blueprint for the rest of the hand. Regrets are
+  found with external sampling MCCFR with linear discounting between epochs of
+  the time budget.
+
+  The Blueprint gives the solver the blueprint strategy. It must have the
+  following const member functions, which are called by every search thread at
+  once:
+
+    std::array<AbstractAction, kActions> Actions(Round round)
+    std::size_t ActionCount(Round round)
+    SequenceId Next(Round round, SequenceId seq, std::size_t action_idx)
+    std::array<float, kActions> Policy(Round round, CardCluster cluster,
+                                       SequenceId seq)
+    CardCluster NumClusters(Round round)
+    CardCluster Cluster(Round round, const PublicHand<ISO_Card>& cards)
+
+  The first five are the same as Scribe's. Cluster() returns the card cluster
+  of the hole cards at the start of cards with the board of the given round.
+*/
+template <PlayerN kPlayers, std::size_t kActions, typename Blueprint>
+class SubgameSolver {
+ private:
+  // Table of values for each legal action. Size card clusters * legal actions.
+  using LegalActionsTable = nda::array<Regret, nda::shape<nda::dim<>,
+                                                          nda::dense_dim<>>>;
+  using Policy = std::array<float, kActions>;
+  // Card cluster of each player in each round
+  using RoundClusters = std::array<std::array<CardCluster, kPlayers>,
+                                   kNRounds>;
+
+  // Number of times to discount regrets while searching.
+  static constexpr int kEpochs = 10;
+
+  /* Number of times to deal every player a hand from their range before
+     dealing each hand from what the players before them left in the deck. */
+  static constexpr int kMaxDeals = 16;
+
+  Node<kPlayers> root_;
+  PlayerId hero_;
+  Round round_;
+  const Blueprint& blueprint_;
+  std::array<std::array<AbstractAction, kActions>, kNRounds> round_actions_;
+  std::array<std::size_t, kNRounds> round_action_counts_;
+  SequenceTable<kPlayers, kActions> action_abstraction_;
+
+  /* The blueprint sequence of each sequence of the subgame, or kIllegalId if
+     the blueprint can't reach it. */
+  std::vector<SequenceId> blueprint_seqs_;
+
+  /* The blueprint sequence reached by each action of each sequence of the
+     subgame. Indexed by seq * ActionCount(round_) + action_idx. */
+  std::vector<SequenceId> blueprint_next_;
+
+  /* Cluster of each hole card pair on the root board. Indexed by
+     first_card * kDeckSize + second_card. */
+  std::vector<CardCluster> hand_clusters_;
+
+  // Cards which are not in the hero's hand or on the revealed board
+  std::vector<ISO_Card> unknown_cards_;
+
+  // Every hand the other players could hold
+  std::vector<Hand<ISO_Card>> hands_;
+
+  // Weight of each of hands_ in each player's range
+  std::array<std::vector<double>, kPlayers> ranges_;
+
+  // Running sum of the weights of each player's range
+  std::array<std::vector<double>, kPlayers> range_sums_;
+
+  LegalActionsTable regrets_;
+  Regret regret_floor_;
+
+  /* Seed of the search threads' random number generators. Each thread seeds
+     its rng_ when it starts, so the search does not depend on the generator of
+     the thread which constructed the solver. */
+  Random::Seed seed_;
+
+  inline static thread_local Random rng_;
+
+ public:
+  /*
+    @brief Constructs the subgame at the given decision point.
+
+    @param root The current state of the game. The hero's hand and the revealed
+        board must be set. Must be a postflop decision point of the hero.
+    @param hero The player we are searching for.
+    @param blueprint The blueprint strategy. Must outlive the solver.
+    @param blueprint_seq The blueprint sequence of the root.
+    @param regret_floor Floor to cutoff negative regrets at.
+  */
+  SubgameSolver(const Node<kPlayers>& root, PlayerId hero,
+                const Blueprint& blueprint, SequenceId blueprint_seq,
+                Regret regret_floor)
+      : root_{root}, hero_{hero}, round_{root.round()}, blueprint_{blueprint},
+        round_actions_{}, round_action_counts_{},
+        action_abstraction_{SubgameActions(blueprint, root.round()), root},
+        blueprint_seqs_(action_abstraction_.States(round_), kIllegalId),
+        blueprint_next_(action_abstraction_.States(round_) *
+                        action_abstraction_.ActionCount(round_), kIllegalId),
+        hand_clusters_(kDeckSize * kDeckSize, 0), unknown_cards_{}, hands_{},
+        ranges_{}, range_sums_{},
+        regrets_{{blueprint.NumClusters(round_),
+                  action_abstraction_.NumLegalActions(round_)}, 0},
+        regret_floor_{regret_floor}, seed_{} {
+    const std::string func{__func__};
+    if (round_ == Round::kPreFlop || !root.in_progress() ||
+        root.acting_player() != hero) {
+      throw std::invalid_argument(func + " requires a postflop node where the "
+                                  "hero is acting.");
+    }
+
+    for (RoundId r = 0; r < kNRounds; ++r) {
+      round_actions_[r] = blueprint.Actions(Round{r});
+      round_action_counts_[r] = blueprint.ActionCount(Round{r});
+    }
+    Node<kPlayers> map_state = root;
+    MapBlueprint(map_state, 0, blueprint_seq);
+
+    PublicHand<ISO_Card> hero_cards = root.PlayerCards(hero);
+    CardN known = kHandCards + Revealed();
+    for (ISO_Card card = 0; card < kDeckSize; ++card) {
+      auto known_end = std::next(hero_cards.begin(), known);
+      if (std::find(hero_cards.begin(), known_end, card) == known_end) {
+        unknown_cards_.push_back(card);
+      }
+    }
+
+    PublicHand<ISO_Card> cards = hero_cards;
+    for (std::size_t i = 0; i < unknown_cards_.size(); ++i) {
+      for (std::size_t j = i + 1; j < unknown_cards_.size(); ++j) {
+        ISO_Card first = unknown_cards_[i];
+        ISO_Card second = unknown_cards_[j];
+        hands_.push_back({first, second});
+        cards[0] = first;
+        cards[1] = second;
+        CardCluster cluster = blueprint.Cluster(round_, cards);
+        hand_clusters_[first * kDeckSize + second] = cluster;
+        hand_clusters_[second * kDeckSize + first] = cluster;
+      }
+    }
+    hand_clusters_[hero_cards[0] * kDeckSize + hero_cards[1]] =
+        blueprint.Cluster(round_, hero_cards);
+
+    for (PlayerId player = 0; player < kPlayers; ++player) {
+      ranges_[player].assign(hands_.size(), 1);
+    }
+    SumRanges();
+  }  // SubgameSolver()
+
+  /*
+    @brief Seeds the regrets of every infoset in the subgame with the
+        blueprint's policy.
+
+    @param weight The regret given to an action played with probability 1.
+  */
+  void Seed(Regret weight) {
+    const std::size_t n_actions = action_abstraction_.ActionCount(round_);
+    for (SequenceId seq = 0; seq < blueprint_seqs_.size(); ++seq) {
+      if (blueprint_seqs_[seq] == kIllegalId) continue;
+      std::size_t offset = action_abstraction_.LegalOffset(round_, seq);
+      for (CardCluster cluster = 0; cluster < blueprint_.NumClusters(round_);
+           ++cluster) {
+        Policy blueprint = blueprint_.Policy(round_, cluster,
+                                             blueprint_seqs_[seq]);
+        std::size_t legal_i = 0;
+        for (std::size_t i = 0; i < n_actions; ++i) {
+          if (action_abstraction_.Next(round_, seq, i) == kIllegalId) continue;
+          Regret& regret = regrets_(cluster, offset + legal_i);
+          if (blueprint_next_[seq * n_actions + i] == kIllegalId) {
+            regret = 0;
+          } else {
+            regret = std::rint(blueprint[i] * weight);
+          }
+          ++legal_i;
+        }
+      }
+    }
+  }  // Seed()
+
+  /*
+    @brief Weights the ranges of the other players by how likely the blueprint
+        is to have taken the given actions with each hand.
+
+    @param history The actions taken earlier in the hand. The hero's actions
+        are skipped.
+  */
+  void WeightRanges(const std::vector<BlueprintAction>& history) {
+    std::array<std::vector<CardCluster>, kNRounds> hand_clusters;
+    PublicHand<ISO_Card> cards = root_.PlayerCards(hero_);
+    for (const BlueprintAction& action : history) {
+      if (action.player == hero_) continue;
+      std::vector<CardCluster>& clusters = hand_clusters[+action.round];
+      if (clusters.empty()) {
+        for (const Hand<ISO_Card>& hand : hands_) {
+          std::copy(hand.begin(), hand.end(), cards.begin());
+          clusters.push_back(blueprint_.Cluster(action.round, cards));
+        }
+      }
+      std::vector<double>& range = ranges_[action.player];
+      for (std::size_t h = 0; h < hands_.size(); ++h) {
+        Policy blueprint = blueprint_.Policy(action.round, clusters[h],
+                                             action.seq);
+        range[h] *= blueprint[action.action_idx];
+      }
+    }
+    SumRanges();
+  }  // WeightRanges()
+
+  /*
+    @brief Searches the subgame until the time budget is exhausted.
+
+    @param budget Milliseconds to search for.
+
+    @return The hero's average root policy, indexed by round action. Actions
+        which are illegal in the subgame are 0.
+  */
+  Policy Solve(double budget) {
+    return Search(budget, std::numeric_limits<std::size_t>::max());
+  }
+
+  /*
+    @brief Searches the subgame for a fixed number of iterations rather than
+        for a time budget, so that how far the search gets does not depend on
+        the speed of the machine.
+
+    @param iterations Number of iterations each search thread runs in each
+        epoch.
+
+    @return The hero's average root policy, as with Solve().
+  */
+  Policy SolveIterations(std::size_t iterations) {
+    return Search(0, iterations);
+  }
+
+  /*
+    @brief Values a state at the depth limit by rolling out the blueprint for
+        the rest of the hand.
+
+    @param state A state of the game with every player's hand and the whole
+        board set.
+    @param player The player to value the state for.
+    @param blueprint_seq The blueprint sequence of the state. If it is
+        kIllegalId, the rest of the hand is checked down.
+
+    @return The player's stack at the end of the hand.
+  */
+  double LeafValue(const Node<kPlayers>& state, PlayerId player,
+                   SequenceId blueprint_seq) const {
+    RoundClusters clusters{};
+    for (PlayerId p = 0; p < kPlayers; ++p) {
+      for (RoundId r = +state.round(); r < kNRounds; ++r) {
+        clusters[r][p] = blueprint_.Cluster(Round{r},
+                                            state.PlayerCards(p, Round{r}));
+      }
+    }
+    return Rollout(state, player, blueprint_seq, clusters);
+  }
+
+  /* @brief Returns the card cluster of the hero's hand at the root. */
+  CardCluster HeroCluster() const {
+    PublicHand<ISO_Card> hero_cards = root_.PlayerCards(hero_);
+    return hand_clusters_[hero_cards[0] * kDeckSize + hero_cards[1]];
+  }
+
+  /* @brief action_abstraction_ getter function */
+  const auto& action_abstraction() const { return action_abstraction_; }
+
+  /* @brief regrets_ getter function */
+  const auto& regrets() const { return regrets_; }
+
+  /*
+    @brief Sets the seed of the random number generators used for sampling.
+
+    Search thread i of epoch e seeds its generator with seed + e * kThreads + i
+    when it starts.
+  */
+  void SetSeed(Random::Seed seed) {
+    seed_ = seed;
+  }
+
+ private:
+  /*
+    @brief Searches the subgame in epochs until the time budget is exhausted
+        or each thread has run the given number of iterations in every epoch.
+
+    @param budget Milliseconds to search for.
+    @param iterations Most iterations each thread runs in each epoch.
+  */
+  Policy Search(double budget, std::size_t iterations) {
+    std::array<std::array<double, kActions>, kThreads> policy_sums{};
+    std::atomic<bool> should_continue;
+    static_assert(std::atomic<bool>::is_always_lock_free);
+
+    auto search_fn = [&](std::size_t thread, int epoch) {
+      rng_.seed(Random::Seed(seed_() + epoch * kThreads + thread));
+      const double weight = epoch + 1.0;
+      for (std::size_t it = 0;
+           it < iterations && should_continue.load(std::memory_order_acquire);
+           ++it) {
+        Node<kPlayers> state = root_;
+        RoundClusters clusters = SampleCards(state);
+        for (PlayerId player = 0; player < kPlayers; ++player) {
+          if (state.folded(player) || state.stack(player) == 0) continue;
+          Traverse(state, clusters, 0, blueprint_seqs_[0], player);
+        }
+        std::array<double, kActions> strategy =
+            CalculateStrategy(clusters[+round_][hero_], 0);
+        for (std::size_t i = 0; i < kActions; ++i) {
+          policy_sums[thread][i] += weight * strategy[i];
+        }
+      }
+    };  // search_fn()
+
+    Timer budget_timer;
+    std::array<std::thread, kThreads> threads;
+    for (int epoch = 0; epoch < kEpochs; ++epoch) {
+      should_continue.store(true, std::memory_order_release);
+      for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i] = std::thread(search_fn, i, epoch);
+      }
+      if (iterations == std::numeric_limits<std::size_t>::max()) {
+        double epoch_end = budget * (epoch + 1) / kEpochs;
+        double remaining = epoch_end - budget_timer.Check();
+        if (remaining > 0) {
+          std::this_thread::sleep_for(Timer::Milliseconds{remaining});
+        }
+        should_continue.store(false, std::memory_order_release);
+      }
+      for (std::size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+      }
+      double d = (epoch + 1.0) / (epoch + 2.0);
+      regrets_.for_each_value([=](Regret& regret) {
+        regret = std::rint(regret * d);
+      });
+    }  // for epoch
+
+    std::array<double, kActions> legal_sums{};
+    for (const std::array<double, kActions>& sums : policy_sums) {
+      std::transform(sums.begin(), sums.end(), legal_sums.begin(),
+                     legal_sums.begin(), std::plus<double>{});
+    }
+    if (std::accumulate(legal_sums.begin(), legal_sums.end(), 0.0) == 0) {
+      legal_sums = CalculateStrategy(HeroCluster(), 0);
+    }
+    Normalize(legal_sums);
+
+    Policy policy{};
+    std::size_t legal_i = 0;
+    for (std::size_t i = 0; i < action_abstraction_.ActionCount(round_); ++i) {
+      if (action_abstraction_.Next(round_, 0, i) == kIllegalId) continue;
+      policy[i] = legal_sums[legal_i];
+      ++legal_i;
+    }
+    return policy;
+  }  // Search()
+
+  /*
+    @brief Restricts the blueprint's actions to the given round.
+
+    Entries after the round's action count are padded with actions that are
+    never legal so that the indicies of the subgame actions match the
+    blueprint's.
+  */
+  static std::array<AbstractAction, kActions> SubgameActions(
+      const Blueprint& blueprint, Round round) {
+    std::array<AbstractAction, kActions> actions = blueprint.Actions(round);
+    std::size_t n_actions = blueprint.ActionCount(round);
+    for (std::size_t i = 0; i < kActions; ++i) {
+      if (i >= n_actions) actions[i] = {Action::kFold, 0, -1};
+      actions[i].min_round = round;
+      actions[i].max_round = round;
+    }
+    return actions;
+  }  // SubgameActions()
+
+  /*
+    @brief Finds the blueprint sequence of each sequence of the subgame.
+
+    @param state State of the game at the given sequence. Moves made on it are
+        reverted with Node::Undo() before returning.
+    @param seq The sequence of the subgame.
+    @param blueprint_seq The blueprint sequence of the state.
+  */
+  void MapBlueprint(Node<kPlayers>& state, SequenceId seq,
+                    SequenceId blueprint_seq) {
+    blueprint_seqs_[seq] = blueprint_seq;
+    nda::const_vector_ref<AbstractAction> actions =
+        action_abstraction_.Actions(round_);
+    for (nda::index_t i = 0; i < actions.width(); ++i) {
+      SequenceId next_seq = action_abstraction_.Next(round_, seq, i);
+      if (next_seq == kIllegalId) continue;
+      SequenceId next_blueprint = kIllegalId;
+      if (blueprint_seq != kIllegalId) {
+        next_blueprint = blueprint_.Next(round_, blueprint_seq, i);
+      }
+      blueprint_next_[seq * actions.width() + i] = next_blueprint;
+      typename Node<kPlayers>::UndoRecord undo;
+      state.Apply(actions(i).play, state.ProportionToChips(actions(i).size),
+                  &undo);
+      if (state.in_progress() && state.round() == round_ &&
+          state.acting_player() != state.kChancePlayer) {
+        MapBlueprint(state, next_seq, next_blueprint);
+      }
+      state.Undo(undo);
+    }
+  }  // MapBlueprint()
+
+  /* @brief Returns the number of board cards revealed at the root. */
+  CardN Revealed() const {
+    CardN revealed = 0;
+    for (RoundId r = 1; r <= +round_; ++r) revealed += kCardsPerRound[r];
+    return revealed;
+  }
+
+  /* @brief Computes the running sums of each player's range. */
+  void SumRanges() {
+    for (PlayerId player = 0; player < kPlayers; ++player) {
+      range_sums_[player].resize(ranges_[player].size());
+      std::partial_sum(ranges_[player].begin(), ranges_[player].end(),
+                       range_sums_[player].begin());
+    }
+  }
+
+  /*
+    @brief Samples a hand from the given player's range.
+
+    If no hand in the range has any weight, every hand is equally likely.
+
+    @return The index of the hand in hands_.
+  */
+  std::size_t DrawHand(PlayerId player) {
+    const std::vector<double>& sums = range_sums_[player];
+    if (sums.back() <= 0) {
+      UniformIntDistribution<std::size_t> rand_hand(0, hands_.size() - 1);
+      return rand_hand(rng_());
+    }
+    std::uniform_real_distribution<double> sampler(0, sums.back());
+    auto it = std::upper_bound(sums.begin(), sums.end(), sampler(rng_()));
+    return std::min<std::size_t>(it - sums.begin(), hands_.size() - 1);
+  }
+
+  /*
+    @brief Samples a hand from the given player's range among the hands which
+        do not hold any of the given cards.
+
+    If none of those hands have any weight, each of them is equally likely.
+
+    @param player The player whose range to sample from.
+    @param dealt Which cards have already been dealt.
+
+    @return The index of the hand in hands_.
+  */
+  std::size_t DrawHand(PlayerId player,
+                       const std::array<bool, kDeckSize>& dealt) {
+    const std::vector<double>& range = ranges_[player];
+    auto available = [&](std::size_t h) {
+      return !dealt[hands_[h][0]] && !dealt[hands_[h][1]];
+    };
+    double total = 0;
+    std::size_t n_available = 0;
+    for (std::size_t h = 0; h < hands_.size(); ++h) {
+      if (!available(h)) continue;
+      total += range[h];
+      ++n_available;
+    }
+    const bool uniform = total <= 0;
+    if (uniform) total = n_available;
+    std::uniform_real_distribution<double> sampler(0, total);
+    double sampled = sampler(rng_());
+    double bound = 0;
+    std::size_t last = 0;
+    for (std::size_t h = 0; h < hands_.size(); ++h) {
+      if (!available(h)) continue;
+      last = h;
+      bound += uniform ? 1 : range[h];
+      if (sampled < bound) break;
+    }
+    return last;
+  }  // DrawHand()
+
+  /*
+    @brief Deals the unknown cards in the given state.
+
+    Every player other than the hero receives a hand from their range and the
+    unrevealed board cards are filled in. The hands are drawn from every range
+    at once and drawn again if any of them share a card. If that keeps
+    happening, each player's hand is drawn from the cards the players before
+    them left.
+
+    @return The card cluster of each player in the root round and in each
+        round after it.
+  */
+  RoundClusters SampleCards(Node<kPlayers>& state) {
+    PublicHand<ISO_Card> hero_cards = state.PlayerCards(hero_);
+    HandArray<ISO_Card, kPlayers> hands;
+    hands[hero_] = {hero_cards[0], hero_cards[1]};
+    std::array<bool, kDeckSize> dealt;
+    for (int deal = 0; ; ++deal) {
+      dealt.fill(false);
+      bool shared = false;
+      for (PlayerId player = 0; player < kPlayers && !shared; ++player) {
+        if (player == hero_) continue;
+        std::size_t h = deal < kMaxDeals ? DrawHand(player)
+                                         : DrawHand(player, dealt);
+        hands[player] = hands_[h];
+        shared = dealt[hands_[h][0]] || dealt[hands_[h][1]];
+        dealt[hands_[h][0]] = true;
+        dealt[hands_[h][1]] = true;
+      }
+      if (!shared) break;
+    }
+
+    std::vector<ISO_Card> deck;
+    for (ISO_Card card : unknown_cards_) {
+      if (!dealt[card]) deck.push_back(card);
+    }
+    BoardArray<ISO_Card> board;
+    CardN revealed = Revealed();
+    std::copy_n(std::next(hero_cards.begin(), kHandCards), revealed,
+                board.begin());
+    for (CardN i = revealed; i < kBoardCards; ++i) {
+      std::size_t dealt_i = i - revealed;
+      UniformIntDistribution<std::size_t> rand_card(dealt_i, deck.size() - 1);
+      std::swap(deck[dealt_i], deck[rand_card(rng_())]);
+      board[i] = deck[dealt_i];
+    }
+    state.SetHands(hands);
+    state.SetBoard(board);
+
+    RoundClusters clusters{};
+    for (PlayerId player = 0; player < kPlayers; ++player) {
+      clusters[+round_][player] =
+          hand_clusters_[hands[player][0] * kDeckSize + hands[player][1]];
+      if (state.folded(player)) continue;
+      for (RoundId r = +round_ + 1; r < kNRounds; ++r) {
+        clusters[r][player] = blueprint_.Cluster(
+            Round{r}, state.PlayerCards(player, Round{r}));
+      }
+    }
+    return clusters;
+  }  // SampleCards()
+
+  /*
+    @brief Computes the strategy at the given infoset from regrets.
+
+    @return An array with the computed strategy. The ith element of the array is
+        the probability of choosing the ith legal action.
+  */
+  std::array<double, kActions> CalculateStrategy(CardCluster card_bucket,
+                                                 SequenceId seq) const {
+    std::size_t offset = action_abstraction_.LegalOffset(round_, seq);
+    nda::size_t legal_actions =
+        action_abstraction_.NumLegalActions(round_, seq);
+    Regret sum = 0;
+    for (std::size_t i = offset; i < offset + legal_actions; ++i) {
+      sum += std::max(0, regrets_(card_bucket, i));
+    }
+    std::array<double, kActions> strategy = {0};
+    for (std::size_t i = 0; i < legal_actions; ++i) {
+      if (sum > 0) {
+        strategy[i] = std::max(0, regrets_(card_bucket, offset + i));
+        strategy[i] /= sum;
+      } else {
+        strategy[i] = 1.0 / legal_actions;
+      }
+    }
+    return strategy;
+  }  // CalculateStrategy()
+
+  /*
+    @brief Plays out the rest of the hand with the blueprint.
+
+    Each player samples an action from the blueprint's policy among the actions
+    which are legal in both the blueprint and the game. Once the blueprint
+    sequence is unknown or has no such action, the rest of the hand is checked
+    down.
+
+    @param state The state to play out from.
+    @param player The player to value the state for.
+    @param seq The blueprint sequence of the state.
+    @param clusters The card cluster of each player in the rounds to play.
+
+    @return The player's stack at the end of the hand.
+  */
+  double Rollout(Node<kPlayers> state, PlayerId player, SequenceId seq,
+                 const RoundClusters& clusters) const {
+    std::uniform_real_distribution<double> sampler(0, 1);
+    while (state.in_progress()) {
+      if (state.acting_player() == state.kChancePlayer) {
+        state.ProceedPlay();
+        continue;
+      }
+      Round round = state.round();
+      const std::array<AbstractAction, kActions>& actions =
+          round_actions_[+round];
+      std::array<double, kActions> weights{};
+      if (seq != kIllegalId && seq != kLeafId) {
+        Policy blueprint = blueprint_.Policy(
+            round, clusters[+round][state.acting_player()], seq);
+        for (std::size_t i = 0; i < round_action_counts_[+round]; ++i) {
+          if (blueprint_.Next(round, seq, i) != kIllegalId &&
+              state.IsLegal(actions[i])) {
+            weights[i] = std::max(0.0f, blueprint[i]);
+          }
+        }
+      }
+      double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+      if (total <= 0) {
+        state.Apply(state.CanCheckCall() ? Action::kCheckCall : Action::kAllIn);
+        seq = kIllegalId;
+        continue;
+      }
+      double sampled = sampler(rng_()) * total;
+      double bound = 0;
+      std::size_t action_idx = 0;
+      for (std::size_t i = 0; i < kActions; ++i) {
+        if (weights[i] == 0) continue;
+        action_idx = i;
+        bound += weights[i];
+        if (sampled < bound) break;
+      }
+      seq = blueprint_.Next(round, seq, action_idx);
+      state.Apply(actions[action_idx]);
+    }  // while state.in_progress()
+    state.AwardPot(state.single_run_);
+    return state.stack(player);
+  }  // Rollout()
+
+  /*
+    @brief Recursively updates the given player's regrets in the subgame.
+
+    @param state State of the game at the current recursive call. Moves made on
+        it are reverted with Node::Undo() before returning.
+    @param clusters The card cluster of each player in each round.
+    @param seq The sequence id of the infoset at the current recursive call.
+    @param blueprint_seq The blueprint sequence of the current recursive call.
+    @param player The player whose regrets are being updated.
+
+    @return The value of the node.
+  */
+  double Traverse(Node<kPlayers>& state, const RoundClusters& clusters,
+                  SequenceId seq, SequenceId blueprint_seq, PlayerId player) {
+    if (state.folded(player)) {
+      return state.stack(player);
+    } else if (!state.in_progress() || state.round() != round_ ||
+               state.acting_player() == state.kChancePlayer) {
+      return Rollout(state, player, blueprint_seq, clusters);
+    }
+
+    PlayerId acting_player = state.acting_player();
+    nda::const_vector_ref<AbstractAction> actions =
+        action_abstraction_.Actions(round_);
+    const SequenceId* blueprint_next =
+        blueprint_next_.data() + seq * actions.width();
+    std::array<double, kActions> strategy =
+        CalculateStrategy(clusters[+round_][acting_player], seq);
+
+    if (acting_player == player) {
+      std::size_t offset = action_abstraction_.LegalOffset(round_, seq);
+      std::array<double, kActions> action_values;
+      double value = 0;
+      std::size_t legal_i = 0;
+      for (nda::index_t i = 0; i < actions.width(); ++i) {
+        SequenceId next_seq = action_abstraction_.Next(round_, seq, i);
+        if (next_seq == kIllegalId) continue;
+        typename Node<kPlayers>::UndoRecord undo;
+        state.Apply(actions(i).play, state.ProportionToChips(actions(i).size),
+                    &undo);
+        action_values[legal_i] = Traverse(state, clusters, next_seq,
+                                          blueprint_next[i], player);
+        state.Undo(undo);
+        value += action_values[legal_i] * strategy[legal_i];
+        ++legal_i;
+      }
+      for (std::size_t i = 0; i < legal_i; ++i) {
+        Regret& regret = regrets_(clusters[+round_][player], offset + i);
+        Regret difference =
+            static_cast<Regret>(std::rint(action_values[i] - value));
+        regret = std::max(regret_floor_, regret + difference);
+      }
+      return value;
+    }
+
+    std::uniform_real_distribution<double> sampler(0, 1);
+    double sampled = sampler(rng_());
+    double bound = 0;
+    std::size_t legal_i = 0;
+    nda::index_t last_legal = 0;
+    for (nda::index_t i = 0; i < actions.width(); ++i) {
+      if (action_abstraction_.Next(round_, seq, i) == kIllegalId) continue;
+      last_legal = i;
+      bound += strategy[legal_i];
+      if (sampled < bound) break;
+      ++legal_i;
+    }
+    typename Node<kPlayers>::UndoRecord undo;
+    state.Apply(actions(last_legal).play,
+                state.ProportionToChips(actions(last_legal).size), &undo);
+    double value = Traverse(state, clusters,
+                            action_abstraction_.Next(round_, seq, last_legal),
+                            blueprint_next[last_legal], player);
+    state.Undo(undo);
+    return value;
+  }  // Traverse()
+};  // class SubgameSolver
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_MCCFR_SUBGAME_SOLVER_H_
@@ -0,0 +1,142 @@
+#include "poker/batch_evaluator.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "poker/definitions.h"
+#include "SKPokerEval/src/SevenEval.h"
+
+namespace fishbait {
+
+namespace {
+
+/* Number of cards in a hand, and the most cards of one rank. */
+constexpr uint8_t kCards = kPlayerCards;
+constexpr uint8_t kMaxOfRank = 4;
+constexpr uint8_t kBase = kMaxOfRank + 1;
+
+constexpr uint32_t Power(uint32_t base, uint8_t exponent) {
+  return exponent == 0 ? 1 : base * Power(base, exponent - 1);
+}
+
+/*
+  @brief Calls fn(counts, total, key) for every way to put at most kCards
+      cards into the given number of ranks.
+
+  @param n_ranks The number of ranks.
+  @param fn Function of the number of cards of each rank, the number of cards,
+      and the key of the counts, which has the count of each rank as a base 5
+      digit.
+*/
+template <typename Fn>
+void ForEachCounts(uint8_t n_ranks, Fn&& fn) {
+  std::vector<uint8_t> counts(n_ranks);
+  for (uint32_t key = 0; key < Power(kBase, n_ranks); ++key) {
+    uint32_t digits = key;
+    uint8_t total = 0;
+    for (uint8_t r = 0; r < n_ranks; ++r) {
+      counts[r] = digits % kBase;
+      digits /= kBase;
+      total += counts[r];
+    }
+    if (total <= kCards) fn(counts, total, key);
+  }
+}  // ForEachCounts()
+
+/* @brief Ranks 7 cards with SevenEval. */
+SevenEval::Rank GetRank(const std::array<SK_Card, kCards>& cards) {
+  return SevenEval::GetRank(cards[0], cards[1], cards[2], cards[3], cards[4],
+                            cards[5], cards[6]);
+}
+
+}  // namespace
+
+BatchEvaluator::BatchEvaluator()
+    : low_entries_(Power(kBase, kLowRanks)),
+      high_entries_(Power(kBase, kHighRanks)),
+      flush_ranks_(kRankMask + 1) {
+  for (SK_Card card = 0; card < kDeckSize; ++card) {
+    const uint8_t rank = card / kSuits;
+    const uint8_t suit = card % kSuits;
+    card_keys_[card] = uint64_t{1} << (kSuitShift + 4 * suit);
+    if (rank < kLowRanks) {
+      card_keys_[card] += Power(kBase, rank);
+    } else {
+      card_keys_[card] += uint64_t{Power(kBase, rank - kLowRanks)}
+                          << kHighShift;
+    }
+    card_suits_[card] = uint64_t{1} << (suit * kSuitMaskBits + rank);
+  }
+
+  /* Number each way to put cards into the upper ranks among the ways with
+     the same number of cards. */
+  std::array<uint32_t, kCards + 1> high_ways{};
+  ForEachCounts(kHighRanks, [&](const std::vector<uint8_t>&, uint8_t total,
+                                uint32_t key) {
+    high_entries_[key] = high_ways[total]++;
+  });
+
+  /* The entries of the hands with each number of cards in the lower ranks
+     come after the hands with fewer, and within them, each way to put the
+     cards into the lower ranks has a run of entries, one for each way to put
+     the rest into the upper ranks. */
+  std::array<uint32_t, kCards + 1> low_ways{};
+  ForEachCounts(kLowRanks, [&](const std::vector<uint8_t>&, uint8_t total,
+                               uint32_t) {
+    ++low_ways[total];
+  });
+  std::array<uint32_t, kCards + 1> first_entry{};
+  uint32_t n_entries = 0;
+  for (uint8_t total = 0; total <= kCards; ++total) {
+    first_entry[total] = n_entries;
+    n_entries += low_ways[total] * high_ways[kCards - total];
+  }
+  std::array<uint32_t, kCards + 1> low_seen{};
+  ForEachCounts(kLowRanks, [&](const std::vector<uint8_t>&, uint8_t total,
+                               uint32_t key) {
+    low_entries_[key] = first_entry[total] +
+                        low_seen[total]++ * high_ways[kCards - total];
+  });
+
+  /* Rank a hand with each count of ranks. Consecutive cards get consecutive
+     suits, so the cards of a rank are different cards and no suit has more
+     than 2 of them. */
+  ranks_.resize(n_entries);
+  ForEachCounts(kLowRanks, [&](const std::vector<uint8_t>& low_counts,
+                               uint8_t low_total, uint32_t low_key) {
+    ForEachCounts(kHighRanks, [&](const std::vector<uint8_t>& high_counts,
+                                  uint8_t high_total, uint32_t high_key) {
+      if (low_total + high_total != kCards) return;
+      std::array<SK_Card, kCards> cards;
+      uint8_t n = 0;
+      for (uint8_t rank = 0; rank < kRanks; ++rank) {
+        uint8_t count = rank < kLowRanks ? low_counts[rank] :
+                                           high_counts[rank - kLowRanks];
+        for (uint8_t i = 0; i < count; ++i, ++n) {
+          cards[n] = rank * kSuits + n % kSuits;
+        }
+      }
+      ranks_[low_entries_[low_key] + high_entries_[high_key]] =
+          GetRank(cards);
+    });
+  });
+
+  /* Rank a flush of each set of ranks. The flush has a different rank in each
+     card, so the other cards cannot make quads or a full house with it, and
+     any will do. */
+  const std::array<SK_Card, 2> others = {0 * kSuits + 1, 1 * kSuits + 2};
+  for (uint64_t mask = 0; mask <= kRankMask; ++mask) {
+    const int n_suited = __builtin_popcountll(mask);
+    if (n_suited < 5 || n_suited > kCards) continue;
+    std::array<SK_Card, kCards> cards;
+    uint8_t n = 0;
+    for (uint8_t rank = 0; rank < kRanks; ++rank) {
+      if (mask & (uint64_t{1} << rank)) cards[n++] = rank * kSuits;
+    }
+    for (uint8_t i = 0; n < kCards; ++i, ++n) cards[n] = others[i];
+    flush_ranks_[mask] = GetRank(cards);
+  }
+}  // BatchEvaluator()
+
+}  // namespace fishbait
@@ -0,0 +1,167 @@
+#ifndef AI_SRC_POKER_BATCH_EVALUATOR_H_
+#define AI_SRC_POKER_BATCH_EVALUATOR_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "poker/definitions.h"
+#include "SKPokerEval/src/SevenEval.h"
+
+namespace fishbait {
+
+/* Ranks many 7 card hands at once, giving the same ranks as
+   SevenEval::GetRank().
+
+   Each card has a key, and the key of a hand is the sum of the keys of its
+   cards. The low bits of a key count the cards of each rank in base 5, split
+   between the lower and upper ranks, and the high bits count the cards of each
+   suit. A hand which is not a flush is ranked by the counts of its ranks alone,
+   through a table with one entry for each of the 49205 ways 7 cards can fall
+   into ranks. A flush is ranked by the ranks of its suit alone, through a table
+   indexed by their bit mask. Both tables are filled from SevenEval::GetRank().
+
+   Since keys add up, the key of a board is computed once and shared by every
+   hand ranked with it. The keys of a chunk of hands are computed in one branch
+   free loop, and the table entry of each hand is prefetched before any of them
+   is read, so the lookups of a chunk are in flight at the same time rather
+   than one after another. */
+class BatchEvaluator {
+ public:
+  BatchEvaluator();
+  BatchEvaluator(const BatchEvaluator&) = delete;
+  BatchEvaluator& operator=(const BatchEvaluator&) = delete;
+  BatchEvaluator(BatchEvaluator&&) = delete;
+  BatchEvaluator& operator=(BatchEvaluator&&) = delete;
+
+  /*
+    @brief Returns the evaluator of the process.
+
+    Building an evaluator fills its tables, so everything which needs one
+    borrows this one. It is built the first time it is asked for. Ranking only
+    reads it, so it can be used by every thread at once.
+  */
+  static const BatchEvaluator& Shared() {
+    static const BatchEvaluator shared;
+    return shared;
+  }
+
+  /*
+    @brief Ranks hands that all share the same board.
+
+    @param board The board shared by every hand. SK indexing.
+    @param hands Pointer to the first of the hole cards to rank. SK indexing.
+    @param n The number of hands to rank.
+    @param ranks Pointer to where to write the rank of each hand.
+  */
+  void RankHands(const BoardArray<SK_Card>& board, const Hand<SK_Card>* hands,
+                 std::size_t n, SevenEval::Rank* ranks) const {
+    uint64_t board_key = 0;
+    uint64_t board_suits = 0;
+    for (SK_Card card : board) {
+      board_key += card_keys_[card];
+      board_suits |= card_suits_[card];
+    }
+    RankChunks(n, ranks, [&](std::size_t i, uint64_t* key, uint64_t* suits) {
+      *key = board_key + card_keys_[hands[i][0]] + card_keys_[hands[i][1]];
+      *suits = board_suits | card_suits_[hands[i][0]] |
+               card_suits_[hands[i][1]];
+    });
+  }  // RankHands()
+
+  /*
+    @brief Ranks independent 7 card hands.
+
+    @param hands Pointer to the first of the hands to rank. SK indexing.
+    @param n The number of hands to rank.
+    @param ranks Pointer to where to write the rank of each hand.
+  */
+  void RankHands(const PublicHand<SK_Card>* hands, std::size_t n,
+                 SevenEval::Rank* ranks) const {
+    RankChunks(n, ranks, [&](std::size_t i, uint64_t* key, uint64_t* suits) {
+      *key = 0;
+      *suits = 0;
+      for (SK_Card card : hands[i]) {
+        *key += card_keys_[card];
+        *suits |= card_suits_[card];
+      }
+    });
+  }  // RankHands()
+
+ private:
+  /* Number of hands whose lookups are in flight at once. */
+  static constexpr std::size_t kChunkSize = 16;
+
+  static constexpr uint8_t kRanks = 13;
+  static constexpr uint8_t kSuits = 4;
+
+  /* Layout of a key. The count of each lower rank is a base 5 digit of the
+     low key, and the count of each upper rank is a base 5 digit of the high
+     key. The count of each suit is a 4 bit field after them. */
+  static constexpr uint8_t kLowRanks = 7;
+  static constexpr uint8_t kHighRanks = kRanks - kLowRanks;
+  static constexpr uint8_t kHighShift = 17;
+  static constexpr uint8_t kSuitShift = 32;
+  static constexpr uint64_t kLowMask = (uint64_t{1} << kHighShift) - 1;
+  static constexpr uint64_t kHighMask = (uint64_t{1} << 14) - 1;
+  /* Adding 3 to every suit count carries into the top bit of the suits with
+     at least 5 cards. */
+  static constexpr uint64_t kFlushAdd = uint64_t{0x3333} << kSuitShift;
+  static constexpr uint64_t kFlushBits = uint64_t{0x8888} << kSuitShift;
+
+  /* The ranks of each suit in a hand are a 16 bit field of the suit mask. */
+  static constexpr uint8_t kSuitMaskBits = 16;
+  static constexpr uint64_t kRankMask = (uint64_t{1} << kRanks) - 1;
+
+  /*
+    @brief Ranks n hands in chunks.
+
+    @param n The number of hands to rank.
+    @param ranks Pointer to where to write the rank of each hand.
+    @param hand_key Function which computes the key and suit mask of hand i.
+  */
+  template <typename KeyFn>
+  void RankChunks(std::size_t n, SevenEval::Rank* ranks,
+                  KeyFn&& hand_key) const {
+    std::array<uint64_t, kChunkSize> keys;
+    std::array<uint64_t, kChunkSize> suits;
+    std::array<uint32_t, kChunkSize> entries;
+    for (std::size_t begin = 0; begin < n; begin += kChunkSize) {
+      const std::size_t size = std::min(kChunkSize, n - begin);
+      for (std::size_t i = 0; i < size; ++i) {
+        hand_key(begin + i, &keys[i], &suits[i]);
+      }
+      for (std::size_t i = 0; i < size; ++i) {
+        entries[i] = low_entries_[keys[i] & kLowMask] +
+                     high_entries_[(keys[i] >> kHighShift) & kHighMask];
+        __builtin_prefetch(ranks_.data() + entries[i]);
+      }
+      for (std::size_t i = 0; i < size; ++i) {
+        const uint64_t flush = (keys[i] + kFlushAdd) & kFlushBits;
+        if (flush == 0) {
+          ranks[begin + i] = ranks_[entries[i]];
+        } else {
+          const uint8_t suit = (__builtin_ctzll(flush) - kSuitShift) / 4;
+          ranks[begin + i] = flush_ranks_[(suits[i] >>
+                                           (suit * kSuitMaskBits)) &
+                                          kRankMask];
+        }
+      }
+    }  // for begin
+  }  // RankChunks()
+
+  std::array<uint64_t, kDeckSize> card_keys_;
+  std::array<uint64_t, kDeckSize> card_suits_;
+  /* The entry of a hand in ranks_ is the sum of the entries of its low key and
+     its high key. */
+  std::vector<uint32_t> low_entries_;
+  std::vector<uint32_t> high_entries_;
+  std::vector<SevenEval::Rank> ranks_;  // rank of each count of ranks
+  std::vector<SevenEval::Rank> flush_ranks_;  // rank of each flush suit mask
+};  // class BatchEvaluator
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_POKER_BATCH_EVALUATOR_H_
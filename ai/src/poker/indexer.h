@@ -35,6 +35,11 @@ class Indexer {
   hand_indexer_t* isocalc_;
 
  public:
+  /* Resumable indexing state. Holds the cards of the rounds indexed so far, so
+     a prefix of rounds can be indexed once and the state copied to extend it
+     with different cards for the following rounds. */
+  using State = hand_indexer_state_t;
+
   Indexer() {
     isocalc_ = new hand_indexer_t();
     std::array<CardN, Rounds()> cpr_array = {kCardsPerRound...};
@@ -50,6 +55,19 @@ class Indexer {
   Indexer(Indexer&&) = delete;
   Indexer& operator=(Indexer&&) = delete;
 
+  /*
+    @brief Returns the indexer of the process with these cards per round.
+
+    Building an indexer fills its tables, so rather than each object building
+    its own, everything which needs one borrows this one. It is built the
+    first time it is asked for. Indexing only reads it, so it can be used by
+    every thread at once.
+  */
+  static const Indexer& Shared() {
+    static const Indexer shared;
+    return shared;
+  }
+
   /*
     @brief Returns the index of the given cards at the last round.
   */
@@ -90,6 +108,33 @@ class Indexer {
     return indicies;
   }
 
+  /*
+    @brief Returns a State with no rounds indexed.
+  */
+  State NewState() const {
+    State state;
+    hand_indexer_state_init(isocalc_, &state);
+    return state;
+  }
+
+  /*
+    @brief Extends the state with the cards of its next round and returns the
+        index of the hand at that round.
+
+    @param cards Pointer to the cards dealt in the next round of the state.
+    @param state The state to extend.
+  */
+  hand_index_t IndexNextRound(const ISO_Card* cards, State* state) const {
+    return hand_index_next_round(isocalc_, cards, state);
+  }
+
+  /*
+    @brief Returns the number of isomorphic hands in the given round.
+  */
+  hand_index_t Size(std::size_t round = Rounds() - 1) const {
+    return hand_indexer_size(isocalc_, round);
+  }
+
   /*
     @brief Returns the cards of the given index.
   */
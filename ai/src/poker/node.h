@@ -17,8 +17,10 @@
 #include <utility>
 
 #include "mccfr/definitions.h"
+#include "poker/batch_evaluator.h"
 #include "poker/card_utils.h"
 #include "poker/definitions.h"
+#include "poker/node_rules.h"
 #include "SKPokerEval/src/SevenEval.h"
 #include "utils/array.h"
 #include "utils/fraction.h"
@@ -28,26 +30,27 @@ namespace fishbait {
 
 /* QuotaT is used to represent exact award quotas before being apportioned into
    discrete chips (double or utils::Fraction). This choice could impact the
-   accuracy and/or speed of the awarded chip amounts. */
-template <PlayerId kPlayers = 6, typename QuotaT = double>
-class Node {
+   accuracy and/or speed of the awarded chip amounts. Rules decides which game
+   rules are supported at compile time (see poker/node_rules.h). */
+template <PlayerId kPlayers = 6, typename QuotaT = double,
+          typename Rules = FullRules>
+class Node : private AnteAttributes<Rules::kAntes>,
+             private RakeAttributes<QuotaT, Rules::kRake> {
  private:
   // Attributes
   // --------------------------------------------------------------------------
 
-  Chips big_blind_;         // how many chips the big blind is
-  Chips small_blind_;       // how many chips the small blind is
-  Chips ante_;              /* how many chips each player must contribute to the
-                               pot on each hand in expectation */
-  bool big_blind_ante_;     /* does the big blind pays the ante for everyone in
-                               the game? */
-  bool blind_before_ante_;  /* should players should cover the blind instead of
-                               the ante if they don't have enough chips to pay
-                               both? */
-  QuotaT rake_;             // proportion of each hand taken as rake
-  Chips rake_cap_;          /* maximum number of chips that can be raked;
-                               rake_cap_ of 0 means no cap */
-  bool no_flop_no_drop_;    // is rake taken on hands without a flop?
+  using AnteAttributesT = AnteAttributes<Rules::kAntes>;
+  using RakeAttributesT = RakeAttributes<QuotaT, Rules::kRake>;
+
+  Chips big_blind_;    // how many chips the big blind is
+  Chips small_blind_;  // how many chips the small blind is
+  using AnteAttributesT::ante_;
+  using AnteAttributesT::big_blind_ante_;
+  using AnteAttributesT::blind_before_ante_;
+  using RakeAttributesT::rake_;
+  using RakeAttributesT::rake_cap_;
+  using RakeAttributesT::no_flop_no_drop_;
 
   // Progress information
   // --------------------------------------------------------------------------
@@ -100,13 +103,21 @@ class Node {
                              cards are in deck_[i * kHandCards] to
                              deck_[i * kHandCards + kHandCards - 1]. Board cards
                              come after the player hands. */
-  enum class DeckState : uint8_t { kManual, kAuto, kAutoDealt };
+  enum class DeckState : uint8_t { kManual, kAuto, kAutoDealt, kAllDealt };
   DeckState deck_state_;  /* kManual indicates that proper shuffling can no
                              longer be guaranteed by automatic dealing. kAuto
                              indicates that automatic dealing may be used.
                              kAutoDealt can only occur during a chance node and
                              indicates that cards were dealt at the chance
-                             node. */
+                             node. kAllDealt indicates that DealAll() dealt the
+                             whole hand, so every chance node until the next
+                             hand uses the cards already dealt. */
+  std::array<SevenEval::Rank, kPlayers> ranks_;  // cached rank of each hand
+  bool ranks_cached_;     /* Deal() ranks every player's hand when it deals the
+                             river, and DealAll() when it deals the whole hand,
+                             so that all the showdowns of that deal can share
+                             the work. Any other change to the deck clears
+                             this flag. */
   inline static thread_local Random rng_;
 
  public:
@@ -124,6 +135,8 @@ class Node {
     @param rake Proportion of each hand taken as rake.
     @param rake_cap Maximum number of chips that can be raked. 0 means no cap.
     @param no_flop_no_drop Is rake taken on hands without a flop?
+
+    Throws if an ante or rake attribute is given that Rules disables.
   */
   Node(std::array<Chips, kPlayers> stacks = StackArray<kPlayers>(10000),
        PlayerId button = 0, Chips big_blind = 100, Chips small_blind = 50,
@@ -132,9 +145,9 @@ class Node {
        Chips rake_cap = 0, bool no_flop_no_drop = false)
 
          // Attributes
-       : big_blind_{big_blind}, small_blind_{small_blind}, ante_{ante},
-         big_blind_ante_{big_blind_ante}, blind_before_ante_{blind_before_ante},
-         rake_{rake}, rake_cap_{rake_cap}, no_flop_no_drop_{no_flop_no_drop},
+       : AnteAttributesT(ante, big_blind_ante, blind_before_ante),
+         RakeAttributesT(rake, rake_cap, no_flop_no_drop),
+         big_blind_{big_blind}, small_blind_{small_blind},
 
          // Progress Information
          button_{button}, in_progress_{false}, round_{Round::kPreFlop},
@@ -146,7 +159,8 @@ class Node {
          max_bet_{big_blind},
 
          // Card Information
-         deck_{UnshuffledDeck<ISO_Card>()}, deck_state_{DeckState::kAuto} {
+         deck_{UnshuffledDeck<ISO_Card>()}, deck_state_{DeckState::kAuto},
+         ranks_{}, ranks_cached_{false} {
     NewHand(button_);
   }  // Node()
   Node(Chips default_stack, PlayerId button = 0, Chips big_blind = 100,
@@ -163,13 +177,53 @@ class Node {
   Node(const Node& other) = default;
   Node& operator=(const Node& other) = default;
 
+  /*
+    @brief Converts a node with other rules to a node with these rules, such as
+        a TrainingRules node to a FullRules node.
+
+    Throws if the other node has an ante or rake attribute that Rules disables.
+  */
+  template <typename OtherRules>
+  explicit Node(const Node<kPlayers, QuotaT, OtherRules>& other)
+         // Attributes
+       : AnteAttributesT(other.ante_, other.big_blind_ante_,
+                         other.blind_before_ante_),
+         RakeAttributesT(other.rake_, other.rake_cap_, other.no_flop_no_drop_),
+         big_blind_{other.big_blind_}, small_blind_{other.small_blind_},
+
+         // Progress Information
+         button_{other.button_}, in_progress_{other.in_progress_},
+         round_{other.round_}, cycled_{other.cycled_},
+         acting_player_{other.acting_player_}, pot_good_{other.pot_good_},
+         no_raise_{other.no_raise_}, folded_{other.folded_},
+         players_left_{other.players_left_},
+         players_all_in_{other.players_all_in_},
+
+         // Chip Information
+         pot_{other.pot_}, bets_{other.bets_}, stack_{other.stack_},
+         min_raise_{other.min_raise_}, max_bet_{other.max_bet_},
+
+         // Card Information
+         deck_{other.deck_},
+         deck_state_{static_cast<DeckState>(other.deck_state_)},
+         ranks_{other.ranks_}, ranks_cached_{other.ranks_cached_} {}
+
+  template <PlayerId, typename, typename>
+  friend class Node;
+
   /* @brief Node serialize function */
   template<class Archive>
   void serialize(Archive& archive) {
-    archive(CEREAL_NVP(big_blind_), CEREAL_NVP(small_blind_), CEREAL_NVP(ante_),
-            CEREAL_NVP(big_blind_ante_), CEREAL_NVP(blind_before_ante_),
-            CEREAL_NVP(rake_), CEREAL_NVP(rake_cap_),
-            CEREAL_NVP(no_flop_no_drop_), CEREAL_NVP(button_),
+    archive(CEREAL_NVP(big_blind_), CEREAL_NVP(small_blind_));
+    if constexpr (Rules::kAntes) {
+      archive(CEREAL_NVP(ante_), CEREAL_NVP(big_blind_ante_),
+              CEREAL_NVP(blind_before_ante_));
+    }
+    if constexpr (Rules::kRake) {
+      archive(CEREAL_NVP(rake_), CEREAL_NVP(rake_cap_),
+              CEREAL_NVP(no_flop_no_drop_));
+    }
+    archive(CEREAL_NVP(button_),
             CEREAL_NVP(in_progress_), CEREAL_NVP(round_), CEREAL_NVP(cycled_),
             CEREAL_NVP(acting_player_), CEREAL_NVP(pot_good_),
             CEREAL_NVP(no_raise_), CEREAL_NVP(folded_),
@@ -177,6 +231,8 @@ class Node {
             CEREAL_NVP(pot_), CEREAL_NVP(bets_), CEREAL_NVP(stack_),
             CEREAL_NVP(min_raise_), CEREAL_NVP(max_bet_), CEREAL_NVP(deck_),
             CEREAL_NVP(deck_state_));
+    // The rank cache is not serialized, so it must be recomputed after loading
+    if constexpr (Archive::is_loading::value) ranks_cached_ = false;
   }
 
   /* @brief Equality comparison operator. */
@@ -264,14 +320,20 @@ class Node {
     // max_bet_ will be set after the blinds and antes are posted
 
     /* Card Information is dealt with by DealCards() and/or set_board() and
-       set_hands(). */
+       set_hands(). A hand dealt by DealAll() was shuffled as well as one dealt
+       at each chance node, so auto dealing can continue. */
+    if (deck_state_ == DeckState::kAllDealt) deck_state_ = DeckState::kAuto;
 
     // Post Blinds, Antes, and Straddles
     Chips effective_ante = ante_;
-    if (ante_ > 0 && !blind_before_ante_) effective_ante = PostAntes();
+    if constexpr (Rules::kAntes) {
+      if (ante_ > 0 && !blind_before_ante_) effective_ante = PostAntes();
+    }
     PostBlind(PlayerIndex(1), small_blind_);
     PostBlind(PlayerIndex(2), big_blind_);
-    if (ante_ > 0 && blind_before_ante_) effective_ante = PostAntes();
+    if constexpr (Rules::kAntes) {
+      if (ante_ > 0 && blind_before_ante_) effective_ante = PostAntes();
+    }
     players_all_in_ = std::count(stack_.begin(), stack_.end(), 0);
     min_raise_ = big_blind_;
     max_bet_ = big_blind_ + effective_ante;
@@ -283,15 +345,18 @@ class Node {
     If a player does not have enough chips to straddle the appropriate amount,
     they do not straddle and no players behind them can straddle either. Can 
     only be called once per hand during the preflop chance node. If in auto deal
-    mode, it also must only be called before any cards have been dealt.
+    mode, it also must only be called before any cards have been dealt. Does not
+    compile if Rules disables straddles.
 
     @param n How many players to try to straddle.
   */
   void PostStraddles(PlayerN n) {
+    static_assert(Rules::kStraddles, "PostStraddles called on a Node whose "
+                                     "rules disable straddles.");
     const std::string func{__func__};
     if (!in_progress_ || acting_player_ != kChancePlayer ||
         round_ != Round::kPreFlop || deck_state_ == DeckState::kAutoDealt ||
-        cycled_ != 0) {
+        deck_state_ == DeckState::kAllDealt || cycled_ != 0) {
       throw std::logic_error(func + " must only be called once per hand during "
                                     "the preflop chance node. If in auto deal "
                                     "mode, it also must only be called before "
@@ -323,14 +388,35 @@ class Node {
     acting_player_ = kChancePlayer;
   }  // PostStraddles()
 
+  /* Record of the cards swapped by Deal(), used by Undo(). */
+  struct DealRecord {
+    /* The most cards that can be dealt at a single chance node. Preflop deals
+       every player's hand and the flop deals the most board cards. */
+    static constexpr CardN kMaxDealt =
+        std::max(kCumulativeCards[+Round::kPreFlop],
+                 kCardsPerRound[+Round::kFlop]);
+    CardN first;  // deck position of the first card dealt
+    CardN n;      // number of cards dealt
+    std::array<CardN, kMaxDealt> swapped;  /* deck position swapped into each
+                                              dealt position */
+    DeckState deck_state;
+  };
+
   /*
     @brief Optionally deal random cards if we are at a chance node.
+
+    @param undo If not null, where to record the cards dealt so that this deal
+        can be reverted with Undo().
   */
-  void Deal() {
+  void Deal(DealRecord* undo = nullptr) {
     const std::string func{__func__};
     if (!in_progress_ || acting_player_ != kChancePlayer) {
       throw std::logic_error(func + " called when the game is not at a chance "
                                     "node.");
+    } else if (deck_state_ == DeckState::kAllDealt) {
+      throw std::logic_error(func + " called after DealAll() dealt the whole "
+                                    "hand. Call ProceedPlay() to use the cards "
+                                    "already dealt.");
     } else if (deck_state_ != DeckState::kAuto) {
       throw std::logic_error(func + " called when the node is not in automatic "
                                     "dealing mode. Call ResetDeck() at the "
@@ -344,12 +430,73 @@ class Node {
       RoundId prev_round = +round_ - 1;
       lb = kCumulativeCards[prev_round];
     }
+    if (undo) {
+      undo->first = lb;
+      undo->n = kCumulativeCards[+round_] - lb;
+      undo->deck_state = deck_state_;
+    }
     for (CardN i = lb; i < kCumulativeCards[+round_]; ++i) {
       UniformIntDistribution<CardN> rand_card(i, deck_.size() - 1);
       CardN selected_card = rand_card(rng_());
       std::swap(deck_[i], deck_[selected_card]);
+      if (undo) undo->swapped[i - lb] = selected_card;
     }
     deck_state_ = DeckState::kAutoDealt;
+
+    /* Every card is known once the river is dealt, so rank the hands now for
+       all the showdowns that follow from this deal. */
+    ranks_cached_ = false;
+    if (round_ == Round::kRiver) CacheRanks();
+  }
+
+  /*
+    @brief Deals every player's hand and the whole board at the preflop chance
+        node.
+
+    The board is not revealed early: PlayerCards() still only shows the board
+    of the current round. Every later chance node of the hand must only call
+    ProceedPlay(), so that the cards dealt here are the ones used, and Deal()
+    throws until the next hand starts. The hands
+    are ranked here for all the showdowns of the hand. Changes to the node
+    after this are reverted by undoing the move made on the preflop chance
+    node's parent or by resetting the deck.
+  */
+  void DealAll() {
+    const std::string func{__func__};
+    if (!in_progress_ || acting_player_ != kChancePlayer ||
+        round_ != Round::kPreFlop) {
+      throw std::logic_error(func + " called when the game is not at the "
+                                    "preflop chance node.");
+    } else if (deck_state_ != DeckState::kAuto) {
+      throw std::logic_error(func + " called when the node is not in automatic "
+                                    "dealing mode. Call ResetDeck() at the "
+                                    "preflop chance node of the next hand to "
+                                    "return to auto deal mode.");
+    }
+    for (CardN i = 0; i < kCumulativeCards[+Round::kRiver]; ++i) {
+      UniformIntDistribution<CardN> rand_card(i, deck_.size() - 1);
+      CardN selected_card = rand_card(rng_());
+      std::swap(deck_[i], deck_[selected_card]);
+    }
+    deck_state_ = DeckState::kAllDealt;
+    CacheRanks();
+  }
+
+  /*
+    @brief Reverts the cards dealt by Deal().
+
+    Every change made to the deck after the given Deal() must already have been
+    reverted.
+
+    @param undo The record written by Deal().
+  */
+  void Undo(const DealRecord& undo) {
+    for (CardN i = undo.n; i > 0; --i) {
+      CardN position = undo.first + i - 1;
+      std::swap(deck_[position], deck_[undo.swapped[i - 1]]);
+    }
+    deck_state_ = undo.deck_state;
+    ranks_cached_ = false;
   }
 
   /*
@@ -462,6 +609,25 @@ class Node {
     return surplus / new_pot;
   }
 
+  /* Compact record of the state that Apply() changes, used by Undo(). */
+  struct UndoRecord {
+    bool in_progress;
+    Round round;
+    PlayCount cycled;
+    PlayerId acting_player;
+    PlayerId pot_good;
+    PlayerId no_raise;
+    PlayerId players_left;
+    PlayerId players_all_in;
+    bool folded;  // folded_ of the acting player
+    DeckState deck_state;
+    Chips pot;
+    Chips bet;    // bets_ of the acting player
+    Chips stack;  // stack_ of the acting player
+    Chips min_raise;
+    Chips max_bet;
+  };
+
   /*
     @brief Apply the given move to this Node object.
     
@@ -470,11 +636,20 @@ class Node {
     @param play The Action to apply to this Node.
     @param size How much more the player is adding to the pot if play is kBet.
         Otherwise it has no significance.
+    @param undo If not null, where to record the state needed to revert this
+        move with Undo().
 
     @return True if the game is still in progress after this move, false if this
         move has ended the game.
   */
-  bool Apply(Action play, Chips size = 0) {
+  bool Apply(Action play, Chips size = 0, UndoRecord* undo = nullptr) {
+    if (undo) {
+      *undo = UndoRecord{in_progress_, round_, cycled_, acting_player_,
+                         pot_good_, no_raise_, players_left_, players_all_in_,
+                         folded_[acting_player_], deck_state_, pot_,
+                         bets_[acting_player_], stack_[acting_player_],
+                         min_raise_, max_bet_};
+    }
     if (!in_progress_) {
       const std::string func{__func__};
       throw std::logic_error(func + " called when a game is not in progress.");
@@ -517,20 +692,51 @@ class Node {
     return in_progress_;
   }  // Apply()
 
+  /*
+    @brief Reverts a move made by Apply().
+
+    Also reverts any ProceedPlay() made after the move. Moves must be reverted
+    in the opposite order they were applied, and every other change made to
+    the node after the given move (i.e. Deal() or AwardPot()) must already have
+    been reverted.
+
+    @param undo The record written by Apply().
+  */
+  void Undo(const UndoRecord& undo) {
+    in_progress_ = undo.in_progress;
+    round_ = undo.round;
+    cycled_ = undo.cycled;
+    acting_player_ = undo.acting_player;
+    pot_good_ = undo.pot_good;
+    no_raise_ = undo.no_raise;
+    players_left_ = undo.players_left;
+    players_all_in_ = undo.players_all_in;
+    folded_[acting_player_] = undo.folded;
+    deck_state_ = undo.deck_state;
+    pot_ = undo.pot;
+    bets_[acting_player_] = undo.bet;
+    stack_[acting_player_] = undo.stack;
+    min_raise_ = undo.min_raise;
+    max_bet_ = undo.max_bet;
+  }  // Undo()
+
   /*
     @brief Apply the given AbstractAction to this Node object.
     
     Must only be called when the game is in progress. Otherwise throws.
 
+    @param undo If not null, where to record the state needed to revert this
+        move with Undo().
+
     @return True if the game is still in progress after this move, false if this
         move has ended the game.
   */
-  bool Apply(const AbstractAction& action) {
+  bool Apply(const AbstractAction& action, UndoRecord* undo = nullptr) {
     if (action.play == Action::kBet) {
       Chips bet_size = ProportionToChips(action.size);
-      return Apply(action.play, bet_size);
+      return Apply(action.play, bet_size, undo);
     }
-    return Apply(action.play);
+    return Apply(action.play, 0, undo);
   }
 
   /* @brief Proceeds play after a chance node. */
@@ -541,19 +747,24 @@ class Node {
                                     "node.");
     }
 
-    /* If we dealt cards at this chance node, auto dealing can continue.
-       Otherwise we must switch over to manual dealing mode as card shuffling
-       can no longer be guaranteed. */
+    /* If we dealt cards at this chance node, auto dealing can continue. If
+       DealAll() dealt the whole hand, its cards are used. Otherwise we must
+       switch over to manual dealing mode as card shuffling can no longer be
+       guaranteed. */
     if (deck_state_ == DeckState::kAutoDealt) {
       deck_state_ = DeckState::kAuto;
-    } else {
+    } else if (deck_state_ != DeckState::kAllDealt) {
       deck_state_ = DeckState::kManual;
     }
 
     if (round_ == Round::kPreFlop) {
       /* PostStraddles() sets cycled_ to the number of players who have
          straddled. Otherwise NewHand() sets it to 0. */
-      acting_player_ = PlayerIndex(3 + cycled_);
+      if constexpr (Rules::kStraddles) {
+        acting_player_ = PlayerIndex(3 + cycled_);
+      } else {
+        acting_player_ = PlayerIndex(3);
+      }
     } else {
       acting_player_ = PlayerIndex(1);
     }
@@ -748,11 +959,23 @@ class Node {
     @return An array of all the cards that the given player can see.
   */
   PublicHand<ISO_Card> PlayerCards(PlayerId player) const {
+    return PlayerCards(player, round_);
+  }
+
+  /*
+    @brief Returns an array of the cards that the given player will see in the
+        given round. Only meaningful for later rounds once DealAll() has dealt
+        their cards.
+
+    @param player The player whose cards to return.
+    @param round The round whose board to include.
+  */
+  PublicHand<ISO_Card> PlayerCards(PlayerId player, Round round) const {
     PublicHand<ISO_Card> public_hand;
     std::copy_n(std::next(deck_.begin(), player * kHandCards), kHandCards,
                 public_hand.begin());
     std::copy_n(std::next(deck_.begin(), kPlayers * kHandCards),
-                kCumulativeCards[+round_] - kCumulativeCards[+Round::kPreFlop],
+                kCumulativeCards[+round] - kCumulativeCards[+Round::kPreFlop],
                 std::next(public_hand.begin(), kHandCards));
     return public_hand;
   }
@@ -764,15 +987,18 @@ class Node {
     std::copy(hand.begin(), hand.end(),
               std::next(deck_.begin(), player * kHandCards));
     deck_state_ = DeckState::kManual;
+    ranks_cached_ = false;
   }
   void SetHands(const HandArray<ISO_Card, kPlayers>& hands) {
     std::copy_n(&hands[0][0], kPlayers * kHandCards, deck_.begin());
     deck_state_ = DeckState::kManual;
+    ranks_cached_ = false;
   }
   void SetBoard(const BoardArray<ISO_Card>& board) {
     std::copy(board.begin(), board.end(),
               std::next(deck_.begin(), kPlayers * kHandCards));
     deck_state_ = DeckState::kManual;
+    ranks_cached_ = false;
   }
 
   /* 
@@ -783,6 +1009,7 @@ class Node {
   */
   void ResetDeck() {
     deck_ = UnshuffledDeck<ISO_Card>();
+    ranks_cached_ = false;
 
     if ((in_progress_ && acting_player_ == kChancePlayer &&
         round_ == Round::kPreFlop) || (!in_progress_ && pot_ == 0)) {
@@ -1098,9 +1325,36 @@ class Node {
     return players_to_award;
   }
 
+  /* @brief Evaluates the hand ranking of the given player. */
+  SevenEval::Rank RankPlayer(PlayerId player) const {
+    PublicHand<ISO_Card> player_cards = PlayerCards(player);
+    std::transform(player_cards.begin(), player_cards.end(),
+                   player_cards.begin(), ConvertISOtoSK);
+    return std::apply(SevenEval::GetRank<>, player_cards);
+  }
+
+  /* @brief Ranks every player's hand with the whole board in one batch and
+         caches the ranks for RankPlayers(). */
+  void CacheRanks() {
+    BoardArray<SK_Card> board;
+    auto board_begin = std::next(deck_.begin(), kPlayers * kHandCards);
+    std::transform(board_begin, std::next(board_begin, kBoardCards),
+                   board.begin(), ConvertISOtoSK);
+    HandArray<SK_Card, kPlayers> hands;
+    for (PlayerId i = 0; i < kPlayers; ++i) {
+      hands[i] = {ConvertISOtoSK(deck_[i * kHandCards]),
+                  ConvertISOtoSK(deck_[i * kHandCards + 1])};
+    }
+    BatchEvaluator::Shared().RankHands(board, hands.data(), kPlayers,
+                                       ranks_.data());
+    ranks_cached_ = true;
+  }
+
   /*
     @brief Writes the hand ranking of each player to a given output array.
 
+    Uses the ranks cached by Deal() if there are any.
+
     @param filter Players marked as true in this array will not be ranked.
     @param output Array to write hand rankings to.
   */
@@ -1108,10 +1362,7 @@ class Node {
                    SevenEval::Rank output[kPlayers]) const {
     for (PlayerId i = 0; i < kPlayers; ++i) {
       if (!filter[i]) {
-        PublicHand<ISO_Card> player_cards = PlayerCards(i);
-        std::transform(player_cards.begin(), player_cards.end(),
-                       player_cards.begin(), ConvertISOtoSK);
-        output[i] = std::apply(SevenEval::GetRank<>, player_cards);
+        output[i] = ranks_cached_ ? ranks_[i] : RankPlayer(i);
       }
     }
   }  // RankPlayers()
@@ -1229,7 +1480,11 @@ class Node {
     @brief Should any rake be taken from the pot?
   */
   bool ShouldRake() {
-    return rake_ && !(no_flop_no_drop_ && round_ == Round::kPreFlop);
+    if constexpr (Rules::kRake) {
+      return rake_ && !(no_flop_no_drop_ && round_ == Round::kPreFlop);
+    } else {
+      return false;
+    }
   }
 
   /*
@@ -0,0 +1,95 @@
+#ifndef AI_SRC_POKER_NODE_RULES_H_
+#define AI_SRC_POKER_NODE_RULES_H_
+
+#include <stdexcept>
+#include <string>
+
+#include "poker/definitions.h"
+
+namespace fishbait {
+
+/* Compile time game rules of a Node. Rules which are disabled are removed from
+   the Node's state and from the branches of its game logic. */
+
+/* Every rule that Node supports: antes, big blind antes, straddles, rake, rake
+   caps, and no flop no drop. */
+struct FullRules {
+  static constexpr bool kAntes = true;
+  static constexpr bool kStraddles = true;
+  static constexpr bool kRake = true;
+};
+
+/* Rules of the abstracted game used while training a blueprint: fixed blinds
+   with no antes, no straddles, and no rake. Together with equal starting
+   stacks, these are the assumptions of Node::AwardPot(SameStackNoRake). */
+struct TrainingRules {
+  static constexpr bool kAntes = false;
+  static constexpr bool kStraddles = false;
+  static constexpr bool kRake = false;
+};
+
+/* Storage for the ante attributes of a Node. Node privately inherits from this
+   so that the attributes take no space when antes are disabled. */
+template <bool kEnabled>
+struct AnteAttributes {
+  Chips ante_;              /* how many chips each player must contribute to the
+                               pot on each hand in expectation */
+  bool big_blind_ante_;     /* does the big blind pays the ante for everyone in
+                               the game? */
+  bool blind_before_ante_;  /* should players should cover the blind instead of
+                               the ante if they don't have enough chips to pay
+                               both? */
+
+  AnteAttributes(Chips ante, bool big_blind_ante, bool blind_before_ante)
+      : ante_{ante}, big_blind_ante_{big_blind_ante},
+        blind_before_ante_{blind_before_ante} {}
+};
+
+template <>
+struct AnteAttributes<false> {
+  static constexpr Chips ante_ = 0;
+  static constexpr bool big_blind_ante_ = false;
+  static constexpr bool blind_before_ante_ = true;
+
+  /* Throws if any ante attribute differs from its disabled value. */
+  AnteAttributes(Chips ante, bool big_blind_ante, bool blind_before_ante) {
+    if (ante != ante_ || big_blind_ante != big_blind_ante_ ||
+        blind_before_ante != blind_before_ante_) {
+      throw std::invalid_argument("Node called with ante attributes, but the "
+                                  "Node's rules disable antes.");
+    }
+  }
+};
+
+/* Storage for the rake attributes of a Node. Node privately inherits from this
+   so that the attributes take no space when rake is disabled. */
+template <typename QuotaT, bool kEnabled>
+struct RakeAttributes {
+  QuotaT rake_;           // proportion of each hand taken as rake
+  Chips rake_cap_;        /* maximum number of chips that can be raked;
+                             rake_cap_ of 0 means no cap */
+  bool no_flop_no_drop_;  // is rake taken on hands without a flop?
+
+  RakeAttributes(QuotaT rake, Chips rake_cap, bool no_flop_no_drop)
+      : rake_{rake}, rake_cap_{rake_cap}, no_flop_no_drop_{no_flop_no_drop} {}
+};
+
+template <typename QuotaT>
+struct RakeAttributes<QuotaT, false> {
+  inline static const QuotaT rake_{0};
+  static constexpr Chips rake_cap_ = 0;
+  static constexpr bool no_flop_no_drop_ = false;
+
+  /* Throws if any rake attribute differs from its disabled value. */
+  RakeAttributes(QuotaT rake, Chips rake_cap, bool no_flop_no_drop) {
+    if (rake != rake_ || rake_cap != rake_cap_ ||
+        no_flop_no_drop != no_flop_no_drop_) {
+      throw std::invalid_argument("Node called with rake attributes, but the "
+                                  "Node's rules disable rake.");
+    }
+  }
+};
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_POKER_NODE_RULES_H_
@@ -16,7 +16,8 @@ int main(int argc, char** argv) {
   }
   using StrategyT = fishbait::Strategy<fishbait::hparam::kPlayers,
                                        fishbait::hparam::kActions,
-                                       fishbait::ClusterTable>;
+                                       fishbait::ClusterTable,
+                                       fishbait::hparam::Rules>;
   using AverageT = typename StrategyT::Average;
   AverageT avg = AverageT::LoadAverage(argv[1], true);
   fishbait::Scribe<fishbait::hparam::kPlayers, fishbait::hparam::kActions,
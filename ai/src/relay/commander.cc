@@ -20,6 +20,10 @@ extern "C" {
 
 constexpr int kActions = hparam::kActions;
 
+/* Milliseconds to search the subgame at each postflop decision. Search is off
+   unless CommanderSetSearchBudget() turns it on. */
+constexpr double kSearchBudget = 0;
+
 template class Commander<hparam::kPlayers, kActions, ClusterTable>;
 using CommanderT = Commander<hparam::kPlayers, kActions, ClusterTable>;
 template struct NodeSnapshot<hparam::kPlayers>;
@@ -49,7 +53,7 @@ typedef void (*CallbackFunc)(const char*, size_t);
 void CommanderCreate(const char* location, CallbackFunc callback) {
   std::filesystem::path avg_loc{location};
   std::unique_ptr<CommanderT> napoleon = std::make_unique<CommanderT>(
-    CommanderT::ScribeT{avg_loc}
+    CommanderT::ScribeT{avg_loc}, kSearchBudget
   );
   std::string saved = CerealSave(&napoleon);
   callback(saved.data(), saved.length());
@@ -96,6 +100,32 @@ void CommanderReset(
   }
 }
 
+/*
+  @brief Sets how long fishbait searches the subgame at postflop decisions.
+
+  @param buffer Binary data start of the Commander to use
+  @param length Binary data length of the Commander to use
+  @param search_budget Milliseconds to search. 0 disables search.
+  @param callback A callback that will receive the binary string representation
+    of the mutated commander.
+*/
+void CommanderSetSearchBudget(
+  const char* buffer, std::size_t length, double search_budget,
+  CallbackFunc callback
+) {
+  try {
+    std::unique_ptr<CommanderT> napoleon;
+    CerealLoad(buffer, length, &napoleon);
+
+    napoleon->SetSearchBudget(search_budget);
+
+    std::string saved = CerealSave(&napoleon);
+    callback(saved.data(), saved.length());
+  } catch (const std::exception& e) {
+    HandleError(e);
+  }
+}
+
 /* @brief Deals the given player the given hand. */
 void CommanderSetHand(
   const char* buffer, std::size_t length,
@@ -9,6 +9,9 @@
 #include <utility>
 #include <tuple>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <unordered_map>
+#include <vector>
 
 #include "array/array.h"
 #include "clustering/cluster_table.h"
@@ -17,11 +20,13 @@
 #include "mccfr/definitions.h"
 #include "mccfr/sequence_table.h"
 #include "mccfr/strategy.h"
+#include "mccfr/subgame_solver.h"
 #include "poker/definitions.h"
 #include "poker/node.h"
 #include "relay/scribe.h"
 #include "utils/math.h"
 #include "utils/random.h"
+#include "utils/timer.h"
 
 namespace fishbait {
 
@@ -31,6 +36,9 @@ class Commander {
   using ScribeT = Scribe<kPlayers, kActions, InfoAbstraction>;
 
  private:
+  // Floor to cutoff negative regrets at when searching subgames
+  static constexpr Regret kSearchRegretFloor = -310000000;
+
   // The state of the abstracted game used to determine the strategy
   Node<kPlayers> abstract_state_;
 
@@ -46,6 +54,9 @@ class Commander {
   // The sequence id of the current state of the abstract game
   SequenceId abstract_seq_;
 
+  // The actions the other players have taken in the abstract game this hand
+  std::vector<BlueprintAction> abstract_history_;
+
   // FISHBAIT's player id
   PlayerId fishbait_seat_;
 
@@ -55,11 +66,17 @@ class Commander {
   // Random number generator for sampling
   Random rng_;
 
+  /* Milliseconds to spend searching the subgame at postflop decisions. 0
+     disables search and plays the blueprint directly. */
+  double search_budget_;
+
  public:
-  explicit Commander(Scribe<kPlayers, kActions, InfoAbstraction>&& strategy)
+  explicit Commander(Scribe<kPlayers, kActions, InfoAbstraction>&& strategy,
+                     double search_budget = 0)
       : abstract_state_{strategy.StartState()}, actual_state_{abstract_state_},
         strategy_{strategy}, info_abstraction_{}, abstract_seq_{0},
-        fishbait_seat_{0}, first_round_action_{true}, rng_{} {}
+        abstract_history_{}, fishbait_seat_{0}, first_round_action_{true},
+        rng_{}, search_budget_{search_budget} {}
 
   /* @brief Resets the game with the given actual state and fishbait seat. */
   void Reset(Node<kPlayers> actual_start, PlayerId fishbait_seat) {
@@ -68,10 +85,20 @@ class Commander {
     abstract_state_.Erase();
     abstract_state_.NewHand(actual_state_.button());
     abstract_seq_ = 0;
+    abstract_history_.clear();
     fishbait_seat_ = fishbait_seat;
     first_round_action_ = true;
   }
 
+  /*
+    @brief Sets the number of milliseconds to search at postflop decisions.
+
+    0 disables search.
+  */
+  void SetSearchBudget(double search_budget) {
+    search_budget_ = search_budget;
+  }
+
   /* @brief Sets the given player's hand. */
   void SetHand(PlayerId player, const Hand<ISO_Card>& hand) {
     actual_state_.SetHand(player, hand);
@@ -106,6 +133,7 @@ class Commander {
     actual_state_.NewHand();
     abstract_state_.NewHand(actual_state_.button());
     abstract_seq_ = 0;
+    abstract_history_.clear();
     first_round_action_ = true;
   }
 
@@ -122,17 +150,20 @@ class Commander {
     }
 
     if (ShouldUpdateAbstract()) {
+      Round abstract_round = abstract_state_.round();
+      SequenceId abstract_seq = abstract_seq_;
+      std::size_t action_idx;
       if (play == Action::kFold) {
         if (abstract_state_.CanFold()) {
-          ApplyAbstract(Action::kFold);
+          action_idx = ApplyAbstract(Action::kFold);
         } else {
-          ApplyAbstract(Action::kCheckCall);
+          action_idx = ApplyAbstract(Action::kCheckCall);
         }
       } else if (play == Action::kCheckCall) {
         if (abstract_state_.CanCheckCall()) {
-          ApplyAbstract(Action::kCheckCall);
+          action_idx = ApplyAbstract(Action::kCheckCall);
         } else {
-          ApplyAbstract(Action::kAllIn);
+          action_idx = ApplyAbstract(Action::kAllIn);
         }
       } else if (play == Action::kAllIn) {
         Chips additional_bet = actual_state_.stack(player);
@@ -149,19 +180,19 @@ class Commander {
           /* if we can check, map the all in to a check. Otherwise, either map
              it to a fold or call with ps-har */
           if (!abstract_state_.CanFold()) {
-            ApplyAbstract(Action::kCheckCall);
+            action_idx = ApplyAbstract(Action::kCheckCall);
           } else if (MapToA(0, call_proportion, bet_prop)) {
-            ApplyAbstract(Action::kFold);
+            action_idx = ApplyAbstract(Action::kFold);
           } else {
             /* if mapped to call and the previous bet in the abstract game was
                not all in, then call */
             if (abstract_state_.CanCheckCall()) {
-              ApplyAbstract(Action::kCheckCall);
+              action_idx = ApplyAbstract(Action::kCheckCall);
 
             /* if mapped to call and the previous bet in the abstract game was
                an all in, then call the all in */
             } else {
-              ApplyAbstract(Action::kAllIn);
+              action_idx = ApplyAbstract(Action::kAllIn);
             }
           }
 
@@ -170,20 +201,22 @@ class Commander {
           /* if there was not a previous all in bet in the abstract game, then
              map to the nearest sized bet with ps-har */
           if (abstract_state_.CanCheckCall()) {
-            ApplyAbstract(Action::kBet, bet_prop);
+            action_idx = ApplyAbstract(Action::kBet, bet_prop);
 
           /* if the previous bet in the abstract game was an all in, then also
              map this bet to all in */
           } else {
-            ApplyAbstract(Action::kAllIn);
+            action_idx = ApplyAbstract(Action::kAllIn);
           }
         }
 
       /* play == Action::kBet */
       } else {
         double bet_prop = actual_state_.ChipsToProportion(size);
-        ApplyAbstract(Action::kBet, bet_prop);
+        action_idx = ApplyAbstract(Action::kBet, bet_prop);
       }
+      abstract_history_.push_back({player, abstract_round, abstract_seq,
+                                   action_idx});
     }  // if ShouldUpdateAbstract()
 
     ApplyActual(play, size);
@@ -251,6 +284,76 @@ class Commander {
     return ret_arr;
   }
 
+  /*
+    @brief Refine Fishbait's policy by searching the subgame rooted at the
+        current state.
+
+    The search is seeded with the blueprint policy, weights the other players'
+    ranges by the actions they have taken this hand, and takes about
+    search_budget_ milliseconds. All illegal actions in the abstract or real
+    game are set to 0, and the normalized result is returned.
+  */
+  std::array<float, kActions> GetSearchPolicy() {
+    Timer search_timer;
+    Round r = actual_state_.round();
+    std::array actions = strategy_.Actions(r);
+    hsize_t n_actions = strategy_.ActionCount(r);
+
+    /* The solver needs the cluster of every hand the players could hold in
+       this round and in each round the other players have acted in, so they
+       are all indexed first and read from the strategy file at once. */
+    PublicHand<ISO_Card> known = actual_state_.PlayerCards(fishbait_seat_);
+    CardN n_known = kHandCards;
+    for (RoundId i = 1; i <= +r; ++i) n_known += kCardsPerRound[i];
+    auto known_end = std::next(known.begin(), n_known);
+    std::vector<ISO_Card> unknown;
+    for (ISO_Card card = 0; card < kDeckSize; ++card) {
+      if (std::find(known.begin(), known_end, card) == known_end) {
+        unknown.push_back(card);
+      }
+    }
+    std::array<bool, kNRounds> cluster_rounds{};
+    cluster_rounds[+r] = true;
+    for (const BlueprintAction& action : abstract_history_) {
+      cluster_rounds[+action.round] = true;
+    }
+    SearchBlueprint blueprint{strategy_, info_abstraction_};
+    for (RoundId round_id = 0; round_id <= +r; ++round_id) {
+      if (!cluster_rounds[round_id]) continue;
+      Round round{round_id};
+      std::vector<hand_index_t> indices{info_abstraction_.Index(round, known)};
+      PublicHand<ISO_Card> cards = known;
+      for (std::size_t i = 0; i < unknown.size(); ++i) {
+        for (std::size_t j = i + 1; j < unknown.size(); ++j) {
+          cards[0] = unknown[i];
+          cards[1] = unknown[j];
+          indices.push_back(info_abstraction_.Index(round, cards));
+        }
+      }
+      blueprint.LoadClusters(round, std::move(indices));
+    }
+
+    SubgameSolver<kPlayers, kActions, SearchBlueprint> solver{
+        actual_state_, fishbait_seat_, blueprint, abstract_seq_,
+        kSearchRegretFloor};
+    solver.WeightRanges(abstract_history_);
+    solver.Seed(actual_state_.pot());
+    std::array policy = solver.Solve(
+        std::max(search_budget_ - search_timer.Check(), 0.0));
+
+    float total = 0;
+    for (std::size_t i = 0; i < policy.size(); ++i) {
+      if (i >= n_actions || !actual_state_.IsLegal(actions[i]) ||
+          strategy_.Next(r, abstract_seq_, i) == kIllegalId) {
+        policy[i] = 0;
+      }
+      total += policy[i];
+    }
+    if (total == 0) return GetNormalizedLegalPolicy();
+    Normalize(policy);
+    return policy;
+  }  // GetSearchPolicy()
+
   /*
     @brief Ask fishbait to make a move.
 
@@ -264,7 +367,9 @@ class Commander {
     // Sample the action
     Round r = actual_state_.round();
     std::array actions = strategy_.Actions(r);
-    std::array policy = GetNormalizedLegalPolicy();
+    std::array policy = search_budget_ > 0 && r != Round::kPreFlop
+                            ? GetSearchPolicy()
+                            : GetNormalizedLegalPolicy();
     std::size_t action_idx = Sample(policy, rng_);
     AbstractAction action = actions[action_idx];
 
@@ -295,8 +400,8 @@ class Commander {
     );
     archive(archive_strategy);
     archive(
-      abstract_state_, actual_state_, abstract_seq_, fishbait_seat_,
-      first_round_action_
+      abstract_state_, actual_state_, abstract_seq_, abstract_history_,
+      fishbait_seat_, first_round_action_, search_budget_
     );
   }
 
@@ -311,12 +416,113 @@ class Commander {
     construct(std::move(*archive_strategy));
     archive(
       construct->abstract_state_, construct->actual_state_,
-      construct->abstract_seq_, construct->fishbait_seat_,
-      construct->first_round_action_
+      construct->abstract_seq_, construct->abstract_history_,
+      construct->fishbait_seat_, construct->first_round_action_,
+      construct->search_budget_
     );
   }
 
  private:
+  /*
+    The blueprint given to the subgame solver. The strategy file is read
+    through caches, since the search looks up the same sequences many times,
+    and the reads are locked, since the file is read by one thread at a time.
+  */
+  class SearchBlueprint {
+   private:
+    using PolicyArray = std::vector<std::array<float, kActions>>;
+
+    ScribeT* strategy_;
+    const Matchmaker* info_abstraction_;
+    std::array<std::array<AbstractAction, kActions>, kNRounds> actions_;
+    std::array<std::size_t, kNRounds> action_counts_;
+
+    mutable std::mutex mutex_;
+    // Card cluster of each hand index in each round
+    mutable std::array<std::unordered_map<hand_index_t, CardCluster>,
+                       kNRounds> clusters_;
+    // Policy of every card cluster at each sequence in each round
+    mutable std::array<std::unordered_map<SequenceId, PolicyArray>,
+                       kNRounds> policies_;
+    // Sequence reached by each action at each sequence in each round
+    mutable std::array<std::unordered_map<SequenceId,
+                                          std::array<SequenceId, kActions>>,
+                       kNRounds> next_;
+
+   public:
+    SearchBlueprint(ScribeT& strategy, const Matchmaker& info_abstraction)
+        : strategy_{&strategy}, info_abstraction_{&info_abstraction} {
+      for (RoundId r = 0; r < kNRounds; ++r) {
+        actions_[r] = strategy.Actions(Round{r});
+        action_counts_[r] = strategy.ActionCount(Round{r});
+      }
+    }
+
+    /*
+      @brief Reads the clusters of the given hand indices in the given round
+          from the strategy file at once.
+    */
+    void LoadClusters(Round round, std::vector<hand_index_t> indices) {
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()),
+                    indices.end());
+      std::vector<CardCluster> clusters = strategy_->GetClusters(round,
+                                                                 indices);
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (std::size_t i = 0; i < indices.size(); ++i) {
+        clusters_[+round][indices[i]] = clusters[i];
+      }
+    }
+
+    std::array<AbstractAction, kActions> Actions(Round round) const {
+      return actions_[+round];
+    }
+
+    std::size_t ActionCount(Round round) const {
+      return action_counts_[+round];
+    }
+
+    CardCluster NumClusters(Round round) const {
+      return InfoAbstraction::NumClusters(round);
+    }
+
+    SequenceId Next(Round round, SequenceId seq,
+                    std::size_t action_idx) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = next_[+round].find(seq);
+      if (it == next_[+round].end()) {
+        std::array<SequenceId, kActions> next;
+        for (std::size_t i = 0; i < action_counts_[+round]; ++i) {
+          next[i] = strategy_->Next(round, seq, i);
+        }
+        it = next_[+round].emplace(seq, next).first;
+      }
+      return it->second[action_idx];
+    }
+
+    std::array<float, kActions> Policy(Round round, CardCluster cluster,
+                                       SequenceId seq) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = policies_[+round].find(seq);
+      if (it == policies_[+round].end()) {
+        it = policies_[+round].emplace(seq, strategy_->Policies(round, seq))
+                 .first;
+      }
+      return it->second[cluster];
+    }
+
+    CardCluster Cluster(Round round, const PublicHand<ISO_Card>& cards) const {
+      hand_index_t idx = info_abstraction_->Index(round, cards);
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = clusters_[+round].find(idx);
+      if (it == clusters_[+round].end()) {
+        it = clusters_[+round].emplace(idx, strategy_->GetCluster(round, idx))
+                 .first;
+      }
+      return it->second;
+    }
+  };  // class SearchBlueprint
+
   /*
     @brief If we should update the abstract state.
 
@@ -335,9 +541,13 @@ class Commander {
     actual_state_.Apply(play, size);
   }
 
-  /* @brief Applies the given Action to the abstract state. */
-  void ApplyAbstract(Action play,
-                     std::optional<double> size = std::optional<double>{}) {
+  /*
+    @brief Applies the given Action to the abstract state.
+
+    @return The index of the abstract action which was applied.
+  */
+  std::size_t ApplyAbstract(
+      Action play, std::optional<double> size = std::optional<double>{}) {
     Round round = abstract_state_.round();
     std::array actions = strategy_.Actions(round);
     hsize_t num_actions = strategy_.ActionCount(round);
@@ -433,6 +643,7 @@ class Commander {
       }
     }
     abstract_seq_ = strategy_.Next(round, abstract_seq_, action_idx);
+    return action_idx;
   }  // ApplyAbstract()
 
   /*
@@ -2,11 +2,14 @@
 #define AI_SRC_RELAY_SCRIBE_H_
 
 #include <array>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include "array/array.h"
 #include "H5Cpp.h"
@@ -83,10 +86,15 @@ class Scribe {
 
   /*
     @brief Saves the given Node as a json dump to the root of the hdf file.
+
+    The node is saved with FullRules whatever rules it was trained with, so
+    that StartState() can load it.
   */
-  void SaveStartState(const Node<kPlayers>& start_state) {
+  template <typename Rules>
+  void SaveStartState(const Node<kPlayers, double, Rules>& start_state) {
+    Node<kPlayers> full_start_state{start_state};
     std::stringstream ss_ss;
-    CerealSaveJSON(ss_ss, &start_state);
+    CerealSaveJSON(ss_ss, &full_start_state);
     std::string ss_string = ss_ss.str();
 
     H5::DataSpace fspace{H5S_SCALAR};
@@ -145,7 +153,8 @@ class Scribe {
     Saved in a group called "actions". Each round has it's own dataset and a
     dataset called "index" stores references to each round's actions.
   */
-  void SaveActions(const SequenceTable<kPlayers, kActions>& seq) {
+  template <typename Rules>
+  void SaveActions(const SequenceTable<kPlayers, kActions, Rules>& seq) {
     H5::Group group = CreateIndexedDSetGroup("actions");
 
     for (RoundId rid = 0; rid < kNRounds; ++rid) {
@@ -168,7 +177,8 @@ class Scribe {
     Saved in a group called "sequences". Each round has it's own dataset and a
     dataset called "index" stores references to each round's sequences.
   */
-  void SaveSequences(const SequenceTable<kPlayers, kActions>& seq) {
+  template <typename Rules>
+  void SaveSequences(const SequenceTable<kPlayers, kActions, Rules>& seq) {
     H5::Group group = CreateIndexedDSetGroup("sequences");
 
     for (RoundId rid = 0; rid < kNRounds; ++rid) {
@@ -200,13 +210,22 @@ class Scribe {
     H5::Group group = CreateIndexedDSetGroup("clusters");
 
     for (RoundId rid = 0; rid < kNRounds; ++rid) {
+      // The clusters are saved with the same width they are stored with
+      using Entry = typename std::decay_t<decltype(ia.table()[rid])>::
+                    value_type;
+      static_assert(std::is_same_v<Entry, uint8_t> ||
+                    std::is_same_v<Entry, uint16_t> ||
+                    std::is_same_v<Entry, uint32_t>);
+      const H5::PredType& type = std::is_same_v<Entry, uint8_t> ?
+          H5::PredType::NATIVE_UINT8 : std::is_same_v<Entry, uint16_t> ?
+          H5::PredType::NATIVE_UINT16 : H5::PredType::NATIVE_UINT32;
       std::array<hsize_t, 1> round_fspace_dims = {ia.table()[rid].size()};
       H5::DataSpace round_fspace{1, round_fspace_dims.data()};
       H5::DataSet round_dataset = group.createDataSet(kRoundNames[rid].data(),
-        H5::PredType::NATIVE_UINT32, round_fspace);
+        type, round_fspace);
       round_fspace.selectAll();
-      round_dataset.write(ia.table()[rid].data(), H5::PredType::NATIVE_UINT32,
-                          round_fspace, round_fspace);
+      round_dataset.write(ia.table()[rid].data(), type, round_fspace,
+                          round_fspace);
 
       WriteRefToIndexDSet(group, round_dataset, rid);
     }
@@ -220,17 +239,17 @@ class Scribe {
     are included in each round, not just the legal ones, so each round's dataset
     is of size (clusters x sequences x actions).
 
-    @param avg The average policy to save.
+    @param avg The average policy to save. A Strategy::Average with any rules.
     @param verbose Whether to print progress information.
   */
-  void SavePolicy(const typename Strategy<kPlayers, kActions, InfoAbstraction>::Average& avg,  // NOLINT
-                  bool verbose = false) {
+  template <typename AverageT>
+  void SavePolicy(const AverageT& avg, bool verbose = false) {
     H5::Group group = CreateIndexedDSetGroup("policy");
 
     for (RoundId rid = 0; rid < kNRounds; ++rid) {
       Round round{rid};
 
-      const SequenceTable<kPlayers, kActions>& seq = avg.action_abstraction();
+      const auto& seq = avg.action_abstraction();
       const InfoAbstraction& ia = avg.info_abstraction();
       std::array<hsize_t, 3> round_fspace_dims = {ia.NumClusters(round),
                                                   seq.States(round),
@@ -307,12 +326,13 @@ class Scribe {
   /*
     @brief Saves the given average as an hdf file and then uses that file.
 
-    @param avg The average strategy to use.
+    @param avg The average strategy to use. A Strategy::Average with any
+        rules.
     @param loc The location to save the hdf file.
     @param verbose Whether to print log information.
   */
-  Scribe(const typename Strategy<kPlayers, kActions, InfoAbstraction>::Average& avg,  // NOLINT
-         std::filesystem::path loc, bool verbose = false)
+  template <typename AverageT>
+  Scribe(const AverageT& avg, std::filesystem::path loc, bool verbose = false)
          : average_{loc.c_str(), H5F_ACC_EXCL} {
     SaveStartState(avg.action_abstraction().start_state());
     SaveActions(avg.action_abstraction());
@@ -351,7 +371,8 @@ class Scribe {
   /*
     @brief Returns the cluster of the given hand index in the given round.
 
-    Meant for use by Matchmaker.
+    Meant for use by Matchmaker. The clusters are converted from the width
+    they were saved with.
   */
   CardCluster GetCluster(Round round, hand_index_t idx) {
     H5::Group clusters = average_.openGroup("clusters");
@@ -366,6 +387,32 @@ class Scribe {
     return buffer;
   }  // GetCluster()
 
+  /*
+    @brief Returns the clusters of the given hand indices in the given round.
+
+    All of the clusters are read from the file at once, which is much faster
+    than calling GetCluster() for each of them.
+
+    @param round The round of the hand indices.
+    @param idxs The hand indices to read the clusters of.
+  */
+  std::vector<CardCluster> GetClusters(Round round,
+                                       const std::vector<hand_index_t>& idxs) {
+    std::vector<CardCluster> buffer(idxs.size());
+    if (idxs.empty()) return buffer;
+    H5::Group clusters = average_.openGroup("clusters");
+    H5::DataSet round_clusters = clusters.openDataSet(
+        kRoundNames[+round].data());
+    H5::DataSpace fspace = round_clusters.getSpace();
+    std::vector<hsize_t> selection(idxs.begin(), idxs.end());
+    fspace.selectElements(H5S_SELECT_SET, selection.size(), selection.data());
+    std::array<hsize_t, 1> mspace_dim = {idxs.size()};
+    H5::DataSpace mspace{1, mspace_dim.data()};
+    round_clusters.read(buffer.data(), H5::PredType::NATIVE_UINT32, mspace,
+                        fspace);
+    return buffer;
+  }  // GetClusters()
+
   /*
     @brief Returns an array of the strategy at the given game state.
 
@@ -392,6 +439,43 @@ class Scribe {
     return policy_arr;
   }  // Policy()
 
+  /*
+    @brief Returns the strategy of every card cluster at the given sequence.
+
+    All of the clusters are read from the file at once, which is much faster
+    than calling Policy() for each of them. Values after this round's
+    ActionCount() are undefined.
+
+    @param round The round of the sequence.
+    @param seq The sequence to read the strategies of.
+
+    @return A vector with the strategy of each card cluster.
+  */
+  std::vector<std::array<float, kActions>> Policies(Round round,
+                                                    SequenceId seq) {
+    H5::Group policy = average_.openGroup("policy");
+    H5::DataSet round_policy = policy.openDataSet(kRoundNames[+round].data());
+    H5::DataSpace fspace = round_policy.getSpace();
+    std::array<hsize_t, 3> dataset_dims;
+    fspace.getSimpleExtentDims(dataset_dims.data());
+    std::array<hsize_t, 3> selection_size = {dataset_dims[0], 1,
+                                             dataset_dims[2]};
+    std::array<hsize_t, 3> selection_start = {0, seq, 0};
+    fspace.selectHyperslab(H5S_SELECT_SET, selection_size.data(),
+                           selection_start.data());
+    std::array<hsize_t, 2> mspace_dims = {dataset_dims[0], kActions};
+    H5::DataSpace mspace{2, mspace_dims.data()};
+    std::array<hsize_t, 2> mselection_size = {dataset_dims[0],
+                                              dataset_dims[2]};
+    std::array<hsize_t, 2> mselection_start = {0, 0};
+    mspace.selectHyperslab(H5S_SELECT_SET, mselection_size.data(),
+                           mselection_start.data());
+    std::vector<std::array<float, kActions>> policies(dataset_dims[0]);
+    round_policy.read(policies.data(), H5::PredType::NATIVE_FLOAT, mspace,
+                      fspace);
+    return policies;
+  }  // Policies()
+
   /*
     @brief Returns the available actions at the given round.
 
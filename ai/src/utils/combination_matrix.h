@@ -18,6 +18,17 @@ class CombinationMatrix {
   CombinationMatrix<T>& operator=(const CombinationMatrix<T>& other) = default;
 
   T& operator()(uint32_t i, uint32_t j) {
+    return this->data_[Index(i, j)];
+  }
+
+  const T& operator()(uint32_t i, uint32_t j) const {
+    return this->data_[Index(i, j)];
+  }
+
+  uint32_t n() { return n_; }
+
+ private:
+  uint32_t Index(uint32_t i, uint32_t j) const {
     assert(i != j);
     assert(i < n_);
     assert(j < n_);
@@ -26,13 +37,9 @@ class CombinationMatrix {
       i = j;
       j = temp;
     }
-    uint32_t idx = i*this->n_ - i*(i+1)/2 + j - i - 1;
-    return this->data_[idx];
+    return i*this->n_ - i*(i+1)/2 + j - i - 1;
   }
 
-  uint32_t n() { return n_; }
-
- private:
   const uint32_t n_;  // side length
   std::vector<T> data_;
 };  // CombinationMatrix
@@ -0,0 +1,456 @@
+#ifndef AI_SRC_UTILS_LUT_FILE_H_
+#define AI_SRC_UTILS_LUT_FILE_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "array/array.h"
+#include "array/matrix.h"
+#include "utils/cereal.h"
+
+namespace fishbait {
+
+/* A LUT file stores a row major table of trivially copyable elements as raw
+   bytes, split into fixed size chunks which each have a checksum. The layout
+   of a file is:
+
+     LUTFileHeader
+     one uint64_t checksum per chunk
+     zero padding up to a multiple of kLUTDataAlignment
+     the elements
+
+   Because the elements are stored raw, a file can be memory mapped and used in
+   place, and any range of elements can be read without reading the rest of
+   the file. Files are written in the native byte order. */
+
+constexpr uint64_t kLUTMagic = 0x54554C5442534946;  // "FISBTLUT"
+constexpr uint32_t kLUTVersion = 1;
+constexpr uint64_t kLUTDataAlignment = 4096;
+constexpr uint64_t kLUTChunkBytes = 1 << 24;
+
+struct LUTFileHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t dtype;           // LUTDtype() of the elements
+  uint64_t element_size;    // bytes per element
+  uint64_t rows;
+  uint64_t columns;
+  uint64_t chunk_elements;  // elements per chunk, the last chunk may be short
+  uint64_t n_chunks;
+  uint64_t data_offset;     // byte offset of the first element
+  uint64_t checksum;        // checksum of the header with this field as 0
+};
+static_assert(sizeof(LUTFileHeader) == 72);
+
+/*
+  @brief Returns a code for the kind of element T is. Together with the element
+      size, this is checked when a LUT file is opened.
+*/
+template <typename T>
+constexpr uint32_t LUTDtype() {
+  static_assert(std::is_trivially_copyable_v<T>);
+  if constexpr (std::is_floating_point_v<T>) {
+    return 1;
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    return 2;
+  } else if constexpr (std::is_integral_v<T>) {
+    return 3;
+  } else {
+    return 4;
+  }
+}
+
+/* @brief 64 bit FNV-1a of the given bytes, taken 8 bytes at a time. */
+inline uint64_t LUTChecksum(const void* data, uint64_t bytes) {
+  constexpr uint64_t kPrime = 0x100000001b3;
+  const unsigned char* bytes_ptr = static_cast<const unsigned char*>(data);
+  uint64_t hash = 0xcbf29ce484222325;
+  uint64_t i = 0;
+  for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes_ptr + i, sizeof(uint64_t));
+    hash = (hash ^ word) * kPrime;
+  }
+  for (; i < bytes; ++i) hash = (hash ^ bytes_ptr[i]) * kPrime;
+  return hash;
+}
+
+/* @brief Returns the checksum of a header, ignoring its checksum field. */
+inline uint64_t LUTHeaderChecksum(LUTFileHeader header) {
+  header.checksum = 0;
+  return LUTChecksum(&header, sizeof(header));
+}
+
+/*
+  @brief Throws if the header is corrupt, does not describe a LUT of T, or
+      describes more data than the file holds.
+
+  @param header The header to check.
+  @param file_size The size of the file the header was read from in bytes.
+  @param path The path of the file, for error messages.
+*/
+template <typename T>
+void CheckLUTHeader(const LUTFileHeader& header, uint64_t file_size,
+                    std::string_view path) {
+  std::string func{__func__};
+  std::string file{path};
+  if (header.magic != kLUTMagic || header.version != kLUTVersion ||
+      header.checksum != LUTHeaderChecksum(header)) {
+    throw std::runtime_error(func + " " + file + " is not a valid version " +
+                             std::to_string(kLUTVersion) + " LUT file.");
+  }
+  if (header.dtype != LUTDtype<T>() || header.element_size != sizeof(T)) {
+    throw std::invalid_argument(func + " " + file + " does not hold elements "
+                                "of the requested type.");
+  }
+  uint64_t n = header.rows * header.columns;
+  uint64_t expected_chunks = n == 0 ? 0 : (n - 1) / header.chunk_elements + 1;
+  if (header.chunk_elements == 0 || header.n_chunks != expected_chunks ||
+      header.data_offset < sizeof(LUTFileHeader) +
+                           header.n_chunks * sizeof(uint64_t) ||
+      file_size < header.data_offset + n * sizeof(T)) {
+    throw std::runtime_error(func + " " + file + " is truncated or has an "
+                             "inconsistent header.");
+  }
+}  // CheckLUTHeader()
+
+/*
+  @brief Saves a row major table to a LUT file.
+
+  @param path The path of the file to write. An existing file is replaced
+      atomically.
+  @param data Pointer to the first element of the table.
+  @param rows The number of rows in the table.
+  @param columns The number of columns in the table.
+  @param verbose Option to print progress.
+*/
+template <typename T>
+void SaveLUT(std::string_view path, const T* data, uint64_t rows,
+             uint64_t columns, bool verbose = false) {
+  if (verbose) {
+    std::cout << "Saving to " << path << std::endl;
+  }
+
+  const uint64_t n = rows * columns;
+  LUTFileHeader header{};
+  header.magic = kLUTMagic;
+  header.version = kLUTVersion;
+  header.dtype = LUTDtype<T>();
+  header.element_size = sizeof(T);
+  header.rows = rows;
+  header.columns = columns;
+  header.chunk_elements = std::max(kLUTChunkBytes / sizeof(T), uint64_t{1});
+  header.n_chunks = n == 0 ? 0 : (n - 1) / header.chunk_elements + 1;
+  uint64_t table_end = sizeof(header) + header.n_chunks * sizeof(uint64_t);
+  header.data_offset = (table_end + kLUTDataAlignment - 1) /
+                       kLUTDataAlignment * kLUTDataAlignment;
+  header.checksum = LUTHeaderChecksum(header);
+
+  std::vector<uint64_t> checksums(header.n_chunks);
+  for (uint64_t c = 0; c < header.n_chunks; ++c) {
+    uint64_t begin = c * header.chunk_elements;
+    uint64_t end = std::min(begin + header.chunk_elements, n);
+    checksums[c] = LUTChecksum(data + begin, (end - begin) * sizeof(T));
+  }
+  std::vector<char> padding(header.data_offset - table_end, 0);
+
+  /* The table is written to a temporary file in the same directory which is
+     then renamed over the target, so processes which have the old file mapped
+     keep reading it rather than a file that is being rewritten under them. */
+  const std::string target{path};
+  const std::string temp = target + ".tmp" + std::to_string(getpid());
+  std::ofstream os(temp, std::ios::binary);
+  os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  os.write(reinterpret_cast<const char*>(checksums.data()),
+           checksums.size() * sizeof(uint64_t));
+  os.write(padding.data(), padding.size());
+  os.write(reinterpret_cast<const char*>(data), n * sizeof(T));
+  os.close();
+  if (!os || std::rename(temp.c_str(), target.c_str()) != 0) {
+    std::remove(temp.c_str());
+    std::string func{__func__};
+    throw std::runtime_error(func + " could not write " + target);
+  }
+
+  if (verbose) {
+    std::cout << "Saved to " << path << std::endl;
+  }
+}  // SaveLUT()
+
+/*
+  @brief Reads a range of elements from a LUT file, checking the checksum of
+      every chunk the range touches. Only those chunks are read.
+
+  @param path The path of the file to read.
+  @param begin The flat index of the first element to read.
+  @param n The number of elements to read.
+  @param out Pointer to where to write the elements.
+
+  @return The header of the file.
+*/
+template <typename T>
+LUTFileHeader ReadLUT(std::string_view path, uint64_t begin, uint64_t n,
+                      T* out) {
+  std::string func{__func__};
+  std::ifstream ins(path.data(), std::ios::binary | std::ios::ate);
+  if (!ins) {
+    throw std::runtime_error(func + " could not open " + std::string{path});
+  }
+  uint64_t file_size = ins.tellg();
+  LUTFileHeader header{};
+  ins.seekg(0);
+  ins.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!ins) header.magic = 0;
+  CheckLUTHeader<T>(header, file_size, path);
+
+  const uint64_t size = header.rows * header.columns;
+  if (begin > size || n > size - begin) {
+    throw std::out_of_range(func + " range is outside of " +
+                            std::string{path});
+  }
+  if (n == 0) return header;
+
+  const uint64_t first_chunk = begin / header.chunk_elements;
+  const uint64_t last_chunk = (begin + n - 1) / header.chunk_elements;
+  std::vector<uint64_t> checksums(last_chunk - first_chunk + 1);
+  ins.seekg(sizeof(header) + first_chunk * sizeof(uint64_t));
+  ins.read(reinterpret_cast<char*>(checksums.data()),
+           checksums.size() * sizeof(uint64_t));
+
+  std::vector<T> chunk(std::min(header.chunk_elements, size));
+  for (uint64_t c = first_chunk; c <= last_chunk; ++c) {
+    uint64_t chunk_begin = c * header.chunk_elements;
+    uint64_t chunk_n = std::min(header.chunk_elements, size - chunk_begin);
+    ins.seekg(header.data_offset + chunk_begin * sizeof(T));
+    ins.read(reinterpret_cast<char*>(chunk.data()), chunk_n * sizeof(T));
+    if (!ins || LUTChecksum(chunk.data(), chunk_n * sizeof(T)) !=
+                checksums[c - first_chunk]) {
+      throw std::runtime_error(func + " chunk " + std::to_string(c) + " of " +
+                               std::string{path} + " is corrupt.");
+    }
+    uint64_t copy_begin = std::max(begin, chunk_begin);
+    uint64_t copy_end = std::min(begin + n, chunk_begin + chunk_n);
+    std::copy(chunk.begin() + (copy_begin - chunk_begin),
+              chunk.begin() + (copy_end - chunk_begin),
+              out + (copy_begin - begin));
+  }
+  return header;
+}  // ReadLUT()
+
+/* A read only memory mapping of a LUT file. Opening only reads the header;
+   the elements are paged in from the file as they are accessed, so a LUT can
+   be streamed through without being loaded into memory. */
+template <typename T>
+class MappedLUT {
+ private:
+  void* map_;
+  uint64_t map_size_;
+  LUTFileHeader header_;
+  const uint64_t* checksums_;
+  const T* data_;
+
+ public:
+  /*
+    @brief Maps the given LUT file.
+
+    @param path The path of the file to map.
+    @param verify Option to check the checksum of every chunk now, which reads
+        the whole file.
+    @param verbose Option to print progress.
+  */
+  explicit MappedLUT(std::string_view path, bool verify = false,
+                     bool verbose = false)
+      : map_{nullptr}, map_size_{0}, header_{}, checksums_{nullptr},
+        data_{nullptr} {
+    if (verbose) {
+      std::cout << "Mapping " << path << std::endl;
+    }
+
+    std::string func{__func__};
+    int fd = open(path.data(), O_RDONLY);
+    struct stat file_stat;
+    if (fd == -1 || fstat(fd, &file_stat) == -1) {
+      if (fd != -1) close(fd);
+      throw std::runtime_error(func + " could not open " + std::string{path});
+    }
+    map_size_ = file_stat.st_size;
+    if (map_size_ >= sizeof(LUTFileHeader)) {
+      map_ = mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map_ == nullptr || map_ == MAP_FAILED) {
+      map_ = nullptr;
+      throw std::runtime_error(func + " could not map " + std::string{path});
+    }
+
+    std::memcpy(&header_, map_, sizeof(header_));
+    try {
+      CheckLUTHeader<T>(header_, map_size_, path);
+    } catch (...) {
+      munmap(map_, map_size_);
+      throw;
+    }
+    const char* bytes = static_cast<const char*>(map_);
+    checksums_ = reinterpret_cast<const uint64_t*>(bytes + sizeof(header_));
+    data_ = reinterpret_cast<const T*>(bytes + header_.data_offset);
+
+    if (verify) Verify();
+    if (verbose) {
+      std::cout << "Mapped " << path << std::endl;
+    }
+  }
+  ~MappedLUT() {
+    if (map_ != nullptr) munmap(map_, map_size_);
+  }
+
+  MappedLUT(const MappedLUT&) = delete;
+  MappedLUT& operator=(const MappedLUT&) = delete;
+  MappedLUT(MappedLUT&& other) noexcept
+      : map_{std::exchange(other.map_, nullptr)}, map_size_{other.map_size_},
+        header_{other.header_}, checksums_{other.checksums_},
+        data_{other.data_} {}
+  MappedLUT& operator=(MappedLUT&& other) noexcept {
+    std::swap(map_, other.map_);
+    std::swap(map_size_, other.map_size_);
+    std::swap(header_, other.header_);
+    std::swap(checksums_, other.checksums_);
+    std::swap(data_, other.data_);
+    return *this;
+  }
+
+  /*
+    @brief Throws if any chunk which holds an element in [begin, end) does not
+        match its checksum.
+  */
+  void Verify(uint64_t begin, uint64_t end) const {
+    if (begin >= end) return;
+    const uint64_t first_chunk = begin / header_.chunk_elements;
+    const uint64_t last_chunk = (end - 1) / header_.chunk_elements;
+    for (uint64_t c = first_chunk; c <= last_chunk; ++c) {
+      uint64_t chunk_begin = c * header_.chunk_elements;
+      uint64_t chunk_n = std::min(header_.chunk_elements, size() - chunk_begin);
+      if (LUTChecksum(data_ + chunk_begin, chunk_n * sizeof(T)) !=
+          checksums_[c]) {
+        std::string func{__func__};
+        throw std::runtime_error(func + " chunk " + std::to_string(c) +
+                                 " is corrupt.");
+      }
+    }
+  }
+  void Verify() const { Verify(0, size()); }
+
+  const T& operator[](uint64_t i) const { return data_[i]; }
+  const T& operator()(uint64_t row, uint64_t column) const {
+    return data_[row * header_.columns + column];
+  }
+  const T* data() const { return data_; }
+  uint64_t size() const { return header_.rows * header_.columns; }
+  uint64_t rows() const { return header_.rows; }
+  uint64_t columns() const { return header_.columns; }
+
+  /* @brief Returns a view of the elements as a rows x columns matrix, so that
+         code which reads matrices can read the LUT without loading it. */
+  nda::const_matrix_ref<T> matrix() const {
+    return nda::const_matrix_ref<T>(
+        data_, nda::matrix_shape<>(header_.rows, header_.columns));
+  }
+
+  /* @brief Hints that the LUT will be read in order, so that the kernel reads
+         ahead further and frees the pages which were read first when memory
+         runs short. Useful when a LUT larger than memory is scanned. */
+  void AdviseSequential() const {
+    madvise(map_, map_size_, MADV_SEQUENTIAL);
+  }
+};  // class MappedLUT
+
+/* A non owning view of a flat LUT held either in memory or in a MappedLUT. */
+template <typename T>
+class LUTView {
+ private:
+  const T* data_;
+  uint64_t size_;
+
+ public:
+  using value_type = T;
+
+  LUTView() : data_{nullptr}, size_{0} {}
+  LUTView(const T* data, uint64_t size) : data_{data}, size_{size} {}
+  LUTView(const std::vector<T>& lut)  // NOLINT(runtime/explicit)
+      : data_{lut.data()}, size_{lut.size()} {}
+  LUTView(const MappedLUT<T>& lut)  // NOLINT(runtime/explicit)
+      : data_{lut.data()}, size_{lut.size()} {}
+
+  const T& operator[](uint64_t i) const { return data_[i]; }
+  const T* data() const { return data_; }
+  uint64_t size() const { return size_; }
+};  // class LUTView
+
+/*
+  @brief Saves a vector to, or loads it from, a LUT file.
+*/
+template <typename T>
+void LUTFile(FileAction action, std::string_view path, std::vector<T>* data,
+             bool verbose = false) {
+  switch (action) {
+    case FileAction::Load: {
+      if (verbose) {
+        std::cout << "Loading " << path << std::endl;
+      }
+      LUTFileHeader header = ReadLUT<T>(path, 0, 0, nullptr);
+      data->resize(header.rows * header.columns);
+      ReadLUT(path, 0, data->size(), data->data());
+      if (verbose) {
+        std::cout << "Loaded " << path << std::endl;
+      }
+      break;
+    }
+    case FileAction::Save:
+      SaveLUT(path, data->data(), data->size(), 1, verbose);
+      break;
+  }
+}  // LUTFile()
+
+/*
+  @brief Saves a matrix to, or loads it from, a LUT file.
+*/
+template <typename T>
+void LUTFile(FileAction action, std::string_view path, nda::matrix<T>* data,
+             bool verbose = false) {
+  switch (action) {
+    case FileAction::Load: {
+      if (verbose) {
+        std::cout << "Loading " << path << std::endl;
+      }
+      LUTFileHeader header = ReadLUT<T>(path, 0, 0, nullptr);
+      nda::matrix<T> loaded(nda::matrix_shape<>(header.rows, header.columns));
+      ReadLUT(path, 0, header.rows * header.columns, loaded.data());
+      *data = std::move(loaded);
+      if (verbose) {
+        std::cout << "Loaded " << path << std::endl;
+      }
+      break;
+    }
+    case FileAction::Save:
+      SaveLUT(path, data->data(), data->rows(), data->columns(), verbose);
+      break;
+  }
+}  // LUTFile()
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_UTILS_LUT_FILE_H_
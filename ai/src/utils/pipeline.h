@@ -0,0 +1,340 @@
+#ifndef AI_SRC_UTILS_PIPELINE_H_
+#define AI_SRC_UTILS_PIPELINE_H_
+
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>  // NOLINT(build/c++11)
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "utils/lut_file.h"
+
+namespace fishbait {
+
+/*
+  @brief Returns a hash of the contents of a file. A LUT file already stores a
+      checksum of every chunk of its data, so only its header and checksum
+      table are read. Any other file is read in full.
+
+  @param path The path of the file to hash.
+*/
+inline uint64_t FileHash(std::string_view path) {
+  std::ifstream ins(path.data(), std::ios::binary | std::ios::ate);
+  if (!ins) {
+    std::string func{__func__};
+    throw std::runtime_error(func + " could not open " + std::string{path});
+  }
+  const uint64_t file_size = ins.tellg();
+  ins.seekg(0);
+
+  LUTFileHeader header{};
+  if (file_size >= sizeof(header)) {
+    ins.read(reinterpret_cast<char*>(&header), sizeof(header));
+  }
+  std::vector<uint64_t> hashes;
+  if (file_size >= sizeof(header) && header.magic == kLUTMagic &&
+      header.version == kLUTVersion &&
+      header.checksum == LUTHeaderChecksum(header) &&
+      file_size >= header.data_offset +
+                   header.rows * header.columns * header.element_size) {
+    hashes.resize(header.n_chunks + 1);
+    hashes[0] = header.checksum;
+    ins.read(reinterpret_cast<char*>(hashes.data() + 1),
+             header.n_chunks * sizeof(uint64_t));
+  } else {
+    ins.seekg(0);
+    hashes.push_back(file_size);
+    std::vector<char> chunk(kLUTChunkBytes);
+    do {
+      ins.read(chunk.data(), chunk.size());
+      if (ins.gcount() > 0) {
+        hashes.push_back(LUTChecksum(chunk.data(), ins.gcount()));
+      }
+    } while (ins);
+  }
+  return LUTChecksum(hashes.data(), hashes.size() * sizeof(uint64_t));
+}  // FileHash()
+
+/* A DAG of stages which each write a set of output files. Running the pipeline
+   runs every stage after its dependencies, running independent stages
+   concurrently. A manifest records a key for each stage, which is a hash of
+   its parameters and of the contents of its dependencies' outputs, together
+   with a hash of each of its outputs. A stage is skipped when its key and the
+   hashes of its outputs on disk match the manifest, so a stage only reruns
+   when its parameters, its inputs, or its outputs have changed. */
+class Pipeline {
+ public:
+  using Hash = uint64_t;
+
+ private:
+  struct Stage {
+    std::string name;
+    std::vector<std::size_t> dependencies;
+    std::vector<std::string> outputs;
+    std::string parameters;
+    std::function<void()> run;
+  };
+
+  struct Record {
+    Hash key;
+    std::vector<Hash> output_hashes;
+  };
+
+  using Manifest = std::map<std::string, Record>;
+
+  std::vector<Stage> stages_;
+
+ public:
+  /*
+    @brief Adds a stage to the pipeline.
+
+    @param name Unique name of the stage, without whitespace.
+    @param dependencies Names of stages which must run before this one. They
+        must already have been added, so the pipeline cannot have cycles.
+    @param outputs Paths of the files the stage writes.
+    @param parameters Description of everything besides its dependencies'
+        outputs that changes what the stage writes, such as a version and its
+        settings. The stage reruns when this changes.
+    @param run Function which runs the stage.
+  */
+  void AddStage(std::string name, const std::vector<std::string>& dependencies,
+                std::vector<std::string> outputs, std::string parameters,
+                std::function<void()> run) {
+    std::string func{__func__};
+    if (name.empty() || name.find_first_of(" \t\n") != std::string::npos) {
+      throw std::invalid_argument(func + " stage name \"" + name + "\" is "
+                                  "empty or has whitespace.");
+    }
+    if (Find(name) != stages_.size()) {
+      throw std::invalid_argument(func + " stage " + name + " already "
+                                  "exists.");
+    }
+    std::vector<std::size_t> dependency_ids;
+    for (const std::string& dependency : dependencies) {
+      std::size_t id = Find(dependency);
+      if (id == stages_.size()) {
+        throw std::invalid_argument(func + " stage " + name + " depends on "
+                                    "unknown stage " + dependency + ".");
+      }
+      dependency_ids.push_back(id);
+    }
+    stages_.push_back({std::move(name), std::move(dependency_ids),
+                       std::move(outputs), std::move(parameters),
+                       std::move(run)});
+  }  // AddStage()
+
+  /*
+    @brief Runs every stage which is not up to date, updating the manifest
+        after each stage finishes. If a stage throws, no new stages are
+        started, the running stages are finished, and the exception is
+        rethrown.
+
+    @param manifest_path The path of the manifest file.
+    @param max_jobs The maximum number of stages to run at once. 0 means no
+        limit.
+    @param verbose Option to print which stages run and which are skipped.
+
+    @return The names of the stages which ran, in the order they finished.
+  */
+  std::vector<std::string> Run(std::string_view manifest_path,
+                               uint32_t max_jobs = 0,
+                               bool verbose = false) const {
+    enum class State { kWaiting, kRunning, kDone };
+    const std::string manifest_file{manifest_path};
+    Manifest manifest = LoadManifest(manifest_file);
+    std::vector<State> states(stages_.size(), State::kWaiting);
+    std::vector<std::vector<Hash>> output_hashes(stages_.size());
+    std::vector<std::string> ran;
+    std::exception_ptr error;
+    std::size_t running = 0;
+    std::size_t done = 0;
+
+    std::mutex mutex;
+    std::condition_variable stage_done;
+    std::vector<std::thread> threads;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (done < stages_.size()) {
+      for (std::size_t i = 0; i < stages_.size() && !error; ++i) {
+        if (max_jobs != 0 && running >= max_jobs) break;
+        if (states[i] != State::kWaiting || !Ready(i, states)) continue;
+
+        const Stage& stage = stages_[i];
+        const Hash key = Key(i, output_hashes);
+        Manifest::const_iterator record = manifest.find(stage.name);
+        const bool has_record = record != manifest.end() &&
+                                record->second.key == key;
+        std::vector<Hash> recorded;
+        if (has_record) recorded = record->second.output_hashes;
+        states[i] = State::kRunning;
+        ++running;
+        threads.emplace_back([&, i, key, has_record, recorded] {
+          std::vector<Hash> hashes;
+          bool skipped = false;
+          std::exception_ptr stage_error;
+          try {
+            skipped = has_record && UpToDate(stages_[i], recorded);
+            if (skipped) {
+              hashes = recorded;
+              if (verbose) {
+                std::cout << "Skipping " + stages_[i].name + ", which is up "
+                             "to date\n" << std::flush;
+              }
+            } else {
+              if (verbose) {
+                std::cout << "Running " + stages_[i].name + "\n" << std::flush;
+              }
+              for (const std::string& output : stages_[i].outputs) {
+                std::filesystem::path parent =
+                    std::filesystem::path(output).parent_path();
+                if (!parent.empty()) {
+                  std::filesystem::create_directories(parent);
+                }
+              }
+              stages_[i].run();
+              for (const std::string& output : stages_[i].outputs) {
+                hashes.push_back(FileHash(output));
+              }
+              if (verbose) {
+                std::cout << "Finished " + stages_[i].name + "\n"
+                          << std::flush;
+              }
+            }
+          } catch (...) {
+            stage_error = std::current_exception();
+          }
+
+          std::lock_guard<std::mutex> stage_lock(mutex);
+          if (stage_error) {
+            if (!error) error = stage_error;
+          } else {
+            output_hashes[i] = hashes;
+            if (!skipped) {
+              manifest[stages_[i].name] = {key, hashes};
+              ran.push_back(stages_[i].name);
+              try {
+                SaveManifest(manifest_file, manifest);
+              } catch (...) {
+                if (!error) error = std::current_exception();
+              }
+            }
+          }
+          states[i] = State::kDone;
+          --running;
+          ++done;
+          stage_done.notify_one();
+        });
+      }
+      if (running == 0) break;
+      stage_done.wait(lock);
+    }
+    lock.unlock();
+
+    for (std::thread& thread : threads) thread.join();
+    if (error) std::rethrow_exception(error);
+    return ran;
+  }  // Run()
+
+ private:
+  /* @brief Returns the index of the stage with the given name, or the number
+         of stages if there is none. */
+  std::size_t Find(std::string_view name) const {
+    for (std::size_t i = 0; i < stages_.size(); ++i) {
+      if (stages_[i].name == name) return i;
+    }
+    return stages_.size();
+  }
+
+  /* @brief Returns true if every dependency of the given stage is done. */
+  template <typename StateT>
+  bool Ready(std::size_t stage, const std::vector<StateT>& states) const {
+    for (std::size_t dependency : stages_[stage].dependencies) {
+      if (states[dependency] != StateT::kDone) return false;
+    }
+    return true;
+  }
+
+  /* @brief Returns the key of a stage from its name and parameters and the
+         output hashes of its dependencies. */
+  Hash Key(std::size_t stage,
+           const std::vector<std::vector<Hash>>& output_hashes) const {
+    const Stage& s = stages_[stage];
+    std::string bytes = s.name;
+    bytes.push_back('\0');
+    bytes += s.parameters;
+    for (std::size_t dependency : s.dependencies) {
+      bytes.push_back('\0');
+      bytes += stages_[dependency].name;
+      for (Hash hash : output_hashes[dependency]) {
+        bytes.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+      }
+    }
+    return LUTChecksum(bytes.data(), bytes.size());
+  }
+
+  /* @brief Returns true if every output of the stage exists and matches the
+         recorded hash. */
+  static bool UpToDate(const Stage& stage, const std::vector<Hash>& recorded) {
+    if (recorded.size() != stage.outputs.size()) return false;
+    for (std::size_t i = 0; i < recorded.size(); ++i) {
+      if (!std::filesystem::is_regular_file(stage.outputs[i]) ||
+          FileHash(stage.outputs[i]) != recorded[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /* @brief Reads a manifest, which is empty if the file does not exist. Each
+         line holds a stage name, its key, its number of outputs, and the
+         hashes of its outputs. */
+  static Manifest LoadManifest(const std::string& path) {
+    Manifest manifest;
+    std::ifstream ins(path);
+    std::string name;
+    Record record;
+    std::size_t n_outputs;
+    while (ins >> name >> std::hex >> record.key >> std::dec >> n_outputs) {
+      record.output_hashes.resize(n_outputs);
+      for (Hash& hash : record.output_hashes) ins >> std::hex >> hash;
+      if (!ins) break;
+      manifest[name] = record;
+    }
+    return manifest;
+  }
+
+  /* @brief Writes a manifest to a temporary file and then moves it into place
+         so that an interrupted write does not corrupt it. */
+  static void SaveManifest(const std::string& path, const Manifest& manifest) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent);
+    const std::string temp_path = path + ".tmp";
+    {
+      std::ofstream os(temp_path);
+      for (const auto& [name, record] : manifest) {
+        os << name << ' ' << std::hex << record.key << std::dec << ' '
+           << record.output_hashes.size();
+        for (Hash hash : record.output_hashes) os << ' ' << std::hex << hash;
+        os << std::dec << '\n';
+      }
+      if (!os) {
+        std::string func{__func__};
+        throw std::runtime_error(func + " could not write " + temp_path);
+      }
+    }
+    std::filesystem::rename(temp_path, path);
+  }
+};  // class Pipeline
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_UTILS_PIPELINE_H_
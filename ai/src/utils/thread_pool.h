@@ -0,0 +1,122 @@
+#ifndef AI_SRC_UTILS_THREAD_POOL_H_
+#define AI_SRC_UTILS_THREAD_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+namespace fishbait {
+
+/* A fixed set of threads which run one task at a time together. The threads
+   are started once and wait for the next task between tasks, so code which
+   runs many short parallel phases does not start and join threads for each
+   one. The thread calling Run() takes part as worker 0. */
+class ThreadPool {
+ private:
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable task_ready_;
+  std::condition_variable task_done_;
+  std::function<void(uint32_t)> task_;
+  uint32_t n_workers_ = 0;  // number of workers taking part in the task
+  uint64_t generation_ = 0;  // incremented each time a task starts
+  uint32_t pending_ = 0;  // threads which have not finished the task
+  std::exception_ptr error_;
+  bool stop_ = false;
+
+ public:
+  /* @brief Starts a pool of the given number of workers, counting the thread
+         which calls Run(). */
+  explicit ThreadPool(uint32_t n_workers) {
+    for (uint32_t worker = 1; worker < n_workers; ++worker) {
+      threads_.emplace_back([this, worker] { Work(worker); });
+    }
+  }
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    task_ready_.notify_all();
+    for (std::thread& thread : threads_) thread.join();
+  }
+
+  /* @brief Returns the number of workers, counting the thread which calls
+         Run(). */
+  uint32_t size() const { return threads_.size() + 1; }
+
+  /*
+    @brief Calls fn(worker) on workers 0 to n_workers - 1 at once and returns
+        when every call has returned. If a call throws, the first exception is
+        rethrown once every call has returned.
+
+    @param n_workers The number of workers to use. At most size().
+    @param fn The task to run.
+  */
+  template <typename Fn>
+  void Run(uint32_t n_workers, Fn&& fn) {
+    if (n_workers <= 1 || threads_.empty()) {
+      for (uint32_t worker = 0; worker < n_workers; ++worker) fn(worker);
+      return;
+    }
+    n_workers = std::min<uint32_t>(n_workers, size());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = [&fn](uint32_t worker) { fn(worker); };
+      n_workers_ = n_workers;
+      pending_ = n_workers - 1;
+      error_ = nullptr;
+      ++generation_;
+    }
+    task_ready_.notify_all();
+
+    std::exception_ptr error;
+    try {
+      fn(0);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+    if (!error) error = error_;
+    lock.unlock();
+    if (error) std::rethrow_exception(error);
+  }  // Run()
+
+ private:
+  /* @brief Waits for each task and runs it if this worker takes part. */
+  void Work(uint32_t worker) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      task_ready_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+      if (worker >= n_workers_) continue;
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        task_(worker);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      lock.lock();
+      if (error && !error_) error_ = error;
+      if (--pending_ == 0) task_done_.notify_one();
+    }
+  }  // Work()
+};  // class ThreadPool
+
+}  // namespace fishbait
+
+#endif  // AI_SRC_UTILS_THREAD_POOL_H_
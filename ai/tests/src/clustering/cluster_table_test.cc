@@ -1,8 +1,42 @@
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 #include "catch2/catch.hpp"
+#include "clustering/cluster_files.h"
 #include "clustering/cluster_table.h"
+#include "clustering/definitions.h"
 #include "poker/node.h"
+#include "utils/lut_file.h"
+#include "utils/timer.h"
+
+TEST_CASE("cluster assignment files", "[clustering][cluster_table]") {
+  static_assert(sizeof(fishbait::ClusterEntry) == 1);
+  const std::string path = "out/tests/cluster_assignments.lut";
+  std::vector<fishbait::MeanId> assignments(100000);
+  for (std::size_t i = 0; i < assignments.size(); ++i) {
+    assignments[i] = (i * 7) % fishbait::MaxNumClusters();
+  }
+  fishbait::SaveClusterAssignments(path, assignments);
+
+  fishbait::MappedLUT<fishbait::ClusterEntry> mapped(path, true);
+  REQUIRE(mapped.size() == assignments.size());
+  for (std::size_t i = 0; i < assignments.size(); ++i) {
+    REQUIRE(mapped[i] == assignments[i]);
+  }
+  REQUIRE(std::filesystem::file_size(path) <
+          assignments.size() * sizeof(fishbait::MeanId) / 2);
+
+  assignments[5] = std::numeric_limits<fishbait::ClusterEntry>::max() + 1;
+  REQUIRE_THROWS_AS(fishbait::SaveClusterAssignments(path, assignments),
+                    std::out_of_range);
+}  // TEST_CASE "cluster assignment files"
 
 TEST_CASE("ClusterTable bounds check", "[.][clustering][cluster_table]") {
   constexpr fishbait::PlayerN kPlayers = 6;
@@ -15,6 +49,7 @@ TEST_CASE("ClusterTable bounds check", "[.][clustering][cluster_table]") {
           table.ClusterArray(game);
       for (std::size_t j = 0; j < clusters.size(); ++j) {
         REQUIRE(clusters[j] < fishbait::NumClusters(game.round()));
+        REQUIRE(clusters[j] == table.Cluster(game, j));
         static_assert(!std::is_signed_v<fishbait::CardCluster>);
       }
     }
@@ -23,3 +58,57 @@ TEST_CASE("ClusterTable bounds check", "[.][clustering][cluster_table]") {
     }
   }
 }
+
+TEST_CASE("ClusterTable cluster matrix", "[.][clustering][cluster_table]") {
+  constexpr fishbait::PlayerN kPlayers = 6;
+  fishbait::ClusterTable table{false};
+  for (int trial = 0; trial < 100; ++trial) {
+    fishbait::Node<kPlayers> game;
+    game.DealAll();
+    fishbait::DealClusters<kPlayers> clusters = table.ClusterMatrix(game);
+    while (game.in_progress()) {
+      if (game.acting_player() == game.kChancePlayer) {
+        game.ProceedPlay();
+        REQUIRE(clusters[+game.round()] == table.ClusterArray(game));
+      } else {
+        game.Apply(fishbait::Action::kCheckCall);
+      }
+    }
+  }
+}  // TEST_CASE "ClusterTable cluster matrix"
+
+TEST_CASE("ClusterTable benchmark",
+          "[.][clustering][cluster_table][benchmark]") {
+  constexpr fishbait::PlayerN kPlayers = 6;
+  constexpr int kDeals = 200000;
+  fishbait::ClusterTable table{false};
+  fishbait::Node<kPlayers> game;
+  for (fishbait::RoundId round = 1; round < fishbait::kNRounds; ++round) {
+    for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+      game.Apply(fishbait::Action::kCheckCall);
+    }
+
+    uint64_t checksum = 0;
+    fishbait::Timer timer;
+    for (int trial = 0; trial < kDeals; ++trial) {
+      game.Deal();
+      for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+        checksum += table.Cluster(game, i);
+      }
+    }
+    double one_at_a_time = timer.Check<fishbait::Timer::Seconds>();
+
+    uint64_t array_checksum = 0;
+    timer.Reset();
+    for (int trial = 0; trial < kDeals; ++trial) {
+      game.Deal();
+      for (fishbait::CardCluster cluster : table.ClusterArray(game)) {
+        array_checksum += cluster;
+      }
+    }
+    double array = timer.Check<fishbait::Timer::Seconds>();
+    std::cout << "round " << +round << ": Cluster " << one_at_a_time
+              << " s, ClusterArray " << array << " s (" << checksum << ", "
+              << array_checksum << ")" << std::endl;
+  }
+}  // TEST_CASE "ClusterTable benchmark"
@@ -1,8 +1,48 @@
 #include <cstdint>
+#include <iostream>
+#include <random>
 #include <vector>
 
 #include "catch2/catch.hpp"
 #include "clustering/distance.h"
+#include "utils/timer.h"
+
+namespace {
+
+/* @brief Returns n random values between 0 and max. */
+template <typename T>
+std::vector<T> RandomVector(std::size_t n, double max, std::mt19937* rng) {
+  std::uniform_real_distribution<double> value(0, max);
+  std::vector<T> v(n);
+  for (T& x : v) x = static_cast<T>(value(*rng));
+  return v;
+}
+
+/* @brief Checks that Compute matches ComputeScalar on random vectors of every
+       width up to 64, so that every tail length is covered. If exact, the two
+       must be equal. */
+template <template <typename, typename> class Distance, typename T,
+          typename U>
+void RequireMatchesScalar(bool exact) {
+  std::mt19937 rng(7);
+  for (std::size_t n = 0; n <= 64; ++n) {
+    for (int trial = 0; trial < 10; ++trial) {
+      std::vector<T> p = RandomVector<T>(n, 1081, &rng);
+      std::vector<U> q = RandomVector<U>(n, 1081, &rng);
+      double scalar = Distance<T, U>::ComputeScalar(
+          nda::vector_ref<T>{p}, nda::vector_ref<U>{q});
+      double simd = Distance<T, U>::Compute(nda::vector_ref<T>{p},
+                                            nda::vector_ref<U>{q});
+      if (exact) {
+        REQUIRE(simd == scalar);
+      } else {
+        REQUIRE(simd == Approx(scalar).epsilon(1e-12).margin(1e-9));
+      }
+    }
+  }
+}
+
+}  // namespace
 
 TEST_CASE("EMD identical test", "[clustering][distance]") {
   std::vector<uint16_t> p1(50, 0);  // flops _id: 302847
@@ -80,3 +120,81 @@ TEST_CASE("Euclidean int double test", "[clustering][distance]") {
 
   REQUIRE(double_int == 128.181916041226344304959638975560665130615234375);
 }
+
+TEST_CASE("EMD matches the scalar version", "[clustering][distance]") {
+  using fishbait::EarthMoverDistance;
+  RequireMatchesScalar<EarthMoverDistance, uint32_t, uint32_t>(true);
+  RequireMatchesScalar<EarthMoverDistance, int32_t, int32_t>(true);
+  RequireMatchesScalar<EarthMoverDistance, uint32_t, double>(false);
+  RequireMatchesScalar<EarthMoverDistance, double, uint32_t>(false);
+  RequireMatchesScalar<EarthMoverDistance, double, double>(false);
+  RequireMatchesScalar<EarthMoverDistance, float, double>(false);
+  RequireMatchesScalar<EarthMoverDistance, float, float>(false);
+  RequireMatchesScalar<EarthMoverDistance, uint16_t, double>(false);
+
+  // Counts above 2^31 are converted exactly
+  std::vector<uint32_t> p{4000000000, 1, 2, 3000000000, 5};
+  std::vector<uint32_t> q{1, 4000000000, 3000000000, 2, 0};
+  REQUIRE(EarthMoverDistance<uint32_t, uint32_t>::Compute(
+              nda::vector_ref<uint32_t>{p}, nda::vector_ref<uint32_t>{q}) ==
+          EarthMoverDistance<uint32_t, uint32_t>::ComputeScalar(
+              nda::vector_ref<uint32_t>{p}, nda::vector_ref<uint32_t>{q}));
+}
+
+TEST_CASE("Euclidean distance matches the scalar version",
+          "[clustering][distance]") {
+  using fishbait::EuclideanDistance;
+  RequireMatchesScalar<EuclideanDistance, uint32_t, double>(false);
+  RequireMatchesScalar<EuclideanDistance, double, double>(false);
+  RequireMatchesScalar<EuclideanDistance, float, double>(false);
+  RequireMatchesScalar<EuclideanDistance, double, float>(false);
+  RequireMatchesScalar<EuclideanDistance, float, float>(false);
+  RequireMatchesScalar<EuclideanDistance, int16_t, double>(false);
+}
+
+TEST_CASE("Distance benchmark", "[.][clustering][distance][benchmark]") {
+  constexpr int kPairs = 1000;
+  constexpr int kRepeats = 2000;
+  std::mt19937 rng(7);
+
+  // Time each kernel on vectors shaped like each round's data points
+  auto benchmark = [&](auto distance, auto p_type, auto q_type,
+                       std::size_t width, const char* name) {
+    using Distance = decltype(distance);
+    using T = decltype(p_type);
+    using U = decltype(q_type);
+    std::vector<std::vector<T>> p(kPairs);
+    std::vector<std::vector<U>> q(kPairs);
+    for (int i = 0; i < kPairs; ++i) {
+      p[i] = RandomVector<T>(width, 1081, &rng);
+      q[i] = RandomVector<U>(width, 1081, &rng);
+    }
+    double check = 0;
+    fishbait::Timer timer;
+    for (int r = 0; r < kRepeats; ++r) {
+      for (int i = 0; i < kPairs; ++i) {
+        check += Distance::ComputeScalar(nda::vector_ref<T>{p[i]},
+                                         nda::vector_ref<U>{q[i]});
+      }
+    }
+    double scalar = timer.Reset<fishbait::Timer::Seconds>();
+    for (int r = 0; r < kRepeats; ++r) {
+      for (int i = 0; i < kPairs; ++i) {
+        check -= Distance::Compute(nda::vector_ref<T>{p[i]},
+                                   nda::vector_ref<U>{q[i]});
+      }
+    }
+    double simd = timer.Check<fishbait::Timer::Seconds>();
+    std::cout << name << ": scalar " << scalar << " s, simd " << simd
+              << " s, difference " << check << std::endl;
+  };
+
+  benchmark(fishbait::EarthMoverDistance<uint32_t, double>{}, uint32_t{},
+            double{}, 50, "EMD flop/turn histogram x centroid");
+  benchmark(fishbait::EarthMoverDistance<double, double>{}, double{},
+            double{}, 50, "EMD centroid x centroid");
+  benchmark(fishbait::EuclideanDistance<float, double>{}, float{}, double{},
+            8, "L2 river x centroid");
+  benchmark(fishbait::EuclideanDistance<double, double>{}, double{},
+            double{}, 8, "L2 centroid x centroid");
+}
@@ -1,5 +1,15 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -9,7 +19,131 @@
 #include "clustering/definitions.h"
 #include "clustering/distance.h"
 #include "clustering/k_means.h"
+#include "hand_strengths/definitions.h"
+#include "utils/lut_file.h"
 #include "utils/random.h"
+#include "utils/timer.h"
+
+namespace {
+
+/* @brief Returns n points drawn from k gaussian blobs with random centers. */
+nda::matrix<float> Blobs(nda::index_t n, nda::index_t dims,
+                         fishbait::MeansN k, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> center_dist(-20.0, 20.0);
+  std::normal_distribution<float> noise(0.0, 1.0);
+  nda::matrix<float> centers(nda::matrix_shape<>{k, dims});
+  for (fishbait::MeanId c = 0; c < k; ++c) {
+    for (nda::index_t j = 0; j < dims; ++j) centers(c, j) = center_dist(rng);
+  }
+  nda::matrix<float> points(nda::matrix_shape<>{n, dims});
+  for (nda::index_t x = 0; x < n; ++x) {
+    for (nda::index_t j = 0; j < dims; ++j) {
+      points(x, j) = centers(x % k, j) + noise(rng);
+    }
+  }
+  return points;
+}  // Blobs()
+
+/*
+  @brief Returns the fraction of points whose assignment in b matches their
+      assignment in a, after mapping each cluster in b to the cluster in a
+      which most of its points are assigned to.
+*/
+double Agreement(const std::vector<fishbait::MeanId>& a,
+                 const std::vector<fishbait::MeanId>& b, fishbait::MeansN k) {
+  std::vector<std::vector<std::size_t>> counts(k, std::vector<std::size_t>(k));
+  for (std::size_t x = 0; x < a.size(); ++x) ++counts[b[x]][a[x]];
+  std::size_t matching = 0;
+  for (const std::vector<std::size_t>& b_cluster : counts) {
+    matching += *std::max_element(b_cluster.begin(), b_cluster.end());
+  }
+  return static_cast<double>(matching) / a.size();
+}  // Agreement()
+
+/*
+  @brief Returns n histograms with the given number of buckets which each sum
+      to total, drawn around k random histograms.
+*/
+nda::matrix<fishbait::HistCount> Histograms(nda::index_t n,
+                                            nda::index_t buckets,
+                                            fishbait::HistCount total,
+                                            fishbait::MeansN k,
+                                            uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> weight(0.0, 1.0);
+  std::vector<std::discrete_distribution<nda::index_t>> centers;
+  for (fishbait::MeanId c = 0; c < k; ++c) {
+    std::vector<double> weights(buckets);
+    for (double& w : weights) w = std::pow(weight(rng), 4);
+    centers.emplace_back(weights.begin(), weights.end());
+  }
+  nda::matrix<fishbait::HistCount> points({n, buckets}, 0);
+  for (nda::index_t x = 0; x < n; ++x) {
+    for (fishbait::HistCount i = 0; i < total; ++i) {
+      points(x, centers[x % k](rng)) += 1;
+    }
+  }
+  return points;
+}  // Histograms()
+
+/* @brief Returns a float copy of the given clusters. */
+std::unique_ptr<nda::matrix<float>> FloatCopy(
+    const nda::matrix<double>& clusters) {
+  auto copy = std::make_unique<nda::matrix<float>>(
+      nda::matrix_shape<>{clusters.rows(), clusters.columns()});
+  for (nda::index_t c = 0; c < clusters.rows(); ++c) {
+    for (nda::index_t j = 0; j < clusters.columns(); ++j) {
+      (*copy)(c, j) = clusters(c, j);
+    }
+  }
+  return copy;
+}  // FloatCopy()
+
+/* @brief Checks that every bound finds the same clusters as Elkan. */
+template <typename T, template <class, class> class Distance,
+          typename Precision = double>
+void RequireSameFixedPoint(const nda::matrix<T>& points, fishbait::MeansN k,
+                           uint32_t seed) {
+  using KMeans = fishbait::KMeans<T, Distance, Precision>;
+  KMeans init(k);
+  init.InitPlusPlus(points, false, fishbait::Random::Seed(seed));
+
+  KMeans elkan(k, std::make_unique<nda::matrix<Precision>>(*init.clusters()));
+  elkan.Elkan(points, false, fishbait::Random::Seed(seed));
+  for (fishbait::BoundProc bounds : {fishbait::kYinyang, fishbait::kHamerly}) {
+    KMeans other(k,
+                 std::make_unique<nda::matrix<Precision>>(*init.clusters()));
+    other.Cluster(points, bounds, false, fishbait::Random::Seed(seed));
+    REQUIRE(*other.clusters() == *elkan.clusters());
+    REQUIRE(*other.assignments() == *elkan.assignments());
+    REQUIRE(other.loss() == elkan.loss());
+    REQUIRE(other.iterations() == elkan.iterations());
+  }
+}  // RequireSameFixedPoint()
+
+/* @brief Checks that clustering with float clusters and bounds finds nearly
+       the same clusters as double from the same initial clusters. */
+template <typename T, template <class, class> class Distance>
+void RequireCloseToDouble(const nda::matrix<T>& points, fishbait::MeansN k,
+                          uint32_t seed) {
+  fishbait::KMeans<T, Distance> with_double(k);
+  with_double.InitPlusPlus(points, false, fishbait::Random::Seed(seed));
+  fishbait::KMeans<T, Distance, float> with_float(
+      k, FloatCopy(*with_double.clusters()));
+
+  for (fishbait::BoundProc bounds : {fishbait::kElkan, fishbait::kYinyang,
+                                     fishbait::kHamerly}) {
+    auto d = with_double;
+    auto f = with_float;
+    d.Cluster(points, bounds, false, fishbait::Random::Seed(seed));
+    f.Cluster(points, bounds, false, fishbait::Random::Seed(seed));
+    REQUIRE(Agreement(*d.assignments(), *f.assignments(), k) > 0.999);
+    REQUIRE(f.loss() == Approx(d.loss()).epsilon(1e-4));
+  }
+}  // RequireCloseToDouble()
+
+}  // namespace
 
 // Elkan test cases generated with python and the kmeans from scikit learn after
 // disabling the mean centering and changing the cluster mean computation to
@@ -50,6 +184,10 @@ TEST_CASE("Elkan 10 double points 2 dimensions 3 clusters",
   (*initial_centers)(1, nda::all).copy_elems(nda::vector_ref<double>(c1));
   (*initial_centers)(2, nda::all).copy_elems(nda::vector_ref<double>(c2));
 
+  fishbait::KMeans<double, fishbait::EuclideanDistance, float> float_k(
+      3, FloatCopy(*initial_centers));
+  float_k.Elkan(features);
+
   fishbait::KMeans<double, fishbait::EuclideanDistance> k(
       3, std::move(initial_centers));
   k.Elkan(features);
@@ -71,8 +209,69 @@ TEST_CASE("Elkan 10 double points 2 dimensions 3 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == 9.511703026188766);
+
+  // Float clusters and bounds find the same clustering
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(9.511703026188766));
 }  // TEST_CASE("Elkan 10 double points 2 dimensions 3 clusters")
 
+TEST_CASE("Elkan 10 float points 2 dimensions 3 clusters",
+          "[clustering][kmeans]") {
+  std::vector<float> d0{-2.849093076616996, -7.50099441961392};
+  std::vector<float> d1{-8.376679683595523, -6.575072471573815};
+  std::vector<float> d2{1.854593255308436, 2.8373498485777353};
+  std::vector<float> d3{-6.693924628259479, -10.798167105362953};
+  std::vector<float> d4{-1.8438013762461565, 3.752765455389377};
+  std::vector<float> d5{-3.8002521843738686, 10.506326248059725};
+  std::vector<float> d6{1.8336376195925768, 11.124731633368821};
+  std::vector<float> d7{-0.1036452031827384, 0.4268789785280571};
+  std::vector<float> d8{2.1428126285447715, -1.9106654947313197};
+  std::vector<float> d9{-3.783596278287021, 7.733529305880115};
+
+  nda::matrix<float> features({10, 2});
+  features(0, nda::all).copy_elems(nda::vector_ref<float>(d0));
+  features(1, nda::all).copy_elems(nda::vector_ref<float>(d1));
+  features(2, nda::all).copy_elems(nda::vector_ref<float>(d2));
+  features(3, nda::all).copy_elems(nda::vector_ref<float>(d3));
+  features(4, nda::all).copy_elems(nda::vector_ref<float>(d4));
+  features(5, nda::all).copy_elems(nda::vector_ref<float>(d5));
+  features(6, nda::all).copy_elems(nda::vector_ref<float>(d6));
+  features(7, nda::all).copy_elems(nda::vector_ref<float>(d7));
+  features(8, nda::all).copy_elems(nda::vector_ref<float>(d8));
+  features(9, nda::all).copy_elems(nda::vector_ref<float>(d9));
+
+  std::vector<double> c0{0.6425235614350431, 0.898903293670528};
+  std::vector<double> c1{0.4670259744021872, 3.2289955311358631};
+  std::vector<double> c2{0.03126336690842668, 0.7057866456528065};
+
+  auto initial_centers = std::make_unique<nda::matrix<double>>(
+      nda::matrix_shape<>{3, 2});
+  (*initial_centers)(0, nda::all).copy_elems(nda::vector_ref<double>(c0));
+  (*initial_centers)(1, nda::all).copy_elems(nda::vector_ref<double>(c1));
+  (*initial_centers)(2, nda::all).copy_elems(nda::vector_ref<double>(c2));
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance, float> float_k(
+      3, FloatCopy(*initial_centers));
+  float_k.Elkan(features);
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance> k(
+      3, std::move(initial_centers));
+  k.Elkan(features);
+
+  // Same clustering as the double points, to float precision
+  std::vector<fishbait::MeanId> correct_assignments{2, 2, 0, 2, 1, 1, 1, 0, 0,
+                                                    1};
+  REQUIRE(*k.assignments() == correct_assignments);
+  REQUIRE((*k.clusters())(0, 0) == Approx(1.2979202268901564));
+  REQUIRE((*k.clusters())(1, 1) == Approx(8.27933816067451));
+  REQUIRE((*k.clusters())(2, 0) == Approx(-5.973232462823998));
+  REQUIRE(k.loss() == Approx(9.511703026188766));
+
+  // Float clusters and bounds find the same clustering
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(9.511703026188766));
+}  // TEST_CASE("Elkan 10 float points 2 dimensions 3 clusters")
+
 TEST_CASE("Elkan 10 int points 2 dimensions 5 clusters",
           "[clustering][kmeans]") {
   std::vector<int8_t> d0{4, 0};
@@ -112,6 +311,10 @@ TEST_CASE("Elkan 10 int points 2 dimensions 5 clusters",
   (*initial_centers)(3, nda::all).copy_elems(nda::vector_ref<double>(c3));
   (*initial_centers)(4, nda::all).copy_elems(nda::vector_ref<double>(c4));
 
+  fishbait::KMeans<int8_t, fishbait::EuclideanDistance, float> float_k(
+      5, FloatCopy(*initial_centers));
+  float_k.Elkan(features);
+
   fishbait::KMeans<int8_t, fishbait::EuclideanDistance> k(
       5, std::move(initial_centers));
   k.Elkan(features);
@@ -138,6 +341,10 @@ TEST_CASE("Elkan 10 int points 2 dimensions 5 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == 5.283333333333333);
+
+  // Float clusters and bounds find the same clustering
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(5.283333333333333));
 }  // TEST_CASE("Elkan 10 int points 2 dimensions 5 clusters")
 
 TEST_CASE("Elkan 100 double points 2 dimensions 5 clusters",
@@ -359,6 +566,10 @@ TEST_CASE("Elkan 100 double points 2 dimensions 5 clusters",
   (*initial_centers)(3, nda::all).copy_elems(nda::vector_ref<double>(c3));
   (*initial_centers)(4, nda::all).copy_elems(nda::vector_ref<double>(c4));
 
+  fishbait::KMeans<double, fishbait::EuclideanDistance, float> float_k(
+      5, FloatCopy(*initial_centers));
+  float_k.Elkan(features);
+
   fishbait::KMeans<double, fishbait::EuclideanDistance> k(
       5, std::move(initial_centers));
   k.Elkan(features);
@@ -388,6 +599,10 @@ TEST_CASE("Elkan 100 double points 2 dimensions 5 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == 0.03235891455004822);
+
+  // Float clusters and bounds find the same clustering
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(0.03235891455004822));
 }  // TEST_CASE("Elkan 100 double points 2 dimensions 5 clusters")
 
 TEST_CASE("Elkan 10 double points 1 dimension 2 clusters",
@@ -423,6 +638,10 @@ TEST_CASE("Elkan 10 double points 1 dimension 2 clusters",
   (*initial_centers)(0, nda::all).copy_elems(nda::vector_ref<double>(c0));
   (*initial_centers)(1, nda::all).copy_elems(nda::vector_ref<double>(c1));
 
+  fishbait::KMeans<double, fishbait::EuclideanDistance, float> float_k(
+      2, FloatCopy(*initial_centers));
+  float_k.Elkan(features);
+
   fishbait::KMeans<double, fishbait::EuclideanDistance> k(2,
       std::move(initial_centers));
   k.Elkan(features);
@@ -442,6 +661,10 @@ TEST_CASE("Elkan 10 double points 1 dimension 2 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == 0.8264051400816704);
+
+  // Float clusters and bounds find the same clustering
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(0.8264051400816704));
 }  // TEST_CASE("Elkan 10 double points 1 dimension 2 clusters")
 
 TEST_CASE("Elkan 10 int points 10 dimensions 3 clusters",
@@ -479,6 +702,10 @@ TEST_CASE("Elkan 10 int points 10 dimensions 3 clusters",
   (*initial_centers)(1, nda::all).copy_elems(nda::vector_ref<double>(c1));
   (*initial_centers)(2, nda::all).copy_elems(nda::vector_ref<double>(c2));
 
+  fishbait::KMeans<int8_t, fishbait::EuclideanDistance, float> float_k(
+      3, FloatCopy(*initial_centers));
+  float_k.Elkan(features);
+
   fishbait::KMeans<int8_t, fishbait::EuclideanDistance> k(
       3, std::move(initial_centers));
   k.Elkan(features);
@@ -506,6 +733,10 @@ TEST_CASE("Elkan 10 int points 10 dimensions 3 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == 38.983333333333334);
+
+  // Float clusters and bounds find the same clustering
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(38.983333333333334));
 }  // TEST_CASE("Elkan 10 int points 10 dimensions 3 clusters")
 
 TEST_CASE("Elkan 10 int points (6+4 duplicates) 2 dimensions 2 clusters",
@@ -541,6 +772,10 @@ TEST_CASE("Elkan 10 int points (6+4 duplicates) 2 dimensions 2 clusters",
   (*initial_centers)(0, nda::all).copy_elems(nda::vector_ref<double>(c0));
   (*initial_centers)(1, nda::all).copy_elems(nda::vector_ref<double>(c1));
 
+  fishbait::KMeans<int8_t, fishbait::EuclideanDistance, float> float_k(
+      2, FloatCopy(*initial_centers));
+  float_k.Elkan(features);
+
   fishbait::KMeans<int8_t, fishbait::EuclideanDistance> k(
       2, std::move(initial_centers));
   k.Elkan(features);
@@ -560,6 +795,10 @@ TEST_CASE("Elkan 10 int points (6+4 duplicates) 2 dimensions 2 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == 0.0);
+
+  // Float clusters and bounds find the same clustering
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(0.0));
 }  // TEST_CASE("Elkan 10 int points (6+4 duplicates) 2 dimensions 2 clusters")
 
 // kmeans++ test cases generated with spreadsheets and a separate C++ program to
@@ -1146,6 +1385,13 @@ TEST_CASE("multiple restarts 10 int points 10 dimensions 3 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == 81.40833333333333);
+
+  // Float clusters and bounds find the same clustering
+  fishbait::KMeans<int8_t, fishbait::EuclideanDistance, float> float_k(3);
+  float_k.MultipleRestarts(features, 10, fishbait::kPlusPlus, false,
+                           fishbait::Random::Seed(773202));
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(81.40833333333333));
 }  // TEST_CASE("multiple restarts 10 int points 10 dimensions 3 clusters")
 
 TEST_CASE("multiple restarts 100 double points 2 dimensions 3 clusters",
@@ -1377,4 +1623,499 @@ TEST_CASE("multiple restarts 100 double points 2 dimensions 3 clusters",
   REQUIRE(*k.assignments() == correct_assignments);
 
   REQUIRE(k.loss() == Approx(0.05509715642422428));
+
+  // Float clusters and bounds find the same clustering
+  fishbait::KMeans<double, fishbait::EuclideanDistance, float> float_k(3);
+  float_k.MultipleRestarts(features, 10, fishbait::kRandomProb, false,
+                           fishbait::Random::Seed(1029384));
+  REQUIRE(*float_k.assignments() == correct_assignments);
+  REQUIRE(float_k.loss() == Approx(0.05509715642422428));
 }  // TEST_CASE("multiple restarts 100 double points 2 dimensions 3 clusters")
+
+TEST_CASE("mini-batch and subsample match Elkan on blobs",
+          "[clustering][kmeans]") {
+  constexpr fishbait::MeansN kClusters = 8;
+  nda::matrix<float> points = Blobs(4000, 4, kClusters, 4829);
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance> full(kClusters);
+  full.MultipleRestarts(points, 3, fishbait::kPlusPlus, false,
+                        fishbait::Random::Seed(1337));
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance> mini_batch(kClusters);
+  mini_batch.MiniBatch(points, 200, 300, false, fishbait::Random::Seed(1337));
+  REQUIRE(mini_batch.assignments()->size() == 4000);
+  REQUIRE(mini_batch.loss() < 1.05 * full.loss());
+  REQUIRE(Agreement(*full.assignments(), *mini_batch.assignments(),
+                    kClusters) > 0.99);
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance> subsample(kClusters);
+  subsample.Subsample(points, 500, 3, fishbait::kPlusPlus, false,
+                      fishbait::Random::Seed(1337));
+  REQUIRE(subsample.assignments()->size() == 4000);
+  REQUIRE(subsample.loss() < 1.05 * full.loss());
+  REQUIRE(Agreement(*full.assignments(), *subsample.assignments(),
+                    kClusters) > 0.99);
+
+  // Assign reproduces the loss of the full clustering
+  fishbait::KMeans<float, fishbait::EuclideanDistance> assigned(
+      kClusters, std::make_unique<nda::matrix<double>>(*full.clusters()));
+  assigned.Assign(points);
+  REQUIRE(*assigned.assignments() == *full.assignments());
+  REQUIRE(assigned.loss() == Approx(full.loss()));
+}  // TEST_CASE "mini-batch and subsample match Elkan on blobs"
+
+TEST_CASE("mini-batch and subsample benchmark",
+          "[.][clustering][kmeans][benchmark]") {
+  // Roughly the shape of the river OCHS data, scaled down
+  constexpr fishbait::MeansN kClusters = 200;
+  nda::matrix<float> points = Blobs(200000, 8, kClusters, 4829);
+  fishbait::Timer timer;
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance> full(kClusters);
+  full.Elkan(points, false, fishbait::Random::Seed(1337));
+  double full_time = timer.Reset<fishbait::Timer::Seconds>();
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance> mini_batch(kClusters);
+  mini_batch.MiniBatch(points, 10000, 200, false,
+                       fishbait::Random::Seed(1337));
+  double mini_batch_time = timer.Reset<fishbait::Timer::Seconds>();
+
+  fishbait::KMeans<float, fishbait::EuclideanDistance> subsample(kClusters);
+  subsample.Subsample(points, 20000, 1, fishbait::kPlusPlus, false,
+                      fishbait::Random::Seed(1337));
+  double subsample_time = timer.Reset<fishbait::Timer::Seconds>();
+
+  std::cout << "Elkan: loss " << full.loss() << " in " << full_time << " s"
+            << std::endl;
+  std::cout << "mini-batch: loss " << mini_batch.loss() << ", agreement "
+            << Agreement(*full.assignments(), *mini_batch.assignments(),
+                         kClusters)
+            << " in " << mini_batch_time << " s" << std::endl;
+  std::cout << "subsample: loss " << subsample.loss() << ", agreement "
+            << Agreement(*full.assignments(), *subsample.assignments(),
+                         kClusters)
+            << " in " << subsample_time << " s" << std::endl;
+}  // TEST_CASE "mini-batch and subsample benchmark"
+
+TEST_CASE("Yinyang and Hamerly match Elkan", "[clustering][kmeans]") {
+  SECTION("Euclidean blobs") {
+    nda::matrix<float> points = Blobs(3000, 4, 12, 4829);
+    RequireSameFixedPoint<float, fishbait::EuclideanDistance>(points, 23, 7);
+    RequireSameFixedPoint<float, fishbait::EuclideanDistance>(points, 8, 8);
+    RequireSameFixedPoint<float, fishbait::EuclideanDistance>(points, 1, 9);
+  }
+  SECTION("Earth mover's histograms") {
+    nda::matrix<fishbait::HistCount> points = Histograms(1500, 20, 46, 15, 31);
+    RequireSameFixedPoint<fishbait::HistCount, fishbait::EarthMoverDistance>(
+        points, 31, 7);
+  }
+  SECTION("empty clusters") {
+    // Random initial clusters among few points leave clusters empty in many
+    // iterations, and they must be filled the same way by every bound
+    using KMeans = fishbait::KMeans<float, fishbait::EuclideanDistance>;
+    constexpr fishbait::MeansN kClusters = 12;
+    std::mt19937 rng(4242);
+    std::uniform_real_distribution<float> coordinate(-10.0, 10.0);
+    for (int run = 0; run < 500; ++run) {
+      nda::matrix<float> points(nda::matrix_shape<>{60, 2});
+      points.for_each_value([&](float& coord) { coord = coordinate(rng); });
+      nda::matrix<double> init(nda::matrix_shape<>{kClusters, 2});
+      init.for_each_value([&](double& coord) { coord = coordinate(rng); });
+
+      KMeans elkan(kClusters, std::make_unique<nda::matrix<double>>(init));
+      elkan.Elkan(points, false, fishbait::Random::Seed(run));
+      REQUIRE(!std::isnan(elkan.loss()));
+      for (fishbait::BoundProc bounds : {fishbait::kYinyang,
+                                         fishbait::kHamerly}) {
+        KMeans other(kClusters, std::make_unique<nda::matrix<double>>(init));
+        other.Cluster(points, bounds, false, fishbait::Random::Seed(run));
+        REQUIRE(*other.assignments() == *elkan.assignments());
+        REQUIRE(other.loss() == elkan.loss());
+      }
+    }
+  }
+  SECTION("multiple restarts") {
+    nda::matrix<float> points = Blobs(1000, 3, 6, 99);
+    fishbait::KMeans<float, fishbait::EuclideanDistance> elkan(10);
+    elkan.MultipleRestarts(points, 3, fishbait::kPlusPlus, false,
+                           fishbait::Random::Seed(5));
+    fishbait::KMeans<float, fishbait::EuclideanDistance> yinyang(10);
+    yinyang.MultipleRestarts(points, 3, fishbait::kPlusPlus, false,
+                             fishbait::Random::Seed(5), fishbait::kYinyang);
+    REQUIRE(*yinyang.clusters() == *elkan.clusters());
+    REQUIRE(yinyang.loss() == elkan.loss());
+  }
+}  // TEST_CASE "Yinyang and Hamerly match Elkan"
+
+TEST_CASE("Elkan Yinyang and Hamerly benchmark",
+          "[.][clustering][kmeans][benchmark]") {
+  constexpr fishbait::MeansN kClusters = 200;
+  constexpr nda::index_t kRows = 50000;
+  constexpr std::array<const char*, 3> kNames = {"Elkan", "Yinyang",
+                                                 "Hamerly"};
+
+  // Time per iteration on a sample shaped like each round's data, and the
+  // memory the bounds would take for all of the round's hands
+  auto benchmark = [&](auto points, auto kmeans, fishbait::Round round) {
+    std::cout << "round " << +(+round) << ", " << points.rows() << " of "
+              << fishbait::ImperfectRecallHands(round) << " hands"
+              << std::endl;
+    kmeans.InitPlusPlus(points, false, fishbait::Random::Seed(1337));
+    for (fishbait::BoundProc bounds : {fishbait::kElkan, fishbait::kYinyang,
+                                       fishbait::kHamerly}) {
+      auto run = kmeans;
+      fishbait::Timer timer;
+      run.Cluster(points, bounds, false, fishbait::Random::Seed(1337));
+      double seconds = timer.Check<fishbait::Timer::Seconds>();
+      double gigabytes = decltype(kmeans)::BoundBytes(bounds,
+          fishbait::ImperfectRecallHands(round), kClusters) / 1e9;
+      std::cout << "  " << kNames[bounds] << ": " << run.iterations()
+                << " iterations, " << seconds / run.iterations()
+                << " s per iteration, " << gigabytes << " GB for the round"
+                << std::endl;
+    }
+  };
+
+  using HistKMeans = fishbait::KMeans<fishbait::HistCount,
+                                      fishbait::EarthMoverDistance>;
+  using OCHSKMeans = fishbait::KMeans<float, fishbait::EuclideanDistance>;
+  benchmark(Histograms(kRows, 50, 1081, kClusters, 1), HistKMeans(kClusters),
+            fishbait::Round::kFlop);
+  benchmark(Histograms(kRows, 50, 46, kClusters, 2), HistKMeans(kClusters),
+            fishbait::Round::kTurn);
+  benchmark(Blobs(kRows, 8, kClusters, 3), OCHSKMeans(kClusters),
+            fishbait::Round::kRiver);
+}  // TEST_CASE "Elkan Yinyang and Hamerly benchmark"
+
+TEST_CASE("Elkan step benchmark", "[.][clustering][kmeans][benchmark]") {
+  constexpr fishbait::MeansN kClusters = 200;
+  constexpr nda::index_t kRows = 50000;
+
+  // Seconds spent in each step of Elkan on a sample shaped like the turn
+  nda::matrix<fishbait::HistCount> points =
+      Histograms(kRows, 50, 46, kClusters, 2);
+  fishbait::KMeans<fishbait::HistCount, fishbait::EarthMoverDistance>
+      kmeans(kClusters);
+  kmeans.InitPlusPlus(points, false, fishbait::Random::Seed(1337));
+  fishbait::Timer timer;
+  kmeans.Elkan(points, false, fishbait::Random::Seed(1337));
+  double seconds = timer.Check<fishbait::Timer::Seconds>();
+
+  const auto& times = kmeans.elkan_times();
+  std::cout << kmeans.iterations() << " iterations in " << seconds << " s"
+            << std::endl;
+  std::cout << "  initialization: " << times.initialization << " s"
+            << std::endl;
+  std::cout << "  cluster distances: " << times.cluster_dists << " s"
+            << std::endl;
+  std::cout << "  bounds and reassignment: " << times.bounds << " s"
+            << std::endl;
+  std::cout << "  means: " << times.means << " s" << std::endl;
+  std::cout << "  lower bounds: " << times.lower_bounds << " s" << std::endl;
+  std::cout << "  upper bounds: " << times.upper_bounds << " s" << std::endl;
+  std::cout << "  loss: " << times.loss << " s" << std::endl;
+}  // TEST_CASE "Elkan step benchmark"
+
+TEST_CASE("parallel kmeans++ and kmeans|| initialization",
+          "[clustering][kmeans]") {
+  constexpr fishbait::MeansN kClusters = 8;
+  // Enough points for the sums to be split into blocks
+  nda::matrix<float> points = Blobs(20000, 4, kClusters, 4829);
+  using FloatKMeans = fishbait::KMeans<float, fishbait::EuclideanDistance>;
+
+  // Initial clusters are data points and do not depend on anything but the
+  // seed
+  for (fishbait::InitProc init : {fishbait::kParallelPlusPlus,
+                                  fishbait::kScalable}) {
+    FloatKMeans a(kClusters);
+    FloatKMeans b(kClusters);
+    if (init == fishbait::kParallelPlusPlus) {
+      a.ParallelInitPlusPlus(points, false, fishbait::Random::Seed(1));
+      b.ParallelInitPlusPlus(points, false, fishbait::Random::Seed(1));
+    } else {
+      a.ScalableInit(points, false, fishbait::Random::Seed(1));
+      b.ScalableInit(points, false, fishbait::Random::Seed(1));
+    }
+    REQUIRE(std::equal(a.clusters()->data(),
+                       a.clusters()->data() + a.clusters()->size(),
+                       b.clusters()->data()));
+    for (fishbait::MeanId c = 0; c < kClusters; ++c) {
+      bool found = false;
+      for (nda::index_t x = 0; x < points.rows() && !found; ++x) {
+        found = true;
+        for (nda::index_t j = 0; j < points.columns(); ++j) {
+          found = found && (*a.clusters())(c, j) == points(x, j);
+        }
+      }
+      REQUIRE(found);
+    }
+  }
+
+  // Clustering from either initializer is as good as from kmeans++
+  FloatKMeans plus_plus(kClusters);
+  plus_plus.MultipleRestarts(points, 3, fishbait::kPlusPlus, false,
+                             fishbait::Random::Seed(1337));
+  for (fishbait::InitProc init : {fishbait::kParallelPlusPlus,
+                                  fishbait::kScalable}) {
+    FloatKMeans k(kClusters);
+    k.MultipleRestarts(points, 3, init, false, fishbait::Random::Seed(1337));
+    REQUIRE(k.loss() < 1.05 * plus_plus.loss());
+    REQUIRE(Agreement(*plus_plus.assignments(), *k.assignments(),
+                      kClusters) > 0.99);
+  }
+
+  // Fewer distinct points than clusters
+  nda::matrix<float> repeated(nda::matrix_shape<>{3000, 2});
+  for (nda::index_t x = 0; x < repeated.rows(); ++x) {
+    repeated(x, 0) = x % 3;
+    repeated(x, 1) = -(x % 3);
+  }
+  FloatKMeans few(5);
+  few.ScalableInit(repeated, false, fishbait::Random::Seed(1));
+  REQUIRE(few.clusters()->rows() == 5);
+  few.ParallelInitPlusPlus(repeated, false, fishbait::Random::Seed(1));
+  REQUIRE(few.clusters()->rows() == 5);
+}  // TEST_CASE "parallel kmeans++ and kmeans|| initialization"
+
+TEST_CASE("initialization benchmark", "[.][clustering][kmeans][benchmark]") {
+  // Roughly the shape of the river OCHS data, scaled down
+  constexpr fishbait::MeansN kClusters = 200;
+  nda::matrix<float> points = Blobs(200000, 8, kClusters, 4829);
+  constexpr std::array<const char*, 3> kNames = {"kmeans++",
+                                                 "parallel kmeans++",
+                                                 "kmeans||"};
+
+  for (int i = 0; i < 3; ++i) {
+    fishbait::KMeans<float, fishbait::EuclideanDistance> k(kClusters);
+    fishbait::Timer timer;
+    if (i == 0) {
+      k.InitPlusPlus(points, false, fishbait::Random::Seed(1337));
+    } else if (i == 1) {
+      k.ParallelInitPlusPlus(points, false, fishbait::Random::Seed(1337));
+    } else {
+      k.ScalableInit(points, false, fishbait::Random::Seed(1337));
+    }
+    double seconds = timer.Reset<fishbait::Timer::Seconds>();
+    k.Assign(points);
+    double init_loss = k.loss();
+    timer.Reset();
+    k.Cluster(points, fishbait::kHamerly, false, fishbait::Random::Seed(1));
+    std::cout << kNames[i] << ": initialized in " << seconds
+              << " s, initial loss " << init_loss << ", final loss "
+              << k.loss() << " after " << k.iterations() << " iterations in "
+              << timer.Check<fishbait::Timer::Seconds>() << " s" << std::endl;
+  }
+}  // TEST_CASE "initialization benchmark"
+
+TEST_CASE("concurrent restarts match sequential restarts",
+          "[clustering][kmeans]") {
+  constexpr fishbait::MeansN kClusters = 8;
+  nda::matrix<float> points = Blobs(4000, 4, kClusters, 4829);
+  using FloatKMeans = fishbait::KMeans<float, fishbait::EuclideanDistance>;
+  const std::size_t trial_bytes = FloatKMeans::TrialBytes(
+      fishbait::kPlusPlus, fishbait::kYinyang, points.rows(), kClusters);
+
+  FloatKMeans sequential(kClusters);
+  sequential.MultipleRestarts(points, 5, fishbait::kPlusPlus, false,
+                              fishbait::Random::Seed(1337),
+                              fishbait::kYinyang);
+  for (std::size_t jobs : {2, 3, 5, 8}) {
+    FloatKMeans concurrent(kClusters);
+    concurrent.MultipleRestarts(points, 5, fishbait::kPlusPlus, false,
+                                fishbait::Random::Seed(1337),
+                                fishbait::kYinyang, jobs * trial_bytes);
+    REQUIRE(concurrent.loss() == sequential.loss());
+    REQUIRE(*concurrent.assignments() == *sequential.assignments());
+    REQUIRE(std::equal(concurrent.clusters()->data(),
+                       concurrent.clusters()->data() +
+                           concurrent.clusters()->size(),
+                       sequential.clusters()->data()));
+  }
+
+  FloatKMeans single_thread(kClusters);
+  single_thread.SetMaxThreads(1);
+  single_thread.MultipleRestarts(points, 5, fishbait::kPlusPlus, false,
+                                 fishbait::Random::Seed(1337),
+                                 fishbait::kYinyang, 3 * trial_bytes);
+  REQUIRE(single_thread.loss() == sequential.loss());
+  REQUIRE(*single_thread.assignments() == *sequential.assignments());
+
+  // Restarts hold the larger of their initialization and clustering state
+  REQUIRE(FloatKMeans::TrialBytes(fishbait::kScalable, fishbait::kHamerly,
+                                  1000, kClusters) >=
+          1000 * (sizeof(double) + sizeof(uint32_t)));
+  REQUIRE(FloatKMeans::TrialBytes(fishbait::kScalable, fishbait::kElkan, 1000,
+                                  kClusters) ==
+          FloatKMeans::BoundBytes(fishbait::kElkan, 1000, kClusters));
+  REQUIRE(FloatKMeans::TrialBytes(fishbait::kRandomSum, fishbait::kHamerly,
+                                  1000, kClusters) ==
+          FloatKMeans::BoundBytes(fishbait::kHamerly, 1000, kClusters));
+}  // TEST_CASE "concurrent restarts match sequential restarts"
+
+TEST_CASE("concurrent restarts benchmark",
+          "[.][clustering][kmeans][benchmark]") {
+  constexpr fishbait::MeansN kClusters = 200;
+  nda::matrix<fishbait::HistCount> points =
+      Histograms(50000, 50, 46, kClusters, 2);
+  using HistKMeans = fishbait::KMeans<fishbait::HistCount,
+                                      fishbait::EarthMoverDistance>;
+  const std::size_t trial_bytes = HistKMeans::TrialBytes(
+      fishbait::kParallelPlusPlus, fishbait::kYinyang, points.rows(),
+      kClusters);
+
+  for (std::size_t jobs : {1, 2, 4, 8}) {
+    HistKMeans k(kClusters);
+    fishbait::Timer timer;
+    k.MultipleRestarts(points, 8, fishbait::kParallelPlusPlus, false,
+                       fishbait::Random::Seed(1337), fishbait::kYinyang,
+                       jobs * trial_bytes);
+    std::cout << jobs << " at once: " << timer.Check<fishbait::Timer::Seconds>()
+              << " s, loss " << k.loss() << std::endl;
+  }
+}  // TEST_CASE "concurrent restarts benchmark"
+
+TEST_CASE("float precision", "[clustering][kmeans]") {
+  nda::matrix<float> blobs = Blobs(3000, 4, 12, 4829);
+  nda::matrix<fishbait::HistCount> histograms =
+      Histograms(1500, 20, 46, 15, 31);
+
+  // Bounds are rounded so that every bound still finds the same clusters
+  RequireSameFixedPoint<float, fishbait::EuclideanDistance, float>(blobs, 23,
+                                                                    7);
+  RequireSameFixedPoint<fishbait::HistCount, fishbait::EarthMoverDistance,
+                        float>(histograms, 31, 7);
+
+  RequireCloseToDouble<float, fishbait::EuclideanDistance>(blobs, 23, 7);
+  RequireCloseToDouble<fishbait::HistCount, fishbait::EarthMoverDistance>(
+      histograms, 31, 7);
+
+  // Float halves the bounds
+  using DoubleKMeans = fishbait::KMeans<fishbait::HistCount,
+                                        fishbait::EarthMoverDistance>;
+  using FloatKMeans = fishbait::KMeans<fishbait::HistCount,
+                                       fishbait::EarthMoverDistance, float>;
+  REQUIRE(FloatKMeans::BoundBytes(fishbait::kElkan, 1000, 200) <
+          0.51 * DoubleKMeans::BoundBytes(fishbait::kElkan, 1000, 200));
+}  // TEST_CASE "float precision"
+
+TEST_CASE("clustering a mapped LUT matches clustering in memory",
+          "[clustering][kmeans]") {
+  constexpr fishbait::MeansN kClusters = 12;
+  const std::string path = "out/tests/k_means_points.lut";
+  nda::matrix<fishbait::HistCount> points =
+      Histograms(3000, 20, 46, kClusters, 83);
+  fishbait::LUTFile(fishbait::FileAction::Save, path, &points);
+  fishbait::MappedLUT<fishbait::HistCount> mapped(path, true);
+  mapped.AdviseSequential();
+
+  using HistKMeans = fishbait::KMeans<fishbait::HistCount,
+                                      fishbait::EarthMoverDistance, float>;
+  for (fishbait::BoundProc bounds : {fishbait::kElkan, fishbait::kYinyang,
+                                     fishbait::kHamerly}) {
+    HistKMeans in_memory(kClusters);
+    in_memory.MultipleRestarts(points, 2, fishbait::kScalable, false,
+                               fishbait::Random::Seed(7), bounds);
+    HistKMeans out_of_core(kClusters);
+    out_of_core.MultipleRestarts(mapped.matrix(), 2, fishbait::kScalable,
+                                 false, fishbait::Random::Seed(7), bounds);
+    REQUIRE(out_of_core.loss() == in_memory.loss());
+    REQUIRE(*out_of_core.assignments() == *in_memory.assignments());
+    REQUIRE(*out_of_core.clusters() == *in_memory.clusters());
+  }
+
+  HistKMeans in_memory(kClusters);
+  in_memory.Subsample(points, 1000, 2, fishbait::kPlusPlus, false,
+                      fishbait::Random::Seed(7), fishbait::kHamerly);
+  HistKMeans out_of_core(kClusters);
+  out_of_core.Subsample(mapped.matrix(), 1000, 2, fishbait::kPlusPlus, false,
+                        fishbait::Random::Seed(7), fishbait::kHamerly);
+  REQUIRE(*out_of_core.assignments() == *in_memory.assignments());
+}  // TEST_CASE "clustering a mapped LUT matches clustering in memory"
+
+TEST_CASE("out-of-core benchmark", "[.][clustering][kmeans][benchmark]") {
+  constexpr fishbait::MeansN kClusters = 200;
+  const std::string path = "out/tests/k_means_benchmark.lut";
+  nda::matrix<fishbait::HistCount> points =
+      Histograms(200000, 50, 46, kClusters, 2);
+  fishbait::LUTFile(fishbait::FileAction::Save, path, &points);
+  using HistKMeans = fishbait::KMeans<fishbait::HistCount,
+                                      fishbait::EarthMoverDistance, float>;
+
+  auto run = [&](nda::const_matrix_ref<fishbait::HistCount> data,
+                 const std::string& name) {
+    HistKMeans k(kClusters);
+    fishbait::Timer timer;
+    k.MultipleRestarts(data, 1, fishbait::kParallelPlusPlus, false,
+                       fishbait::Random::Seed(1337), fishbait::kYinyang);
+    std::cout << name << ": " << timer.Check<fishbait::Timer::Seconds>()
+              << " s, " << k.iterations() << " iterations, loss " << k.loss()
+              << std::endl;
+  };
+  run(points, "in memory");
+
+  // Drop the file from the page cache so that the first mapped run reads it
+  // from disk
+  int fd = open(path.c_str(), O_RDONLY);
+  REQUIRE(fd != -1);
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+  fishbait::MappedLUT<fishbait::HistCount> mapped(path);
+  mapped.AdviseSequential();
+  run(mapped.matrix(), "mapped, cold page cache");
+  run(mapped.matrix(), "mapped, warm page cache");
+}  // TEST_CASE "out-of-core benchmark"
+
+TEST_CASE("warm start re-clustering", "[clustering][kmeans]") {
+  constexpr fishbait::MeansN kClusters = 12;
+  nda::matrix<float> points = Blobs(4000, 4, kClusters, 613);
+  using FloatKMeans = fishbait::KMeans<float, fishbait::EuclideanDistance,
+                                       float>;
+  auto cold = [&](fishbait::MeansN k) {
+    FloatKMeans k_means(k);
+    k_means.MultipleRestarts(points, 3, fishbait::kPlusPlus, false,
+                             fishbait::Random::Seed(5));
+    return k_means;
+  };
+  FloatKMeans fewer = cold(kClusters - 4);
+  FloatKMeans same = cold(kClusters);
+  FloatKMeans more = cold(kClusters + 4);
+
+  // Starting from a fixed point stays there
+  FloatKMeans warm(kClusters);
+  warm.Recluster(points, *same.clusters(), fishbait::kElkan, false,
+                 fishbait::Random::Seed(9));
+  REQUIRE(warm.iterations() == 1);
+  REQUIRE(*warm.assignments() == *same.assignments());
+  REQUIRE(warm.loss() == Approx(same.loss()));
+
+  // Splitting and merging converge in fewer iterations, here to better
+  // clusters than the cold restarts found, and every bound agrees
+  for (const FloatKMeans* previous : {&fewer, &more}) {
+    FloatKMeans elkan(kClusters);
+    elkan.Recluster(points, *previous->clusters(), fishbait::kElkan, false,
+                    fishbait::Random::Seed(9));
+    REQUIRE(elkan.clusters()->rows() == kClusters);
+    REQUIRE(elkan.iterations() < same.iterations());
+    REQUIRE(elkan.loss() <= same.loss());
+    for (fishbait::BoundProc bounds : {fishbait::kYinyang,
+                                       fishbait::kHamerly}) {
+      FloatKMeans other(kClusters);
+      other.Recluster(points, *previous->clusters(), bounds, false,
+                      fishbait::Random::Seed(9));
+      REQUIRE(*other.clusters() == *elkan.clusters());
+      REQUIRE(*other.assignments() == *elkan.assignments());
+    }
+  }
+
+  // A sample is clustered and then every point is assigned
+  FloatKMeans sampled(kClusters);
+  sampled.Recluster(points, *fewer.clusters(), fishbait::kHamerly, false,
+                    fishbait::Random::Seed(9), 1000);
+  REQUIRE(sampled.assignments()->size() == 4000);
+  REQUIRE(sampled.loss() < fewer.loss());
+
+  nda::matrix<float> wrong_dims = Blobs(10, 3, kClusters, 1);
+  REQUIRE_THROWS_AS(warm.WarmStart(wrong_dims, *same.clusters()),
+                    std::invalid_argument);
+}  // TEST_CASE "warm start re-clustering"
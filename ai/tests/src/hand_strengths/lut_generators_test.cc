@@ -1,4 +1,8 @@
+#include <algorithm>
 #include <array>
+#include <cstdint>
+#include <numeric>
+#include <vector>
 
 #include "catch2/catch.hpp"
 
@@ -6,10 +10,15 @@
 #include "array/matrix.h"
 #include "hand_strengths/definitions.h"
 #include "hand_strengths/lut_files.h"
+#include "hand_strengths/lut_generators.h"
+#include "hand_strengths/ochs.h"
 #include "poker/card_utils.h"
 #include "poker/definitions.h"
 #include "poker/indexer.h"
+#include "SKPokerEval/src/SevenEval.h"
 #include "utils/cereal.h"
+#include "utils/combination_matrix.h"
+#include "utils/random.h"
 
 TEST_CASE("Preflop LUT", "[.][hand_strengths][lut_generators]") {
   // Load Preflop LUT
@@ -148,30 +157,30 @@ TEST_CASE("Turn LUT", "[.][hand_strengths][lut_generators]") {
 
 TEST_CASE("River LUT", "[.][hand_strengths][lut_generators]") {
   // Load River LUT
-  nda::matrix<double> river_lut({1, 1}, 0);
+  nda::matrix<float> river_lut({1, 1}, 0);
   fishbait::RiverLUT_File(fishbait::FileAction::Load, &river_lut, true);
 
-  // Test River LUT
-  std::array<double, 8> python{0.0871559633027523, 0, 0.4496124031007752,
+  // Test River LUT. Values are stored as the nearest float.
+  std::array<float, 8> python{0.0871559633027523, 0, 0.4496124031007752,
       0.16551724137931034, 0.9, 0.36875, 0.8589743589743589, 0};
-  REQUIRE(river_lut(567, nda::all) == nda::vector_ref<double>{python});
+  REQUIRE(river_lut(567, nda::all) == nda::vector_ref<float>{python});
 
   python = {0.7720588235294118, 0.7105263157894737, 0.75, 0.9276315789473685,
       0.9327731092436975, 0.8427672955974843, 0.94, 0.8333333333333334};
-  REQUIRE(river_lut(84729, nda::all) == nda::vector_ref<double>{python});
+  REQUIRE(river_lut(84729, nda::all) == nda::vector_ref<float>{python});
 
   python = {1, 1, 0.8666666666666667, 1, 0.9680851063829787, 0.5714285714285714,
       0.6078431372549019, 0};
-  REQUIRE(river_lut(8372956, nda::all) == nda::vector_ref<double>{python});
+  REQUIRE(river_lut(8372956, nda::all) == nda::vector_ref<float>{python});
 
   python = {0.7470588235294118, 0.7894736842105263, 0.9508196721311475,
       0.7006369426751592, 0.5841584158415841, 0.9808917197452229,
       0.7478991596638656, 0.1935483870967742};
-  REQUIRE(river_lut(74629159, nda::all) == nda::vector_ref<double>{python});
+  REQUIRE(river_lut(74629159, nda::all) == nda::vector_ref<float>{python});
 
   python = {0.6502463054187192, 0, 0.01694915254237288, 0.08630952380952381, 0,
       0.08041958041958042, 0, 0};
-  REQUIRE(river_lut(112294656, nda::all) == nda::vector_ref<double>{python});
+  REQUIRE(river_lut(112294656, nda::all) == nda::vector_ref<float>{python});
 }  // TEST_CASE "River LUT"
 
 TEST_CASE("OCHS preflop LUT", "[.][hand_strengths][lut_generators]") {
@@ -222,3 +231,77 @@ TEST_CASE("OCHS preflop LUT", "[.][hand_strengths][lut_generators]") {
   index = handcalc.IndexLast({c1, c2});
   REQUIRE(ochs_pflop_lut(index, nda::all) == nda::vector_ref<double>{python});
 }  // TEST_CASE "OCHS preflop LUT"
+
+TEST_CASE("Board showdown strengths", "[hand_strengths][lut_generators]") {
+  constexpr int kBoards = 5;
+  const fishbait::CombinationMatrix<fishbait::OCHS_Id> op_clusters =
+      fishbait::SKClusterLUT();
+  fishbait::CombinationMatrix<fishbait::ShowdownStrength> strengths(
+      fishbait::kDeckSize, fishbait::ShowdownStrength{});
+  fishbait::Random rng(fishbait::Random::Seed(4567));
+  std::array<fishbait::SK_Card, fishbait::kDeckSize> deck;
+  std::iota(deck.begin(), deck.end(), 0);
+
+  for (int i = 0; i < kBoards; ++i) {
+    std::shuffle(deck.begin(), deck.end(), rng());
+    fishbait::BoardArray<fishbait::SK_Card> board;
+    std::copy_n(deck.begin(), fishbait::kBoardCards, board.begin());
+    fishbait::BoardShowdownStrengths(board, op_clusters, &strengths);
+
+    // Compare to evaluating every hero against every villan
+    auto b = fishbait::kBoardCards;
+    for (auto h1 = b; h1 < fishbait::kDeckSize; ++h1) {
+      for (auto h2 = h1 + 1; h2 < fishbait::kDeckSize; ++h2) {
+        double ehs = 0;
+        std::array<double, fishbait::kOCHS_N> ochs_wins{};
+        std::array<uint32_t, fishbait::kOCHS_N> ochs_totals{};
+        SevenEval::Rank hero_rank = SevenEval::GetRank(deck[h1], deck[h2],
+            board[0], board[1], board[2], board[3], board[4]);
+        for (auto v1 = b; v1 < fishbait::kDeckSize; ++v1) {
+          for (auto v2 = v1 + 1; v2 < fishbait::kDeckSize; ++v2) {
+            if (v1 == h1 || v1 == h2 || v2 == h1 || v2 == h2) continue;
+            SevenEval::Rank villan_rank = SevenEval::GetRank(deck[v1],
+                deck[v2], board[0], board[1], board[2], board[3], board[4]);
+            double win_value = 0;
+            if (hero_rank > villan_rank) {
+              win_value = 1;
+            } else if (hero_rank == villan_rank) {
+              win_value = 0.5;
+            }
+            fishbait::OCHS_Id cluster = op_clusters(deck[v1], deck[v2]);
+            ehs += win_value;
+            ochs_wins[cluster] += win_value;
+            ochs_totals[cluster] += 1;
+          }
+        }
+        ehs /= fishbait::kOpHandsN;
+
+        const fishbait::ShowdownStrength& strength = strengths(deck[h1],
+                                                               deck[h2]);
+        REQUIRE(strength.ehs() == ehs);
+        for (fishbait::OCHS_Id k = 0; k < fishbait::kOCHS_N; ++k) {
+          REQUIRE(strength.ochs_wins(k) == ochs_wins[k]);
+          REQUIRE(strength.ochs_totals[k] == ochs_totals[k]);
+        }
+      }  // for h2
+    }  // for h1
+  }  // for i
+}  // TEST_CASE "Board showdown strengths"
+
+TEST_CASE("LUT threads are deterministic",
+          "[.][hand_strengths][lut_generators]") {
+  std::vector<fishbait::ShowdownStrength> showdown_lut;
+  fishbait::ShowdownLUT_File(fishbait::FileAction::Load, &showdown_lut, true);
+
+  nda::matrix<fishbait::HistCount> serial_preflop =
+      fishbait::PreflopLUT(showdown_lut, false, 1);
+  nda::matrix<fishbait::HistCount> parallel_preflop =
+      fishbait::PreflopLUT(showdown_lut, false, 3);
+  REQUIRE(serial_preflop == parallel_preflop);
+
+  nda::matrix<double> serial_ochs =
+      fishbait::OCHS_PreflopLUT(showdown_lut, false, 1);
+  nda::matrix<double> parallel_ochs =
+      fishbait::OCHS_PreflopLUT(showdown_lut, false, 3);
+  REQUIRE(serial_ochs == parallel_ochs);
+}  // TEST_CASE "LUT threads are deterministic"
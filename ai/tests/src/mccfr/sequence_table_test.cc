@@ -370,3 +370,29 @@ TEST_CASE("equality test", "[mccfr][sequence_table]") {
   REQUIRE(!(tab2 != tab1));
   REQUIRE(tab2 == tab1);
 }  // TEST_CASE "equality test"
+
+TEST_CASE("training rules table", "[mccfr][sequence_table]") {
+  std::array<fishbait::AbstractAction, 4> actions = {{
+      {fishbait::Action::kFold},
+      {fishbait::Action::kAllIn},
+      {fishbait::Action::kCheckCall},
+      {fishbait::Action::kBet, 0.5, 1}
+  }};
+  fishbait::Node<3> start_state;
+  fishbait::Node<3, double, fishbait::TrainingRules> training_start_state;
+
+  fishbait::SequenceTable<3, 4> seq{actions, start_state};
+  fishbait::SequenceTable<3, 4, fishbait::TrainingRules> training_seq{
+      actions, training_start_state};
+  for (fishbait::RoundId i = 0; i < fishbait::kNRounds; ++i) {
+    fishbait::Round r = fishbait::Round{i};
+    REQUIRE(training_seq.States(r) == seq.States(r));
+    REQUIRE(training_seq.ActionCount(r) == seq.ActionCount(r));
+    REQUIRE(training_seq.NumLegalActions(r) == seq.NumLegalActions(r));
+    for (fishbait::SequenceId s = 0; s < seq.States(r); ++s) {
+      for (std::size_t a = 0; a < seq.ActionCount(r); ++a) {
+        REQUIRE(training_seq.Next(r, s, a) == seq.Next(r, s, a));
+      }
+    }
+  }
+}  // TEST_CASE "training rules table"
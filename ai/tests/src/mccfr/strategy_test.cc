@@ -4122,6 +4122,53 @@ TEST_CASE("mccfr test helper", "[mccfr][strategy]") {
   start_state.SetSeed(fishbait::Random::Seed{});
 }  // TEST_CASE "mccfr test helper"
 
+TEST_CASE("deal up front test", "[mccfr][strategy]") {
+  constexpr fishbait::PlayerN kPlayers = 3;
+  constexpr int kActions = 5;
+
+  fishbait::Node<kPlayers> start_state;
+  start_state.SetSeed(fishbait::Random::Seed(7));
+  std::array<fishbait::AbstractAction, kActions> actions = {{
+      {fishbait::Action::kFold},
+      {fishbait::Action::kAllIn},
+      {fishbait::Action::kCheckCall},
+
+      {fishbait::Action::kBet, 2.0, 1, fishbait::Round::kTurn,
+       fishbait::Round::kTurn, 2, 0},
+      {fishbait::Action::kBet, 0.25, 1, fishbait::Round::kFlop,
+       fishbait::Round::kRiver, 0, 10000}
+  }};
+  fishbait::TestClusters info_abstraction;
+  int prune_constant = 0;
+  int regret_floor = -10000;
+  fishbait::Strategy s(start_state, actions, info_abstraction,
+                       prune_constant, regret_floor);
+  s.SetSeed(fishbait::Random::Seed{68});
+
+  for (int i = 0; i < 1000; ++i) {
+    for (fishbait::PlayerId p = 0; p < kPlayers; ++p) {
+      s.UpdateStrategy(p);
+      s.TraverseMCCFR(p, i % 2 == 1, true);
+    }
+  }
+
+  // Every round is reached and no regret goes below the floor
+  for (fishbait::RoundId r = 0; r < fishbait::kNRounds; ++r) {
+    const auto& round_regrets = s.regrets()[r];
+    bool updated = false;
+    for (nda::index_t c = 0; c < round_regrets.rows(); ++c) {
+      for (nda::index_t j = 0; j < round_regrets.columns(); ++j) {
+        REQUIRE(round_regrets(c, j) >= regret_floor);
+        updated = updated || round_regrets(c, j) != 0;
+      }
+    }
+    REQUIRE(updated);
+  }
+
+  // The deal up front is not left on the start state
+  REQUIRE(s.action_abstraction().start_state() == start_state);
+}  // TEST_CASE "deal up front test"
+
 TEST_CASE("sample action test", "[mccfr][strategy]") {
   constexpr fishbait::PlayerN kPlayers = 3;
   constexpr int kActions = 5;
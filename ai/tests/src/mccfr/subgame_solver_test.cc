@@ -0,0 +1,295 @@
+#include <array>
+#include <cstddef>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "clustering/definitions.h"
+#include "mccfr/definitions.h"
+#include "mccfr/sequence_table.h"
+#include "mccfr/subgame_solver.h"
+#include "poker/card_utils.h"
+#include "poker/definitions.h"
+#include "poker/node.h"
+#include "SKPokerEval/src/SevenEval.h"
+#include "utils/random.h"
+
+namespace {
+
+constexpr fishbait::PlayerN kPlayers = 2;
+constexpr std::size_t kActions = 3;
+constexpr fishbait::Regret kRegretFloor = -310000000;
+
+const std::array<fishbait::AbstractAction, kActions> kTestActions = {{
+    {fishbait::Action::kFold},
+    {fishbait::Action::kCheckCall},
+    {fishbait::Action::kAllIn}
+}};
+
+/* A blueprint over a sequence table of kTestActions, with the given policy and
+   card clusters. */
+template <typename PolicyFn, typename ClusterFn>
+class TestBlueprint {
+ public:
+  using PolicyArr = std::array<float, kActions>;
+
+  TestBlueprint(fishbait::CardCluster n_clusters, PolicyFn policy_fn,
+                ClusterFn cluster_fn)
+      : table_{kTestActions, fishbait::Node<kPlayers>{}},
+        n_clusters_{n_clusters}, policy_fn_{policy_fn},
+        cluster_fn_{cluster_fn} {}
+
+  std::array<fishbait::AbstractAction, kActions> Actions(
+      fishbait::Round round) const {
+    std::array<fishbait::AbstractAction, kActions> actions;
+    for (std::size_t i = 0; i < kActions; ++i) {
+      actions[i] = table_.Actions(round)(i);
+    }
+    return actions;
+  }
+  std::size_t ActionCount(fishbait::Round round) const {
+    return table_.ActionCount(round);
+  }
+  fishbait::SequenceId Next(fishbait::Round round, fishbait::SequenceId seq,
+                            std::size_t action_idx) const {
+    return table_.Next(round, seq, action_idx);
+  }
+  PolicyArr Policy(fishbait::Round round, fishbait::CardCluster cluster,
+                   fishbait::SequenceId seq) const {
+    return policy_fn_(round, cluster, seq);
+  }
+  fishbait::CardCluster NumClusters(fishbait::Round) const {
+    return n_clusters_;
+  }
+  fishbait::CardCluster Cluster(
+      fishbait::Round round,
+      const fishbait::PublicHand<fishbait::ISO_Card>& cards) const {
+    return cluster_fn_(round, cards);
+  }
+
+ private:
+  fishbait::SequenceTable<kPlayers, kActions> table_;
+  fishbait::CardCluster n_clusters_;
+  PolicyFn policy_fn_;
+  ClusterFn cluster_fn_;
+};  // class TestBlueprint
+
+template <typename PolicyFn, typename ClusterFn>
+TestBlueprint<PolicyFn, ClusterFn> MakeBlueprint(
+    fishbait::CardCluster n_clusters, PolicyFn policy_fn,
+    ClusterFn cluster_fn) {
+  return {n_clusters, policy_fn, cluster_fn};
+}
+
+/* A hand played along with its blueprint sequence and action history. */
+struct TestHand {
+  fishbait::Node<kPlayers> game;
+  fishbait::SequenceId seq = 0;
+  std::vector<fishbait::BlueprintAction> history;
+
+  /* @brief Plays the ith test action, proceeding play after the round. */
+  template <typename Blueprint>
+  void Play(const Blueprint& blueprint, std::size_t action_idx) {
+    fishbait::Round round = game.round();
+    history.push_back({game.acting_player(), round, seq, action_idx});
+    seq = blueprint.Next(round, seq, action_idx);
+    game.Apply(kTestActions[action_idx]);
+  }
+};
+
+/* @brief Starts a hand with the given board and plays to the river. */
+template <typename Blueprint>
+TestHand CheckToRiver(const Blueprint& blueprint,
+                      const fishbait::BoardArray<fishbait::ISO_Card>& board) {
+  TestHand hand;
+  hand.game.SetBoard(board);
+  hand.game.ProceedPlay();
+  hand.Play(blueprint, 1);
+  hand.Play(blueprint, 1);
+  while (hand.game.round() != fishbait::Round::kRiver) {
+    hand.game.ProceedPlay();
+    hand.Play(blueprint, 1);
+    hand.Play(blueprint, 1);
+  }
+  hand.game.ProceedPlay();
+  return hand;
+}
+
+}  // namespace
+
+TEST_CASE("subgame solver calls the nuts", "[mccfr][subgame_solver]") {
+  auto Card = fishbait::ISOCardFromStr;
+
+  /* Start from a blueprint which always folds */
+  auto blueprint = MakeBlueprint(1,
+      [](fishbait::Round, fishbait::CardCluster, fishbait::SequenceId) {
+        return std::array<float, kActions>{1, 0, 0};
+      },
+      [](fishbait::Round, const fishbait::PublicHand<fishbait::ISO_Card>&) {
+        return fishbait::CardCluster{0};
+      });
+  TestHand hand = CheckToRiver(blueprint, {Card("Qs"), Card("Js"), Card("Ts"),
+                                           Card("2d"), Card("7c")});
+  hand.Play(blueprint, 2);
+  fishbait::PlayerId hero = hand.game.acting_player();
+  hand.game.SetHand(hero, {Card("As"), Card("Ks")});
+
+  fishbait::SubgameSolver<kPlayers, kActions, decltype(blueprint)> solver(
+      hand.game, hero, blueprint, hand.seq, kRegretFloor);
+  solver.SetSeed(fishbait::Random::Seed{7});
+  REQUIRE(solver.HeroCluster() == 0);
+
+  solver.Seed(hand.game.pot());
+  std::array policy = solver.SolveIterations(500);
+  REQUIRE(std::accumulate(policy.begin(), policy.end(), 0.0) ==
+          Approx(1.0));
+  REQUIRE(policy[0] < 0.1);
+  REQUIRE(policy[1] == 0);
+  REQUIRE(policy[2] > 0.9);
+}  // TEST_CASE "subgame solver calls the nuts"
+
+TEST_CASE("subgame solver weights ranges by the blueprint",
+          "[mccfr][subgame_solver]") {
+  auto Card = fishbait::ISOCardFromStr;
+  fishbait::BoardArray<fishbait::ISO_Card> board = {
+      Card("Qs"), Card("Js"), Card("Ts"), Card("2d"), Card("7c")};
+  fishbait::Hand<fishbait::ISO_Card> hero_hand = {Card("Qh"), Card("3c")};
+  auto Rank = [](const fishbait::PublicHand<fishbait::ISO_Card>& cards) {
+    std::array<fishbait::SK_Card, fishbait::kPlayerCards> sk;
+    for (std::size_t i = 0; i < sk.size(); ++i) {
+      sk[i] = fishbait::ConvertISOtoSK(cards[i]);
+    }
+    return SevenEval::GetRank(sk[0], sk[1], sk[2], sk[3], sk[4], sk[5], sk[6]);
+  };
+  fishbait::PublicHand<fishbait::ISO_Card> hero_cards = {
+      hero_hand[0], hero_hand[1], board[0], board[1], board[2], board[3],
+      board[4]};
+  const SevenEval::Rank hero_rank = Rank(hero_cards);
+
+  /* On the river, hands which beat top pair are in cluster 1 and always go all
+     in, and the rest are in cluster 0 and rarely do. */
+  auto blueprint = MakeBlueprint(2,
+      [](fishbait::Round round, fishbait::CardCluster cluster,
+         fishbait::SequenceId) {
+        if (round != fishbait::Round::kRiver) {
+          return std::array<float, kActions>{0, 0.5, 0.5};
+        } else if (cluster == 1) {
+          return std::array<float, kActions>{0, 0, 1};
+        }
+        return std::array<float, kActions>{0, 0.98, 0.02};
+      },
+      [&](fishbait::Round round,
+          const fishbait::PublicHand<fishbait::ISO_Card>& cards) {
+        bool beats_hero = round == fishbait::Round::kRiver &&
+                          Rank(cards) > hero_rank;
+        return fishbait::CardCluster{beats_hero ? 1u : 0u};
+      });
+  TestHand hand = CheckToRiver(blueprint, board);
+  hand.Play(blueprint, 2);
+  fishbait::PlayerId hero = hand.game.acting_player();
+  hand.game.SetHand(hero, hero_hand);
+
+  using SolverT = fishbait::SubgameSolver<kPlayers, kActions,
+                                          decltype(blueprint)>;
+  SolverT uniform(hand.game, hero, blueprint, hand.seq, kRegretFloor);
+  uniform.SetSeed(fishbait::Random::Seed{7});
+  std::array uniform_policy = uniform.SolveIterations(200);
+
+  SolverT weighted(hand.game, hero, blueprint, hand.seq, kRegretFloor);
+  weighted.SetSeed(fishbait::Random::Seed{7});
+  weighted.WeightRanges(hand.history);
+  std::array weighted_policy = weighted.SolveIterations(200);
+
+  /* Top pair is ahead of a random hand, but behind a range which shoves the
+     river. */
+  REQUIRE(uniform_policy[0] < 0.1);
+  REQUIRE(uniform_policy[2] > 0.9);
+  REQUIRE(weighted_policy[0] > 0.9);
+  REQUIRE(weighted_policy[2] < 0.1);
+}  // TEST_CASE "subgame solver weights ranges by the blueprint"
+
+TEST_CASE("subgame solver values leaves with blueprint rollouts",
+          "[mccfr][subgame_solver]") {
+  auto Card = fishbait::ISOCardFromStr;
+
+  /* The blueprint checks down to the river, where the first player to act goes
+     all in and the other player folds. */
+  TestHand hand;
+  fishbait::SequenceId river_seq = fishbait::kIllegalId;
+  auto blueprint = MakeBlueprint(1,
+      [&](fishbait::Round round, fishbait::CardCluster,
+          fishbait::SequenceId seq) {
+        if (round != fishbait::Round::kRiver) {
+          return std::array<float, kActions>{0, 1, 0};
+        } else if (seq == river_seq) {
+          return std::array<float, kActions>{0, 0, 1};
+        }
+        return std::array<float, kActions>{1, 0, 0};
+      },
+      [](fishbait::Round, const fishbait::PublicHand<fishbait::ISO_Card>&) {
+        return fishbait::CardCluster{0};
+      });
+  hand.game.SetBoard({Card("Qs"), Card("Js"), Card("Ts"), Card("2d"),
+                      Card("7c")});
+  hand.game.ProceedPlay();
+  hand.Play(blueprint, 1);
+  hand.Play(blueprint, 1);
+  while (hand.game.round() != fishbait::Round::kTurn) {
+    hand.game.ProceedPlay();
+    hand.Play(blueprint, 1);
+    hand.Play(blueprint, 1);
+  }
+  hand.game.ProceedPlay();
+  fishbait::PlayerId first = hand.game.acting_player();
+  fishbait::PlayerId second = (first + 1) % kPlayers;
+  hand.game.SetHand(first, {Card("3h"), Card("4h")});
+  hand.game.SetHand(second, {Card("Ah"), Card("Kh")});
+  fishbait::SubgameSolver<kPlayers, kActions, decltype(blueprint)> solver(
+      hand.game, first, blueprint, hand.seq, kRegretFloor);
+
+  /* Both players check the turn, so the first player wins the pot on the
+     river rather than losing it at showdown. */
+  TestHand leaf = hand;
+  leaf.Play(blueprint, 1);
+  leaf.Play(blueprint, 1);
+  river_seq = leaf.seq;
+  fishbait::Node<kPlayers> rollout = leaf.game;
+  rollout.ProceedPlay();
+  rollout.Apply(fishbait::Action::kAllIn);
+  rollout.Apply(fishbait::Action::kFold);
+  rollout.AwardPot(rollout.single_run_);
+  fishbait::Node<kPlayers> showdown = leaf.game;
+  while (showdown.in_progress()) {
+    if (showdown.acting_player() == showdown.kChancePlayer) {
+      showdown.ProceedPlay();
+    } else {
+      showdown.Apply(fishbait::Action::kCheckCall);
+    }
+  }
+  showdown.AwardPot(showdown.single_run_);
+  REQUIRE(rollout.stack(first) > showdown.stack(first));
+
+  for (fishbait::PlayerId player : {first, second}) {
+    REQUIRE(solver.LeafValue(leaf.game, player, leaf.seq) ==
+            rollout.stack(player));
+    REQUIRE(solver.LeafValue(leaf.game, player, fishbait::kIllegalId) ==
+            showdown.stack(player));
+  }
+}  // TEST_CASE "subgame solver values leaves with blueprint rollouts"
+
+TEST_CASE("subgame solver requires postflop", "[mccfr][subgame_solver]") {
+  auto blueprint = MakeBlueprint(1,
+      [](fishbait::Round, fishbait::CardCluster, fishbait::SequenceId) {
+        return std::array<float, kActions>{0, 1, 0};
+      },
+      [](fishbait::Round, const fishbait::PublicHand<fishbait::ISO_Card>&) {
+        return fishbait::CardCluster{0};
+      });
+  fishbait::Node<kPlayers> game;
+  game.ProceedPlay();
+  using SolverT = fishbait::SubgameSolver<kPlayers, kActions,
+                                          decltype(blueprint)>;
+  REQUIRE_THROWS(SolverT(game, game.acting_player(), blueprint, 0,
+                         kRegretFloor));
+}  // TEST_CASE "subgame solver requires postflop"
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "poker/batch_evaluator.h"
+#include "poker/definitions.h"
+#include "SKPokerEval/src/SevenEval.h"
+#include "utils/random.h"
+#include "utils/timer.h"
+
+TEST_CASE("batch rank every hand", "[poker][batch_evaluator]") {
+  const fishbait::BatchEvaluator& evaluator =
+      fishbait::BatchEvaluator::Shared();
+
+  /* Every set of 7 cards is ranked once, as the hole cards below the board
+     made of its 5 highest cards. */
+  std::vector<fishbait::Hand<fishbait::SK_Card>> hands;
+  std::vector<fishbait::PublicHand<fishbait::SK_Card>> full_hands;
+  std::vector<SevenEval::Rank> ranks;
+  std::vector<SevenEval::Rank> full_ranks;
+  std::size_t checked = 0;
+  fishbait::BoardArray<fishbait::SK_Card> b;
+  for (b[0] = 2; b[0] < fishbait::kDeckSize; ++b[0]) {
+    for (b[1] = b[0] + 1; b[1] < fishbait::kDeckSize; ++b[1]) {
+      for (b[2] = b[1] + 1; b[2] < fishbait::kDeckSize; ++b[2]) {
+        for (b[3] = b[2] + 1; b[3] < fishbait::kDeckSize; ++b[3]) {
+          for (b[4] = b[3] + 1; b[4] < fishbait::kDeckSize; ++b[4]) {
+            hands.clear();
+            full_hands.clear();
+            for (fishbait::SK_Card c0 = 0; c0 < b[0]; ++c0) {
+              for (fishbait::SK_Card c1 = c0 + 1; c1 < b[0]; ++c1) {
+                hands.push_back({c0, c1});
+                full_hands.push_back({c0, c1, b[0], b[1], b[2], b[3], b[4]});
+              }
+            }
+            ranks.resize(hands.size());
+            full_ranks.resize(hands.size());
+            evaluator.RankHands(b, hands.data(), hands.size(), ranks.data());
+            evaluator.RankHands(full_hands.data(), full_hands.size(),
+                                full_ranks.data());
+            for (std::size_t i = 0; i < hands.size(); ++i) {
+              const SevenEval::Rank rank = SevenEval::GetRank(
+                  hands[i][0], hands[i][1], b[0], b[1], b[2], b[3], b[4]);
+              if (ranks[i] != rank || full_ranks[i] != rank) {
+                REQUIRE(ranks[i] == rank);
+                REQUIRE(full_ranks[i] == rank);
+              }
+            }
+            checked += hands.size();
+          }
+        }
+      }
+    }
+  }
+  REQUIRE(checked == 133784560);
+}  // TEST_CASE "batch rank every hand"
+
+TEST_CASE("batch rank benchmark", "[.][poker][batch_evaluator][benchmark]") {
+  constexpr std::size_t kBoards = 10000;
+  fishbait::Random rng(fishbait::Random::Seed(4567));
+  std::array<fishbait::SK_Card, fishbait::kDeckSize> deck;
+  std::iota(deck.begin(), deck.end(), 0);
+
+  // Every pair of hole cards which can be dealt with each random board
+  std::vector<fishbait::BoardArray<fishbait::SK_Card>> boards(kBoards);
+  std::vector<std::vector<fishbait::Hand<fishbait::SK_Card>>> hands(kBoards);
+  for (std::size_t b = 0; b < kBoards; ++b) {
+    std::shuffle(deck.begin(), deck.end(), rng());
+    std::copy_n(deck.begin(), fishbait::kBoardCards, boards[b].begin());
+    for (std::size_t c0 = fishbait::kBoardCards; c0 < deck.size(); ++c0) {
+      for (std::size_t c1 = c0 + 1; c1 < deck.size(); ++c1) {
+        hands[b].push_back({deck[c0], deck[c1]});
+      }
+    }
+  }
+  std::vector<SevenEval::Rank> ranks(hands[0].size());
+  const fishbait::BatchEvaluator& evaluator =
+      fishbait::BatchEvaluator::Shared();
+
+  SevenEval::Rank sum = 0;
+  fishbait::Timer timer;
+  for (std::size_t b = 0; b < kBoards; ++b) {
+    const fishbait::BoardArray<fishbait::SK_Card>& board = boards[b];
+    for (std::size_t i = 0; i < hands[b].size(); ++i) {
+      ranks[i] = SevenEval::GetRank(hands[b][i][0], hands[b][i][1], board[0],
+                                    board[1], board[2], board[3], board[4]);
+    }
+    sum += ranks[b % ranks.size()];
+  }
+  std::cout << "SevenEval::GetRank: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+
+  for (std::size_t b = 0; b < kBoards; ++b) {
+    evaluator.RankHands(boards[b], hands[b].data(), hands[b].size(),
+                        ranks.data());
+    sum += ranks[b % ranks.size()];
+  }
+  std::cout << "BatchEvaluator::RankHands: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+  REQUIRE(sum != 0);
+}  // TEST_CASE "batch rank benchmark"
@@ -1,11 +1,18 @@
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <iostream>
+#include <numeric>
 #include <set>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "catch2/catch.hpp"
 #include "hand_strengths/ochs.h"
 #include "poker/definitions.h"
 #include "poker/indexer.h"
+#include "utils/random.h"
+#include "utils/timer.h"
 
 TEST_CASE("Basic preflop indexer tests", "[poker][indexer]") {
   const hand_index_t n_hands =
@@ -136,3 +143,107 @@ TEST_CASE("Basic river indexer tests", "[.][poker][indexer]") {
   REQUIRE(i == n_rivers);  // number of flops
   REQUIRE(indicies_set.size() == n_rivers);
 }  // TEST_CASE "Basic river indexer tests"
+
+TEST_CASE("Resumed indexing matches full indexing", "[poker][indexer]") {
+  constexpr int kTrials = 10000;
+  fishbait::Indexer<2, 5> river;
+  fishbait::Random rng(fishbait::Random::Seed(4567));
+  std::array<fishbait::ISO_Card, fishbait::kDeckSize> deck;
+  std::iota(deck.begin(), deck.end(), 0);
+  std::array<fishbait::ISO_Card, 7> rollout;
+
+  for (int i = 0; i < kTrials; ++i) {
+    std::shuffle(deck.begin(), deck.end(), rng());
+    std::copy_n(deck.begin(), rollout.size(), rollout.begin());
+    std::array<hand_index_t, 2> indicies = river.Index(rollout);
+
+    fishbait::Indexer<2, 5>::State state = river.NewState();
+    REQUIRE(river.IndexNextRound(rollout.data(), &state) == indicies[0]);
+    fishbait::Indexer<2, 5>::State copy = state;
+    REQUIRE(river.IndexNextRound(rollout.data() + 2, &state) == indicies[1]);
+    REQUIRE(river.IndexNextRound(rollout.data() + 2, &copy) == indicies[1]);
+  }
+}  // TEST_CASE "Resumed indexing matches full indexing"
+
+TEST_CASE("Shared indexers", "[poker][indexer]") {
+  constexpr int kThreads = 4;
+  constexpr int kTrials = 10000;
+  const fishbait::Indexer<2, 5>& shared = fishbait::Indexer<2, 5>::Shared();
+  REQUIRE(&shared == &fishbait::Indexer<2, 5>::Shared());
+  REQUIRE(static_cast<const void*>(&fishbait::Indexer<2, 4>::Shared()) !=
+          static_cast<const void*>(&shared));
+
+  // Every thread indexes with the shared indexer at once
+  fishbait::Indexer<2, 5> river;
+  std::array<std::vector<std::array<fishbait::ISO_Card, 7>>, kThreads>
+      rollouts;
+  std::array<std::vector<hand_index_t>, kThreads> indices;
+  fishbait::Random rng(fishbait::Random::Seed(4567));
+  std::array<fishbait::ISO_Card, fishbait::kDeckSize> deck;
+  std::iota(deck.begin(), deck.end(), 0);
+  for (int t = 0; t < kThreads; ++t) {
+    for (int i = 0; i < kTrials; ++i) {
+      std::shuffle(deck.begin(), deck.end(), rng());
+      rollouts[t].emplace_back();
+      std::copy_n(deck.begin(), 7, rollouts[t].back().begin());
+    }
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (const std::array<fishbait::ISO_Card, 7>& rollout : rollouts[t]) {
+        indices[t].push_back(
+            fishbait::Indexer<2, 5>::Shared().IndexLast(rollout));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (int t = 0; t < kThreads; ++t) {
+    for (int i = 0; i < kTrials; ++i) {
+      REQUIRE(indices[t][i] == river.IndexLast(rollouts[t][i]));
+    }
+  }
+}  // TEST_CASE "Shared indexers"
+
+TEST_CASE("Resumed indexing benchmark", "[.][poker][indexer][benchmark]") {
+  constexpr int kHoleHands = 20;
+  constexpr int kBoards = 100000;
+  fishbait::Indexer<2, 5> river;
+  fishbait::Random rng(fishbait::Random::Seed(4567));
+  std::array<fishbait::ISO_Card, fishbait::kDeckSize> deck;
+  std::iota(deck.begin(), deck.end(), 0);
+
+  // Draw every rollout up front so that only indexing is timed
+  std::vector<std::array<fishbait::ISO_Card, 7>> rollouts;
+  for (int h = 0; h < kHoleHands; ++h) {
+    std::shuffle(deck.begin(), deck.end(), rng());
+    for (int b = 0; b < kBoards; ++b) {
+      std::shuffle(deck.begin() + 2, deck.end(), rng());
+      rollouts.emplace_back();
+      std::copy_n(deck.begin(), 7, rollouts.back().begin());
+    }
+  }
+
+  fishbait::Timer timer;
+  hand_index_t full_sum = 0;
+  for (const std::array<fishbait::ISO_Card, 7>& rollout : rollouts) {
+    full_sum += river.Index(rollout)[1];
+  }
+  double full_time = timer.Reset<fishbait::Timer::Seconds>();
+  std::cout << "full indexing: " << rollouts.size() / full_time
+            << " indexes/s" << std::endl;
+
+  hand_index_t resumed_sum = 0;
+  for (std::size_t i = 0; i < rollouts.size(); i += kBoards) {
+    fishbait::Indexer<2, 5>::State hole_state = river.NewState();
+    river.IndexNextRound(rollouts[i].data(), &hole_state);
+    for (std::size_t j = i; j < i + kBoards; ++j) {
+      fishbait::Indexer<2, 5>::State state = hole_state;
+      resumed_sum += river.IndexNextRound(rollouts[j].data() + 2, &state);
+    }
+  }
+  double resumed_time = timer.Reset<fishbait::Timer::Seconds>();
+  std::cout << "resumed indexing: " << rollouts.size() / resumed_time
+            << " indexes/s" << std::endl;
+  REQUIRE(full_sum == resumed_sum);
+}  // TEST_CASE "Resumed indexing benchmark"
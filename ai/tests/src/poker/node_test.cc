@@ -1,9 +1,20 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
 #include "catch2/catch.hpp"
 #include "poker/card_utils.h"
 #include "poker/definitions.h"
 #include "poker/node.h"
 #include "utils/array.h"
 #include "utils/fraction.h"
+#include "utils/random.h"
+#include "utils/timer.h"
 
 TEST_CASE("Triton cash game first 3 hands", "[poker][node]") {
   /* 
@@ -2927,3 +2938,425 @@ TEST_CASE("copy with stack test", "[poker][node]") {
   REQUIRE(game_cp2.stack(1) == 19950);
   REQUIRE(game_cp2.stack(2) == 19900);
 }  // TEST_CASE "copy with stack test"
+
+TEST_CASE("training rules node", "[poker][node]") {
+  using TrainingNode = fishbait::Node<3, double, fishbait::TrainingRules>;
+  STATIC_REQUIRE(sizeof(TrainingNode) < sizeof(fishbait::Node<3, double>));
+  REQUIRE_THROWS_AS(TrainingNode(10000, 0, 100, 50, 10),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(TrainingNode(10000, 0, 100, 50, 0, false, true, 0.05),
+                    std::invalid_argument);
+
+  TrainingNode game;
+  fishbait::Node<3, double> full_game;
+  REQUIRE(game.ante() == 0);
+  REQUIRE(game.big_blind_ante() == false);
+  REQUIRE(game.blind_before_ante() == true);
+
+  auto Card = fishbait::ISOCardFromStr;
+  fishbait::HandArray<fishbait::ISO_Card, 3> hands = {{
+      {Card("As"), Card("Ah")}, {Card("Kc"), Card("Kd")},
+      {Card("7s"), Card("2d")}
+  }};
+  fishbait::BoardArray<fishbait::ISO_Card> board = {
+      Card("3c"), Card("8h"), Card("9d"), Card("Js"), Card("4h")
+  };
+  game.SetHands(hands);
+  game.SetBoard(board);
+  full_game.SetHands(hands);
+  full_game.SetBoard(board);
+
+  /* Play the same hand on both nodes and check that they agree at every
+     step. */
+  auto play = [&](fishbait::Action play, fishbait::Chips size = 0) {
+    REQUIRE(game.Apply(play, size) == full_game.Apply(play, size));
+    REQUIRE(game.pot() == full_game.pot());
+    REQUIRE(game.round() == full_game.round());
+    REQUIRE(game.acting_player() == full_game.acting_player());
+  };
+  game.ProceedPlay();
+  full_game.ProceedPlay();
+  play(fishbait::Action::kBet, 300);
+  play(fishbait::Action::kCheckCall);
+  play(fishbait::Action::kFold);
+  while (game.in_progress()) {
+    game.ProceedPlay();
+    full_game.ProceedPlay();
+    play(fishbait::Action::kCheckCall);
+    play(fishbait::Action::kCheckCall);
+  }
+  game.AwardPot(game.same_stack_no_rake_);
+  full_game.AwardPot(full_game.same_stack_no_rake_);
+  for (fishbait::PlayerId i = 0; i < 3; ++i) {
+    REQUIRE(game.stack(i) == full_game.stack(i));
+  }
+  REQUIRE(game.stack(0) == 10400);
+
+  // Converting between rules
+  fishbait::Node<3, double> converted{game};
+  REQUIRE(converted == full_game);
+  REQUIRE(TrainingNode{converted} == game);
+  fishbait::Node<3, double> with_ante(10000, 0, 100, 50, 10);
+  REQUIRE_THROWS_AS(TrainingNode{with_ante}, std::invalid_argument);
+}  // TEST_CASE "training rules node"
+
+TEST_CASE("apply undo", "[poker][node]") {
+  fishbait::Node<3> game({10000, 5000, 20000}, 0, 100, 50, 10);
+  game.SetSeed(fishbait::Random::Seed{7});
+  game.Deal();
+  game.ProceedPlay();
+
+  std::vector<fishbait::Node<3>> history;
+  std::vector<fishbait::Node<3>::UndoRecord> undos;
+  auto apply = [&](fishbait::Action play, fishbait::Chips size = 0) {
+    history.push_back(game);
+    undos.emplace_back();
+    game.Apply(play, size, &undos.back());
+  };
+  apply(fishbait::Action::kBet, 300);
+  apply(fishbait::Action::kFold);
+  apply(fishbait::Action::kCheckCall);
+
+  // Flop
+  fishbait::Node<3>::DealRecord deal;
+  fishbait::Node<3> before_deal = game;
+  game.Deal(&deal);
+  REQUIRE(game != before_deal);
+  game.ProceedPlay();
+  apply(fishbait::Action::kBet, 500);
+  apply(fishbait::Action::kAllIn);
+  apply(fishbait::Action::kAllIn);
+  REQUIRE(game.players_all_in() == 2);
+
+  while (!undos.empty()) {
+    if (history.size() == 3) game.Undo(deal);
+    game.Undo(undos.back());
+    REQUIRE(game == history.back());
+    undos.pop_back();
+    history.pop_back();
+  }
+  REQUIRE(game.acting_player() == 0);
+  REQUIRE(game.pot() == 180);
+}  // TEST_CASE "apply undo"
+
+namespace {
+
+constexpr fishbait::PlayerN kBenchmarkPlayers = 3;
+using BenchmarkNode = fishbait::Node<kBenchmarkPlayers>;
+const std::array<fishbait::AbstractAction, 4> kBenchmarkActions = {{
+    {fishbait::Action::kFold},
+    {fishbait::Action::kCheckCall},
+    {fishbait::Action::kBet, 1.0, 3},
+    {fishbait::Action::kAllIn}
+}};
+
+/* Returns the number of chips to Apply() for the given action, or 0 if it is
+   illegal. */
+fishbait::Chips BenchmarkActionSize(const BenchmarkNode& state,
+                                    const fishbait::AbstractAction& action,
+                                    int raises) {
+  switch (action.play) {
+    case fishbait::Action::kFold:
+      return state.CanFold();
+    case fishbait::Action::kCheckCall:
+      return state.CanCheckCall();
+    case fishbait::Action::kAllIn:
+      return true;
+    case fishbait::Action::kBet:
+      if (raises >= action.max_raise_num) return 0;
+      fishbait::Chips size = state.ProportionToChips(action.size);
+      return state.CanBet(size) ? size : 0;
+  }
+  return 0;
+}
+
+/* Visits every node of the abstract game tree like SequenceTable::Generate(),
+   either copying the node or undoing each move. Returns the number of
+   leaves. */
+template <bool kUndo>
+long BenchmarkGenerate(BenchmarkNode& state, int raises) {
+  if (!state.in_progress()) {
+    return 1;
+  } else if (state.acting_player() == state.kChancePlayer) {
+    state.ProceedPlay();
+    return BenchmarkGenerate<kUndo>(state, 0);
+  }
+  long leaves = 0;
+  for (const fishbait::AbstractAction& action : kBenchmarkActions) {
+    fishbait::Chips size = BenchmarkActionSize(state, action, raises);
+    if (!size) continue;
+    int new_raises = raises + (action.play == fishbait::Action::kBet);
+    if constexpr (kUndo) {
+      BenchmarkNode::UndoRecord undo;
+      state.Apply(action.play, size, &undo);
+      leaves += BenchmarkGenerate<kUndo>(state, new_raises);
+      state.Undo(undo);
+    } else {
+      BenchmarkNode new_state = state;
+      new_state.Apply(action.play, size);
+      leaves += BenchmarkGenerate<kUndo>(new_state, new_raises);
+    }
+  }
+  return leaves;
+}
+
+/* Walks the abstract game tree like Strategy::TraverseMCCFR(), exploring every
+   action of the given player and sampling one action of the other players,
+   either copying the node or undoing each move. Returns the sum of the given
+   player's chips at the explored leaves. */
+template <bool kUndo>
+double BenchmarkTraverse(BenchmarkNode& state, fishbait::PlayerId player,
+                         int raises, fishbait::Random& rng) {
+  if (!state.in_progress()) {
+    BenchmarkNode terminal_state = state;
+    terminal_state.AwardPot(terminal_state.same_stack_no_rake_);
+    return terminal_state.stack(player);
+  } else if (state.folded(player)) {
+    return state.stack(player);
+  } else if (state.acting_player() == state.kChancePlayer) {
+    BenchmarkNode::DealRecord deal;
+    state.Deal(kUndo ? &deal : nullptr);
+    state.ProceedPlay();
+    double value = BenchmarkTraverse<kUndo>(state, player, 0, rng);
+    if constexpr (kUndo) state.Undo(deal);
+    return value;
+  }
+
+  std::array<fishbait::Chips, kBenchmarkActions.size()> sizes;
+  std::size_t n_legal = 0;
+  for (std::size_t i = 0; i < kBenchmarkActions.size(); ++i) {
+    sizes[i] = BenchmarkActionSize(state, kBenchmarkActions[i], raises);
+    n_legal += sizes[i] > 0;
+  }
+  std::uniform_int_distribution<std::size_t> sampler(0, n_legal - 1);
+  std::size_t sampled = state.acting_player() == player ? n_legal
+                                                        : sampler(rng());
+  double value = 0;
+  std::size_t legal_i = 0;
+  for (std::size_t i = 0; i < kBenchmarkActions.size(); ++i) {
+    if (!sizes[i]) continue;
+    if (sampled == n_legal || sampled == legal_i) {
+      fishbait::Action play = kBenchmarkActions[i].play;
+      int new_raises = raises + (play == fishbait::Action::kBet);
+      if constexpr (kUndo) {
+        BenchmarkNode::UndoRecord undo;
+        state.Apply(play, sizes[i], &undo);
+        value += BenchmarkTraverse<kUndo>(state, player, new_raises, rng);
+        state.Undo(undo);
+      } else {
+        BenchmarkNode new_state = state;
+        new_state.Apply(play, sizes[i]);
+        value += BenchmarkTraverse<kUndo>(new_state, player, new_raises, rng);
+      }
+    }
+    ++legal_i;
+  }
+  return value;
+}
+
+}  // namespace
+
+TEST_CASE("copy vs undo benchmark", "[.][poker][node][benchmark]") {
+  constexpr int kGenerateTrials = 20;
+  constexpr int kTraverseTrials = 20000;
+  BenchmarkNode start_state;
+
+  fishbait::Timer timer;
+  long copy_leaves = 0;
+  for (int i = 0; i < kGenerateTrials; ++i) {
+    BenchmarkNode state = start_state;
+    copy_leaves += BenchmarkGenerate<false>(state, 0);
+  }
+  std::cout << "generate with copies: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+  long undo_leaves = 0;
+  for (int i = 0; i < kGenerateTrials; ++i) {
+    BenchmarkNode state = start_state;
+    undo_leaves += BenchmarkGenerate<true>(state, 0);
+  }
+  std::cout << "generate with undo: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+  REQUIRE(copy_leaves == undo_leaves);
+
+  /* Both traversals use the same seeds, so they must deal the same cards and
+     sample the same actions. */
+  fishbait::Random copy_rng{fishbait::Random::Seed{7}};
+  BenchmarkNode::SetSeed(fishbait::Random::Seed{8});
+  double copy_value = 0;
+  timer.Reset();
+  for (int i = 0; i < kTraverseTrials; ++i) {
+    BenchmarkNode state = start_state;
+    copy_value += BenchmarkTraverse<false>(state, i % kBenchmarkPlayers, 0,
+                                           copy_rng);
+  }
+  std::cout << "traverse with copies: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+  fishbait::Random undo_rng{fishbait::Random::Seed{7}};
+  BenchmarkNode::SetSeed(fishbait::Random::Seed{8});
+  double undo_value = 0;
+  for (int i = 0; i < kTraverseTrials; ++i) {
+    BenchmarkNode state = start_state;
+    undo_value += BenchmarkTraverse<true>(state, i % kBenchmarkPlayers, 0,
+                                          undo_rng);
+  }
+  std::cout << "traverse with undo: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+  REQUIRE(copy_value == undo_value);
+}  // TEST_CASE "copy vs undo benchmark"
+
+TEST_CASE("dealt river ranks match manual ranks", "[poker][node]") {
+  constexpr fishbait::PlayerN kPlayers = 6;
+  fishbait::Node<kPlayers> game;
+  game.SetSeed(fishbait::Random::Seed{11});
+  for (int trial = 0; trial < 1000; ++trial) {
+    while (game.in_progress()) {
+      if (game.acting_player() == game.kChancePlayer) {
+        game.Deal();
+        game.ProceedPlay();
+      } else if (game.round() == fishbait::Round::kPreFlop &&
+                 game.acting_player() == 0) {
+        game.Apply(fishbait::Action::kBet, 1000);
+      } else if ((trial + game.acting_player()) % 4 == 0 && game.CanFold()) {
+        game.Apply(fishbait::Action::kFold);
+      } else {
+        game.Apply(fishbait::Action::kCheckCall);
+      }
+    }
+
+    /* Setting the same cards manually clears the ranks cached by Deal(), so
+       the copy ranks every hand again. */
+    fishbait::Node<kPlayers> manual = game;
+    fishbait::HandArray<fishbait::ISO_Card, kPlayers> hands;
+    for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+      std::array cards = game.PlayerCards(i);
+      hands[i] = {cards[0], cards[1]};
+      if (i == kPlayers - 1) {
+        manual.SetBoard({cards[2], cards[3], cards[4], cards[5], cards[6]});
+      }
+    }
+    manual.SetHands(hands);
+    game.AwardPot(game.single_run_);
+    manual.AwardPot(manual.single_run_);
+    for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+      REQUIRE(game.stack(i) == manual.stack(i));
+    }
+    game = fishbait::Node<kPlayers>{};
+  }
+}  // TEST_CASE "dealt river ranks match manual ranks"
+
+TEST_CASE("deal all cards test", "[poker][node]") {
+  constexpr fishbait::PlayerN kPlayers = 6;
+  fishbait::Node<kPlayers> game;
+  game.SetSeed(fishbait::Random::Seed{13});
+  for (int trial = 0; trial < 100; ++trial) {
+    game.DealAll();
+    REQUIRE_THROWS(game.Deal());
+    REQUIRE_THROWS(game.DealAll());
+
+    std::array<fishbait::PublicHand<fishbait::ISO_Card>, kPlayers> cards;
+    for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+      cards[i] = game.PlayerCards(i, fishbait::Round::kRiver);
+    }
+    for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+      for (std::size_t c = 0; c < fishbait::kPlayerCards; ++c) {
+        for (fishbait::PlayerId j = i; j < kPlayers; ++j) {
+          std::size_t first = j == i ? c + 1 : 0;
+          std::size_t last = j == i ? fishbait::kPlayerCards :
+                                      fishbait::kHandCards;
+          for (std::size_t d = first; d < last; ++d) {
+            REQUIRE(cards[i][c] != cards[j][d]);
+          }
+        }
+      }
+    }
+
+    // Later chance nodes keep the cards dealt up front
+    fishbait::Node<kPlayers> manual = game;
+    while (game.in_progress()) {
+      if (game.acting_player() == game.kChancePlayer) {
+        REQUIRE_THROWS(game.Deal());
+        game.ProceedPlay();
+        manual.ProceedPlay();
+        for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+          std::array player_cards = game.PlayerCards(i);
+          std::size_t n_cards = std::accumulate(
+              fishbait::kCardsPerRound.begin(),
+              std::next(fishbait::kCardsPerRound.begin(), +game.round() + 1),
+              std::size_t{0});
+          REQUIRE(std::equal(player_cards.begin(),
+                             std::next(player_cards.begin(), n_cards),
+                             cards[i].begin()));
+        }
+      } else if (game.acting_player() == (trial % kPlayers) &&
+                 game.CanFold()) {
+        game.Apply(fishbait::Action::kFold);
+        manual.Apply(fishbait::Action::kFold);
+      } else {
+        game.Apply(fishbait::Action::kCheckCall);
+        manual.Apply(fishbait::Action::kCheckCall);
+      }
+    }
+
+    // The cached ranks match ranking each hand at the showdown
+    fishbait::HandArray<fishbait::ISO_Card, kPlayers> hands;
+    for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+      hands[i] = {cards[i][0], cards[i][1]};
+    }
+    manual.SetHands(hands);
+    game.AwardPot(game.single_run_);
+    manual.AwardPot(manual.single_run_);
+    for (fishbait::PlayerId i = 0; i < kPlayers; ++i) {
+      REQUIRE(game.stack(i) == manual.stack(i));
+    }
+
+    // The next hand can be dealt without resetting the deck
+    game.NewHand();
+    REQUIRE_NOTHROW(game.Deal());
+    manual.NewHand();
+    REQUIRE_THROWS(manual.Deal());
+    game = fishbait::Node<kPlayers>{};
+  }
+
+  fishbait::Node<kPlayers> dealt;
+  dealt.Deal();
+  REQUIRE_THROWS(dealt.DealAll());
+  dealt.ProceedPlay();
+  REQUIRE_THROWS(dealt.DealAll());
+}  // TEST_CASE "deal all cards test"
+
+TEST_CASE("showdown benchmark", "[.][poker][node][benchmark]") {
+  constexpr fishbait::PlayerN kPlayers = 6;
+  constexpr int kShowdowns = 100000;
+  fishbait::Node<kPlayers> game;
+  game.SetSeed(fishbait::Random::Seed{11});
+  while (game.in_progress()) {
+    if (game.acting_player() == game.kChancePlayer) {
+      game.Deal();
+      game.ProceedPlay();
+    } else {
+      game.Apply(fishbait::Action::kCheckCall);
+    }
+  }
+  fishbait::Node<kPlayers> uncached = game;
+  uncached.SetHand(0, {uncached.PlayerCards(0)[0],
+                       uncached.PlayerCards(0)[1]});
+
+  fishbait::Timer timer;
+  fishbait::Chips cached_chips = 0;
+  for (int i = 0; i < kShowdowns; ++i) {
+    fishbait::Node<kPlayers> terminal = game;
+    terminal.AwardPot(terminal.same_stack_no_rake_);
+    cached_chips += terminal.stack(i % kPlayers);
+  }
+  std::cout << "showdowns with cached ranks: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+  fishbait::Chips uncached_chips = 0;
+  for (int i = 0; i < kShowdowns; ++i) {
+    fishbait::Node<kPlayers> terminal = uncached;
+    terminal.AwardPot(terminal.same_stack_no_rake_);
+    uncached_chips += terminal.stack(i % kPlayers);
+  }
+  std::cout << "showdowns without cached ranks: ";
+  timer.Reset<fishbait::Timer::Milliseconds>(std::cout) << std::endl;
+  REQUIRE(cached_chips == uncached_chips);
+}  // TEST_CASE "showdown benchmark"
@@ -1,6 +1,7 @@
 #include <array>
 #include <filesystem>
 #include <functional>
+#include <vector>
 
 #include "array/array.h"
 #include "catch2/catch.hpp"
@@ -72,6 +73,25 @@ TEST_CASE("scribe test", "[relay][scribe]") {
     }
   }
 
+  // Test GetClusters()
+  INFO("test GetClusters()");
+  for (fishbait::RoundId rid = 0; rid < fishbait::kNRounds; ++rid) {
+    fishbait::Round round{rid};
+    INFO(rid);
+    std::vector<hand_index_t> idxs;
+    for (hand_index_t hidx = 0; hidx < fishbait::kImperfectRecallHands[rid];
+         hidx = hidx + 100001) {
+      idxs.push_back(hidx);
+    }
+    std::vector<fishbait::CardCluster> clusters = scribe.GetClusters(round,
+                                                                     idxs);
+    REQUIRE(clusters.size() == idxs.size());
+    for (std::size_t i = 0; i < idxs.size(); ++i) {
+      INFO(idxs[i]);
+      REQUIRE(clusters[i] == avg.info_abstraction().table()[rid][idxs[i]]);
+    }
+  }
+
   // Test Bind and Matchmaker
   auto access_fn = std::bind(&ScribeT::GetCluster, &scribe,
                              std::placeholders::_1, std::placeholders::_2);
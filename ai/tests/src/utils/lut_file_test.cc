@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "array/array.h"
+#include "array/matrix.h"
+#include "catch2/catch.hpp"
+#include "utils/cereal.h"
+#include "utils/lut_file.h"
+
+namespace {
+
+struct Strength {
+  double ehs;
+  uint32_t totals[3];
+};
+
+}  // namespace
+
+TEST_CASE("Save and load LUT matrix", "[utils][lut_file]") {
+  const uint32_t n = 100;
+  const uint32_t m = 7;
+  nda::matrix<double> save_matrix(nda::matrix_shape<>(n, m));
+  for (uint32_t i = 0; i < n; ++i) {
+    for (uint32_t j = 0; j < m; ++j) {
+      save_matrix(i, j) = i * 0.5 + j;
+    }
+  }
+  fishbait::LUTFile(fishbait::FileAction::Save, "out/tests/matrix.lut",
+                    &save_matrix);
+
+  nda::matrix<double> load_matrix(nda::matrix_shape<>(1, 1));
+  fishbait::LUTFile(fishbait::FileAction::Load, "out/tests/matrix.lut",
+                    &load_matrix);
+  REQUIRE(load_matrix.rows() == n);
+  REQUIRE(load_matrix.columns() == m);
+  REQUIRE(load_matrix == save_matrix);
+
+  fishbait::MappedLUT<double> mapped("out/tests/matrix.lut", true);
+  REQUIRE(mapped.rows() == n);
+  REQUIRE(mapped.columns() == m);
+  for (uint32_t i = 0; i < n; ++i) {
+    for (uint32_t j = 0; j < m; ++j) {
+      REQUIRE(mapped(i, j) == save_matrix(i, j));
+    }
+  }
+  nda::const_matrix_ref<double> mapped_matrix = mapped.matrix();
+  REQUIRE(mapped_matrix.rows() == n);
+  REQUIRE(mapped_matrix.columns() == m);
+  REQUIRE(mapped_matrix(n - 1, m - 1) == save_matrix(n - 1, m - 1));
+
+  REQUIRE_THROWS_AS(fishbait::MappedLUT<float>("out/tests/matrix.lut"),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(fishbait::MappedLUT<int64_t>("out/tests/matrix.lut"),
+                    std::invalid_argument);
+}  // TEST_CASE "Save and load LUT matrix"
+
+TEST_CASE("Map and read LUT ranges", "[utils][lut_file]") {
+  // Spans several chunks with a short last chunk
+  const uint64_t chunk_elements = fishbait::kLUTChunkBytes / sizeof(Strength);
+  const uint64_t n = 3 * chunk_elements + 17;
+  std::vector<Strength> save_vect(n);
+  for (uint64_t i = 0; i < n; ++i) {
+    save_vect[i] = {i / 3.0, {static_cast<uint32_t>(i), 1, 2}};
+  }
+  fishbait::LUTFile(fishbait::FileAction::Save, "out/tests/strengths.lut",
+                    &save_vect);
+
+  fishbait::MappedLUT<Strength> mapped("out/tests/strengths.lut");
+  REQUIRE(mapped.size() == n);
+  mapped.Verify();
+  fishbait::LUTView<Strength> view = mapped;
+  for (uint64_t i = 0; i < n; i += 997) {
+    REQUIRE(view[i].ehs == save_vect[i].ehs);
+    REQUIRE(view[i].totals[0] == save_vect[i].totals[0]);
+  }
+
+  const uint64_t begin = chunk_elements - 5;
+  const uint64_t range = chunk_elements + 10;
+  std::vector<Strength> read_vect(range);
+  fishbait::ReadLUT("out/tests/strengths.lut", begin, range, read_vect.data());
+  for (uint64_t i = 0; i < range; ++i) {
+    REQUIRE(read_vect[i].ehs == save_vect[begin + i].ehs);
+    REQUIRE(read_vect[i].totals[0] == save_vect[begin + i].totals[0]);
+  }
+  REQUIRE_THROWS_AS(fishbait::ReadLUT("out/tests/strengths.lut", n - 1, 2,
+                                      read_vect.data()),
+                    std::out_of_range);
+
+  std::vector<Strength> load_vect;
+  fishbait::LUTFile(fishbait::FileAction::Load, "out/tests/strengths.lut",
+                    &load_vect);
+  REQUIRE(load_vect.size() == n);
+  REQUIRE(load_vect.back().totals[0] == n - 1);
+}  // TEST_CASE "Map and read LUT ranges"
+
+TEST_CASE("Corrupt LUT chunks are detected", "[utils][lut_file]") {
+  const uint64_t chunk_elements = fishbait::kLUTChunkBytes / sizeof(uint32_t);
+  const uint64_t n = 2 * chunk_elements;
+  std::vector<uint32_t> save_vect(n, 7);
+  fishbait::LUTFile(fishbait::FileAction::Save, "out/tests/corrupt.lut",
+                    &save_vect);
+
+  // Flip a byte in the second chunk
+  std::fstream file("out/tests/corrupt.lut",
+                    std::ios::binary | std::ios::in | std::ios::out);
+  fishbait::LUTFileHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  file.seekp(header.data_offset + (chunk_elements + 3) * sizeof(uint32_t));
+  file.put(1);
+  file.close();
+
+  fishbait::MappedLUT<uint32_t> mapped("out/tests/corrupt.lut");
+  REQUIRE_NOTHROW(mapped.Verify(0, chunk_elements));
+  REQUIRE_THROWS(mapped.Verify(chunk_elements, n));
+  REQUIRE_THROWS(fishbait::MappedLUT<uint32_t>("out/tests/corrupt.lut", true));
+
+  std::vector<uint32_t> read_vect(10);
+  fishbait::ReadLUT("out/tests/corrupt.lut", 0, 10, read_vect.data());
+  REQUIRE(read_vect == std::vector<uint32_t>(10, 7));
+  REQUIRE_THROWS(fishbait::ReadLUT("out/tests/corrupt.lut", chunk_elements, 10,
+                                   read_vect.data()));
+}  // TEST_CASE "Corrupt LUT chunks are detected"
+
+TEST_CASE("Saving over a mapped LUT", "[utils][lut_file]") {
+  std::vector<uint32_t> old_vect(1000, 7);
+  fishbait::LUTFile(fishbait::FileAction::Save, "out/tests/replaced.lut",
+                    &old_vect);
+  fishbait::MappedLUT<uint32_t> mapped("out/tests/replaced.lut");
+
+  std::vector<uint32_t> new_vect(10, 9);
+  fishbait::LUTFile(fishbait::FileAction::Save, "out/tests/replaced.lut",
+                    &new_vect);
+
+  // The old mapping still sees the old file
+  REQUIRE(mapped.size() == old_vect.size());
+  mapped.Verify();
+  for (std::size_t i = 0; i < old_vect.size(); ++i) {
+    REQUIRE(mapped.data()[i] == old_vect[i]);
+  }
+
+  std::vector<uint32_t> load_vect;
+  fishbait::LUTFile(fishbait::FileAction::Load, "out/tests/replaced.lut",
+                    &load_vect);
+  REQUIRE(load_vect == new_vect);
+}  // TEST_CASE "Saving over a mapped LUT"
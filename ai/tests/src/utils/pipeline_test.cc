@@ -0,0 +1,153 @@
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "utils/lut_file.h"
+#include "utils/pipeline.h"
+
+namespace {
+
+void WriteFile(const std::string& path, const std::string& contents) {
+  std::ofstream os(path);
+  os << contents;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream ins(path);
+  std::string contents;
+  std::getline(ins, contents);
+  return contents;
+}
+
+}  // namespace
+
+TEST_CASE("Pipeline skips stages that are up to date", "[utils][pipeline]") {
+  const std::string dir = "out/tests/pipeline";
+  const std::string manifest = dir + "/manifest.txt";
+  std::filesystem::remove_all(dir);
+
+  std::string source = "a";
+  std::string b_parameters = "1";
+  std::atomic<int> b_runs = 0;
+  std::atomic<int> c_runs = 0;
+  std::atomic<int> d_runs = 0;
+  auto make_pipeline = [&] {
+    fishbait::Pipeline pipeline;
+    pipeline.AddStage("a", {}, {dir + "/a.txt"}, source, [&] {
+      WriteFile(dir + "/a.txt", source);
+    });
+    // b writes the same thing for every source that starts with "a"
+    pipeline.AddStage("b", {"a"}, {dir + "/b.txt"}, b_parameters, [&] {
+      ++b_runs;
+      WriteFile(dir + "/b.txt", ReadFile(dir + "/a.txt").substr(0, 1) +
+                                b_parameters);
+    });
+    pipeline.AddStage("c", {"a"}, {dir + "/c.txt"}, "1", [&] {
+      ++c_runs;
+      WriteFile(dir + "/c.txt", ReadFile(dir + "/a.txt") + "c");
+    });
+    pipeline.AddStage("d", {"b", "c"}, {dir + "/d.txt"}, "1", [&] {
+      ++d_runs;
+      WriteFile(dir + "/d.txt", ReadFile(dir + "/b.txt") +
+                                ReadFile(dir + "/c.txt"));
+    });
+    return pipeline;
+  };
+
+  std::vector<std::string> ran = make_pipeline().Run(manifest);
+  REQUIRE(ran.size() == 4);
+  REQUIRE(ran.front() == "a");
+  REQUIRE(ran.back() == "d");
+  REQUIRE(ReadFile(dir + "/d.txt") == "a1ac");
+
+  // Nothing changed
+  REQUIRE(make_pipeline().Run(manifest, 1).empty());
+
+  // a's output changes, but b's does not, so d only reruns because of c
+  source = "ab";
+  ran = make_pipeline().Run(manifest, 2);
+  REQUIRE(ran.size() == 4);
+  REQUIRE(b_runs == 2);
+  REQUIRE(ReadFile(dir + "/d.txt") == "a1abc");
+
+  // b's parameters change
+  b_parameters = "2";
+  ran = make_pipeline().Run(manifest);
+  REQUIRE(ran == std::vector<std::string>{"b", "d"});
+  REQUIRE(c_runs == 2);
+  REQUIRE(ReadFile(dir + "/d.txt") == "a2abc");
+
+  // An output is modified outside of the pipeline
+  WriteFile(dir + "/c.txt", "modified");
+  ran = make_pipeline().Run(manifest);
+  REQUIRE(ran == std::vector<std::string>{"c"});
+  REQUIRE(d_runs == 3);
+
+  // An output is deleted
+  std::filesystem::remove(dir + "/d.txt");
+  ran = make_pipeline().Run(manifest);
+  REQUIRE(ran == std::vector<std::string>{"d"});
+  REQUIRE(ReadFile(dir + "/d.txt") == "a2abc");
+}  // TEST_CASE "Pipeline skips stages that are up to date"
+
+TEST_CASE("Pipeline stage errors", "[utils][pipeline]") {
+  const std::string dir = "out/tests/pipeline_errors";
+  const std::string manifest = dir + "/manifest.txt";
+  std::filesystem::remove_all(dir);
+
+  fishbait::Pipeline pipeline;
+  REQUIRE_THROWS_AS(pipeline.AddStage("a", {"b"}, {}, "", [] {}),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(pipeline.AddStage("a b", {}, {}, "", [] {}),
+                    std::invalid_argument);
+
+  bool fail = true;
+  bool b_ran = false;
+  pipeline.AddStage("a", {}, {dir + "/a.txt"}, "", [&] {
+    if (fail) throw std::runtime_error("a failed");
+    WriteFile(dir + "/a.txt", "a");
+  });
+  pipeline.AddStage("b", {"a"}, {dir + "/b.txt"}, "", [&] {
+    b_ran = true;
+    WriteFile(dir + "/b.txt", "b");
+  });
+  REQUIRE_THROWS_AS(pipeline.AddStage("a", {}, {}, "", [] {}),
+                    std::invalid_argument);
+
+  REQUIRE_THROWS_AS(pipeline.Run(manifest), std::runtime_error);
+  REQUIRE_FALSE(b_ran);
+
+  // A stage which does not write its outputs fails
+  fail = false;
+  fishbait::Pipeline missing_output;
+  missing_output.AddStage("a", {}, {dir + "/missing.txt"}, "", [] {});
+  REQUIRE_THROWS_AS(missing_output.Run(manifest), std::runtime_error);
+
+  REQUIRE(pipeline.Run(manifest).size() == 2);
+  REQUIRE(b_ran);
+}  // TEST_CASE "Pipeline stage errors"
+
+TEST_CASE("File hash of LUT files", "[utils][pipeline]") {
+  const std::string path = "out/tests/pipeline_hash.lut";
+  std::vector<uint32_t> data(1000);
+  for (uint32_t i = 0; i < data.size(); ++i) data[i] = i;
+  fishbait::LUTFile(fishbait::FileAction::Save, path, &data);
+  const uint64_t hash = fishbait::FileHash(path);
+  fishbait::LUTFile(fishbait::FileAction::Save, path, &data);
+  REQUIRE(fishbait::FileHash(path) == hash);
+
+  data[500] = 0;
+  fishbait::LUTFile(fishbait::FileAction::Save, path, &data);
+  REQUIRE(fishbait::FileHash(path) != hash);
+
+  // A truncated LUT file is hashed in full
+  fishbait::SaveLUT(path, data.data(), data.size(), 1);
+  const uint64_t full_hash = fishbait::FileHash(path);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 4);
+  REQUIRE(fishbait::FileHash(path) != full_hash);
+}  // TEST_CASE "File hash of LUT files"
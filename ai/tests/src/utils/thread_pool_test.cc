@@ -0,0 +1,51 @@
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "catch2/catch.hpp"
+#include "utils/thread_pool.h"
+
+TEST_CASE("ThreadPool runs every worker once per task", "[utils][thread]") {
+  fishbait::ThreadPool pool(4);
+  REQUIRE(pool.size() == 4);
+
+  for (uint32_t n_workers : {4, 2, 1, 0, 3, 4}) {
+    std::vector<std::atomic<int>> calls(4);
+    pool.Run(n_workers, [&](uint32_t worker) { ++calls[worker]; });
+    for (uint32_t worker = 0; worker < 4; ++worker) {
+      REQUIRE(calls[worker] == (worker < n_workers ? 1 : 0));
+    }
+  }
+
+  // The same threads run every task
+  std::vector<std::thread::id> first(4);
+  std::vector<std::thread::id> second(4);
+  pool.Run(4, [&](uint32_t worker) {
+    first[worker] = std::this_thread::get_id();
+  });
+  pool.Run(4, [&](uint32_t worker) {
+    second[worker] = std::this_thread::get_id();
+  });
+  REQUIRE(first == second);
+  REQUIRE(first[0] == std::this_thread::get_id());
+  REQUIRE(std::set<std::thread::id>(first.begin(), first.end()).size() == 4);
+}  // TEST_CASE "ThreadPool runs every worker once per task"
+
+TEST_CASE("ThreadPool rethrows after every worker finishes",
+          "[utils][thread]") {
+  fishbait::ThreadPool pool(3);
+  std::atomic<int> finished = 0;
+  REQUIRE_THROWS_AS(pool.Run(3, [&](uint32_t worker) {
+    if (worker == 2) throw std::runtime_error("worker 2");
+    ++finished;
+  }), std::runtime_error);
+  REQUIRE(finished == 2);
+
+  // The pool can still be used
+  std::atomic<int> calls = 0;
+  pool.Run(3, [&](uint32_t) { ++calls; });
+  REQUIRE(calls == 3);
+}  // TEST_CASE "ThreadPool rethrows after every worker finishes"
@@ -230,6 +230,13 @@ commander_reset = handle_commander_buffer(
   .arg(c_size_t)
   .arg(BinStr)
 )
+commander_set_search_budget = handle_commander_buffer(
+  LibFn.name('CommanderSetSearchBudget')
+  .arg(CallbackFunc)
+  .arg(c_double)
+  .arg(c_size_t)
+  .arg(BinStr)
+)
 commander_set_hand = handle_commander_buffer(
   LibFn.name('CommanderSetHand')
   .arg(CallbackFunc)
@@ -576,6 +583,10 @@ class Pigeon(PigeonInterface):
 
     strategy_loc = settings.STRATEGY_LOCATION
     commander_create(bytes(strategy_loc, 'utf-8'), self._commander_callback)
+    if settings.SEARCH_BUDGET > 0:
+      commander_set_search_budget(
+        self._commander, settings.SEARCH_BUDGET, self._commander_callback
+      )
 
     self._state: PigeonState = PigeonState()
     self._update_state()
@@ -12,6 +12,10 @@ PIGEON_EXECUTION_TIMEOUT: int = (
     int(os.getenv("PIGEON_EXECUTION_TIMEOUT", "5"))  # in seconds
 )
 
+SEARCH_BUDGET: float = (
+    float(os.getenv("SEARCH_BUDGET", "0"))  # in milliseconds, 0 disables search
+)
+
 PLAYERS: int = 6
 HAND_CARDS: int = 2
 BOARD_CARDS: int = 5